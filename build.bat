@@ -3,7 +3,7 @@ SETLOCAL ENABLEEXTENSIONS ENABLEDELAYEDEXPANSION
 
 CD /D %~dp0
 
-set sources=openxr.c xrbody.c
+set sources=openxr.c xrbody.c xrinput.c xrres.c xrmask.c xrquad.c xrmesh.c xrctrl.c xrlod.c xrtex.c xrcaps.c xrlog.c xrstats.c xrgl.c xraction.c xrhaptic.c xrpose.c
 set subdirs=components
 
 set DIR=build
@@ -8,24 +8,452 @@
 typedef struct IUnknown IUnknown;
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
+#else
+#include <X11/Xlib.h>
+#include <GL/glx.h>
+#include <EGL/egl.h>
+#define XR_USE_PLATFORM_XLIB
+#define XR_USE_PLATFORM_EGL
+#define XR_USE_GRAPHICS_API_OPENGL
+#include <openxr/openxr.h>
+#include <openxr/openxr_platform.h>
 #endif
 
+#ifdef _WIN32
+typedef HANDLE xr_thread_t;
+typedef volatile LONG xr_atomic_t;
+#define xr_atomic_load(ptr) InterlockedCompareExchange((ptr), 0, 0)
+#define xr_atomic_store(ptr, val) InterlockedExchange((ptr), (val))
+#define xr_atomic_swap(ptr, val) InterlockedExchange((ptr), (val))
+#define xr_atomic_add(ptr, val) InterlockedExchangeAdd((ptr), (val))
+#define xr_atomic_cas(ptr, expected, desired) \
+	(InterlockedCompareExchange((ptr), (desired), (expected)) == (expected))
+#define xr_atomic_load_ptr(ptr) \
+	InterlockedCompareExchangePointer((PVOID volatile*)(ptr), NULL, NULL)
+#define xr_atomic_swap_ptr(ptr, val) \
+	InterlockedExchangePointer((PVOID volatile*)(ptr), (val))
+#define xr_atomic_cas_ptr(ptr, expected, desired) \
+	(InterlockedCompareExchangePointer((PVOID volatile*)(ptr), (desired), \
+	                                   (expected)) == (expected))
+#define xr_thread_yield() Sleep(0)
+typedef struct { CRITICAL_SECTION lock; CONDITION_VARIABLE cond; } xr_signal_t;
+#define xr_signal_init(s) \
+	(InitializeCriticalSection(&(s)->lock), InitializeConditionVariable(&(s)->cond))
+#define xr_signal_destroy(s) DeleteCriticalSection(&(s)->lock)
+#define xr_signal_lock(s) EnterCriticalSection(&(s)->lock)
+#define xr_signal_unlock(s) LeaveCriticalSection(&(s)->lock)
+#define xr_signal_wait(s) SleepConditionVariableCS(&(s)->cond, &(s)->lock, INFINITE)
+#define xr_signal_notify(s) WakeAllConditionVariable(&(s)->cond)
+#else
+#include <pthread.h>
+#include <sched.h>
+typedef pthread_t xr_thread_t;
+typedef volatile long xr_atomic_t;
+#define xr_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define xr_atomic_store(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define xr_atomic_swap(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_ACQ_REL)
+#define xr_atomic_add(ptr, val) __atomic_fetch_add((ptr), (val), __ATOMIC_ACQ_REL)
+#define xr_atomic_cas(ptr, expected, desired) \
+	__sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define xr_atomic_load_ptr(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define xr_atomic_swap_ptr(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_ACQ_REL)
+#define xr_atomic_cas_ptr(ptr, expected, desired) \
+	__sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define xr_thread_yield() sched_yield()
+typedef struct { pthread_mutex_t lock; pthread_cond_t cond; } xr_signal_t;
+#define xr_signal_init(s) \
+	(pthread_mutex_init(&(s)->lock, NULL), pthread_cond_init(&(s)->cond, NULL))
+#define xr_signal_destroy(s) \
+	(pthread_cond_destroy(&(s)->cond), pthread_mutex_destroy(&(s)->lock))
+#define xr_signal_lock(s) pthread_mutex_lock(&(s)->lock)
+#define xr_signal_unlock(s) pthread_mutex_unlock(&(s)->lock)
+#define xr_signal_wait(s) pthread_cond_wait(&(s)->cond, &(s)->lock)
+#define xr_signal_notify(s) pthread_cond_broadcast(&(s)->cond)
+#endif
+
+/* States of the frame slot shared with the pacing thread. The pacing thread
+ * only calls xrWaitFrame on an empty slot, the main thread empties it after
+ * xrBeginFrame, keeping the wait/begin/end order the spec requires. A failed
+ * wait ends the thread, the main thread then waits on its own. */
+enum
+{
+	XR_FRAME_SLOT_EMPTY,
+	XR_FRAME_SLOT_READY,
+	XR_FRAME_SLOT_TAKEN,
+	XR_FRAME_SLOT_FAILED
+};
+
+/* upper bound for frames the GPU is allowed to lag behind the CPU */
+#define XR_MAX_FRAMES_IN_FLIGHT 2
+/* longest wait for a frame in flight before giving up on its fence */
+#define XR_FENCE_TIMEOUT_NS 1000000000ull
+
+/* GPU timer results are read this many frames after being issued, which is
+ * enough for them to be available without stalling */
+#define XR_TIMER_FRAMES (XR_MAX_FRAMES_IN_FLIGHT + 2)
+#define XR_MAX_VIEWS 4
+
+/* Scales the rendered area of each view to keep the GPU time within the
+ * display period, swapchains are allocated for the largest scale. */
+struct xr_resolution
+{
+	bool_t enabled;
+	float scale;
+	float min_scale;
+	float max_scale;
+	/* one GL_TIME_ELAPSED query per rendered swapchain per frame */
+	GLuint queries[XR_TIMER_FRAMES][XR_MAX_VIEWS];
+	uint32_t query_count[XR_TIMER_FRAMES];
+	bool_t pending[XR_TIMER_FRAMES];
+	uint32_t frame;
+	uint64_t gpu_time;
+	uint32_t over_budget;
+	uint32_t under_budget;
+};
+
+/* Render state owned by the XR component for each view, sized from
+ * configuration_views. Each view keeps its own previous_view matrix. Its
+ * own targets, and with them TAA and motion vector history, only come
+ * with a dedicated renderer, which is opt-in through view_pipeline. By
+ * default all views draw into the one shared renderer's targets. */
+struct xr_view
+{
+	/* size currently rendered, changed by the dynamic resolution controller
+	 * within the swapchain size */
+	uint32_t width;
+	uint32_t height;
+	uint32_t recommended_width;
+	uint32_t recommended_height;
+	uint32_t swapchain_width;
+	uint32_t swapchain_height;
+	/* NULL when the view draws with the shared c_openxr renderer */
+	renderer_t *renderer;
+	mat4_t previous_view;
+};
+
+enum
+{
+	XR_INPUT_POSE  = 1 << 0,
+	XR_INPUT_GRAB  = 1 << 1,
+	XR_INPUT_LEVER = 1 << 2
+};
+
+/* Structure of arrays snapshot of the input of every registered body,
+ * sampled once per frame right after xrSyncActions. Bodies index it with
+ * the slot they got when registering. */
+struct xr_input
+{
+	uint32_t count;
+	uint32_t capacity;
+
+	/* registration */
+	XrSpace *spaces;
+	XrPath *paths;
+	XrAction *grab_actions;
+	XrAction *lever_actions;
+
+	/* per frame state */
+	XrTime time;
+	XrSpaceLocation *locations;
+	/* chained to the locations when velocity tracking is enabled, the
+	 * filtered values smooth out sensor noise before extrapolation */
+	bool_t track_velocity;
+	float velocity_smoothing;
+	XrSpaceVelocity *velocities;
+	XrVector3f *linear_velocity;
+	XrVector3f *angular_velocity;
+	float *grab;
+	float *lever;
+	uint8_t *active;
+	uint8_t *changed;
+	/* pose part of each body's model matrix, the tracking origin it was
+	 * placed under and their product, set in world_pre_draw and used for
+	 * late latching */
+	mat4_t *models;
+	mat4_t *worlds;
+	mat4_t origin;
+};
+
+/* XR_KHR_visibility_mask hidden area, see xrmask.c */
+struct xr_visibility_mask
+{
+	PFN_xrGetVisibilityMaskKHR get;
+	bool_t dirty;
+	GLuint program;
+	GLint projection_loc;
+	GLuint vao;
+	GLuint vbo;
+	GLuint ibo;
+	uint32_t index_count;
+	uint32_t first[XR_MAX_VIEWS];
+	uint32_t count[XR_MAX_VIEWS];
+};
+
+/* OpenXR guarantees at least 16 composition layers, one of which is taken
+ * by the projection layer */
+#define XR_MAX_QUADS 15
+
+/* World locked UI panel composited by the runtime from its own swapchain.
+ * Images are only acquired and drawn while the content is dirty, a quad
+ * without a new image keeps showing the last released one. */
+struct xr_quad
+{
+	bool_t used;
+	bool_t visible;
+	bool_t dirty;
+	/* at least one image was released, the layer can be submitted */
+	bool_t ready;
+	renderer_t *renderer;
+	uint32_t width;
+	uint32_t height;
+	XrExtent2Df size;
+	XrPosef pose;
+	XrSwapchain swapchain;
+	XrSwapchainImageOpenGLKHR *images;
+	GLuint *framebuffers;
+	uint32_t image_count;
+};
+
+#define XR_LOD_LEVELS 3
+
+/* Views of the last drawn frame. Models choose their level in
+ * world_pre_draw, before the views of the current frame are located. */
+struct xr_lod
+{
+	uint32_t view_count;
+	vec3_t positions[XR_MAX_VIEWS];
+	/* rendered pixels covered by one meter seen from one meter away */
+	float pixels_per_meter[XR_MAX_VIEWS];
+};
+
+/* Inputs the controller component layout animates, see xrctrl.c */
+enum
+{
+	XR_CONTROL_TRIGGER,
+	XR_CONTROL_SQUEEZE,
+	XR_CONTROL_STICK_X,
+	XR_CONTROL_STICK_Y,
+	XR_CONTROL_STICK_CLICK,
+	XR_CONTROL_PAD_X,
+	XR_CONTROL_PAD_Y,
+	XR_CONTROL_PAD_TOUCH,
+	XR_CONTROL_A,
+	XR_CONTROL_B,
+	XR_CONTROL_SYSTEM,
+	XR_CONTROL_COUNT
+};
+
+#define XR_CONTROLLER_ACTIONS 9
+#define XR_CONTROLLER_MAX_PARTS 24
+/* vec4s describing the motion of one part in the parts uniform block */
+#define XR_CONTROLLER_PART_VEC4S 7
+#define XR_CONTROLLER_PARTS_BINDING 14
+
+/* All parts of one hand's controller merged in a single vertex buffer, each
+ * vertex tagged with its part. The motion of every part is uploaded once,
+ * only the control values change per frame. */
+struct xr_controller_hand
+{
+	bool_t loaded;
+	uint32_t input_slot;
+	XrPath path;
+	GLuint vao;
+	GLuint vbo;
+	GLuint ibo;
+	uint32_t index_count;
+	uint32_t part_count;
+	GLuint parts_ubo;
+	GLuint texture;
+	float controls[XR_CONTROL_COUNT];
+};
+
+struct xr_controllers
+{
+	/* drawn by the plugin, either animated or late latched */
+	bool_t enabled;
+	/* the parts follow the controls, otherwise they stay at rest */
+	bool_t animated;
+	XrAction actions[XR_CONTROLLER_ACTIONS];
+	GLuint program;
+	GLint view_projection_loc;
+	GLint model_loc;
+	GLint controls_loc;
+	GLint latch_slot_loc;
+	/* resolves the scene's depth before the controllers are drawn */
+	GLuint depth_program;
+	GLuint depth_vao;
+	struct xr_controller_hand hands[2];
+};
+
 struct xrbody_internal
 {
 	bool_t initiated;
+	uint32_t input_slot;
 	XrSpace space;
 	XrPath path;
-	XrActionSet bodyset;
 	XrAction poseAction;
 	XrAction grabAction;
 	XrAction hapticAction;
 	XrAction leverAction;
+	uint32_t haptic_slot;
+	/* pattern held while the trigger is pressed */
+	uint32_t grab_haptic;
+	/* optional detail levels of the body's model, finest first, the
+	 * coarsest also feeds the shadow proxy */
+	mesh_t *levels[XR_LOD_LEVELS];
+	uint32_t level_count;
+	uint32_t level;
+	float radius;
+	entity_t shadow;
+};
+
+/* interaction profiles of the action manifest, see xraction.c */
+enum
+{
+	XR_PROFILE_INDEX,
+	XR_PROFILE_SIMPLE,
+	XR_PROFILE_COUNT
+};
+
+struct xr_path_entry
+{
+	uint64_t hash;
+	char *string;
+	XrPath path;
+};
+
+struct xr_actions
+{
+	/* open addressed, power of two capacity kept at most half full */
+	struct xr_path_entry *paths;
+	uint32_t path_count;
+	uint32_t path_capacity;
+	XrActionSuggestedBinding *bindings[XR_PROFILE_COUNT];
+	uint32_t binding_count[XR_PROFILE_COUNT];
+	uint32_t binding_capacity[XR_PROFILE_COUNT];
+	uint32_t body_count;
+	/* grip pose to controller mesh */
+	mat4_t grip;
+};
+
+/* haptic patterns overlapping on one body and their length, see
+ * xrhaptic.c */
+#define XR_HAPTIC_REQUESTS 8
+#define XR_HAPTIC_STEPS 16
+
+struct xr_haptic_request
+{
+	/* 0 when the slot is free */
+	uint32_t id;
+	uint32_t step_count;
+	uint32_t repeat;
+	uint64_t start;
+	/* in nanoseconds, steps store their end relative to the pattern start */
+	uint64_t length;
+	struct
+	{
+		uint64_t end;
+		float amplitude;
+		float frequency;
+	} steps[XR_HAPTIC_STEPS];
+};
+
+struct xr_haptic_channel
+{
+	XrAction action;
+	XrPath path;
+	struct xr_haptic_request requests[XR_HAPTIC_REQUESTS];
+	/* vibration last handed to the runtime and when it runs out */
+	float amplitude;
+	float frequency;
+	uint64_t applied_until;
+};
+
+struct xr_haptics
+{
+	struct xr_haptic_channel *channels;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t next_id;
+};
+
+/* frames kept by the telemetry ring, see xrstats.c */
+#define XR_STATS_FRAMES 512
+
+enum xr_stats_phase
+{
+	XR_STATS_IDLE,
+	XR_STATS_BEGIN_FRAME,
+	XR_STATS_SWAPCHAIN_WAIT,
+	XR_STATS_DRAW,
+	XR_STATS_BLIT,
+	XR_STATS_END_FRAME
+};
+
+struct xr_stats
+{
+	bool_t enabled;
+	bool_t overlay;
+	struct openxr_frame_stats frames[XR_STATS_FRAMES];
+	uint64_t frame;
+	struct openxr_frame_stats *current;
+	uint64_t frame_start;
+	uint64_t mark;
+	uint64_t wait_frame;
+	XrTime last_display_time;
+	struct openxr_stats_totals totals;
+	/* GL_TIMESTAMP queries before the draw, after the draw and after the
+	 * copy of each view, read back XR_TIMER_FRAMES later */
+	bool_t queries_ready;
+	GLuint queries[XR_TIMER_FRAMES][XR_MAX_VIEWS][3];
+	uint64_t query_frame[XR_TIMER_FRAMES];
+	uint32_t query_views[XR_TIMER_FRAMES];
+	bool_t query_pending[XR_TIMER_FRAMES];
+	uint32_t slot;
+	GLuint program;
+	GLuint vao;
+	GLuint vbo;
+};
+
+/* Staged init, the boot thread creates the instance and system while the
+ * render thread keeps drawing, the GL bound stages then run one per frame. */
+enum
+{
+	XR_BOOT_IDLE,
+	XR_BOOT_PROBING,
+	XR_BOOT_SESSION,
+	XR_BOOT_SWAPCHAINS,
+	XR_BOOT_MODELS,
+	XR_BOOT_DONE,
+	XR_BOOT_FAILED
+};
+
+enum
+{
+	XR_CAP_OPENGL          = 1 << 0,
+	XR_CAP_VISIBILITY_MASK = 1 << 1,
+	XR_CAP_LOCATE_SPACES   = 1 << 2,
+	XR_CAP_CORE_VALIDATION = 1 << 3,
+	XR_CAP_EGL             = 1 << 4
+};
+
+/* capabilities of the runtime that produced them, see xrcaps.c */
+struct xr_caps
+{
+	uint32_t flags;
+	char runtime_name[XR_MAX_RUNTIME_NAME_SIZE];
+	XrVersion runtime_version;
 };
 
 struct openxr_internal
 {
 	bool_t initiated;
 	bool_t failed;
+	xr_atomic_t boot_stage;
+	xr_thread_t boot_thread;
+	bool_t boot_joinable;
+	struct xr_caps caps;
+	XrSystemId system_id;
 	/* every OpenXR app that displays something needs at least an instance and a
 	 * session */
 	XrInstance instance;
@@ -34,44 +462,220 @@ struct openxr_internal
 	/* local space is used for "simple" small scale tracking. */
 	/* A room scale VR application with bounds would use stage space. */
 	XrSpace local_space;
+	/* display time from which local_space has a new origin, 0 if none is
+	 * pending */
+	XrTime local_space_change;
 
-	/* The runtime interacts with the OpenGL images (textures) via a Swapchain. */
-	XrGraphicsBindingOpenGLWin32KHR graphics_binding_gl;
-	/* one array of images per view */
+	/* The runtime interacts with the OpenGL images (textures) via a Swapchain.
+	 * The binding matches the window system of the current context, see
+	 * xrgl.c. */
+	uint32_t graphics;
+	union
+	{
+		XrBaseInStructure header;
+#ifdef _WIN32
+		XrGraphicsBindingOpenGLWin32KHR win32;
+#else
+		XrGraphicsBindingOpenGLXlibKHR xlib;
+#ifdef XR_MNDX_egl_enable
+		XrGraphicsBindingEGLMNDX egl;
+#endif
+#endif
+	} graphics_binding;
+	/* one array of images per swapchain, a swapchain per view */
 	XrSwapchainImageOpenGLKHR** images;
 	XrSwapchain* swapchains;
+	/* images in each swapchain */
+	uint32_t *swapchain_lengths;
+	uint32_t swapchain_count;
+	/* negotiated against the internal format of the renderer's output */
+	int64_t swapchain_format;
+	int64_t output_format;
 	XrEnvironmentBlendMode xr_blend;
 
 	/* Each physical Display/Eye is described by a view */
 	uint32_t view_count;
 	XrViewConfigurationView* configuration_views;
 
+	/* session lifecycle, frames are only run between the READY and STOPPING
+	 * states and only rendered while the session is visible */
+	XrSessionState session_state;
+	bool_t session_running;
+	/* xrSyncActions ran this frame, action states are only valid then */
+	bool_t actions_synced;
+
 	XrActionSet main_set;
+	struct xr_input input;
+#ifdef XR_KHR_locate_spaces
+	PFN_xrLocateSpacesKHR locate_spaces;
+#endif
+	/* re-locate bodies right before drawing and upload the corrections
+	 * into a uniform buffer instead of moving their nodes again */
+	bool_t late_latch;
+	GLuint late_latch_ubo;
+
 	XrFrameState frame_state;
+	/* set once xrWaitFrame returned for the frame draw is about to begin */
+	bool_t frame_waited;
+
+	/* opt-in pipelined loop, xrWaitFrame runs on its own thread */
+	bool_t pipelined;
+	xr_thread_t pacing_thread;
+	xr_atomic_t pacing_running;
+	xr_atomic_t pacing_slot;
+	/* signaled when the slot is emptied or the thread asked to stop */
+	xr_signal_t pacing_signal;
+	XrFrameState pacing_frame_state;
+	uint64_t pacing_wait;
 
-	XrActionSuggestedBinding bindings[64];
-	uint32_t bindings_num;
+	struct xr_actions actions;
+	struct xr_haptics haptics;
 	/* To render into a texture we need a framebuffer (one per texture to make it
-	 * easy) */
+	 * easy), the color and depth attachments are set once at creation */
 	GLuint **framebuffers;
-	mat4_t previous_view[2];
+	struct xr_view *views;
+	struct xr_resolution resolution;
+	struct xr_visibility_mask mask;
+	struct xr_quad quads[XR_MAX_QUADS];
+	struct xr_controllers controllers;
+	struct xr_lod lod;
+	struct xr_stats stats;
+	GLuint *depth_textures;
+	/* the renderer's final pass writes straight into the swapchain image,
+	 * otherwise its output is blitted */
+	bool_t zero_copy;
+
+	/* one fence per frame in flight, frame N waits on frame N -
+	 * frames_in_flight before submitting more work */
+	GLsync frame_fences[XR_MAX_FRAMES_IN_FLIGHT];
+	uint32_t frames_in_flight;
+	uint64_t frame_index;
 };
 
-static
-bool_t xr_result(XrInstance instance, XrResult result, const char* format, ...)
+/* logging, see xrlog.c */
+bool_t xr_result(XrInstance instance, XrResult result, const char* format, ...);
+void xr_log(uint32_t severity, uint32_t category, const char *format, ...);
+void xrlog_messenger(XrDebugUtilsMessageSeverityFlagsEXT severity,
+                     const XrDebugUtilsMessengerCallbackDataEXT *msg);
+XrDebugUtilsMessageSeverityFlagsEXT xrlog_messenger_severities(void);
+void xrlog_filter(uint32_t min_severity, uint32_t categories);
+bool_t xrlog_start(void);
+void xrlog_stop(void);
+
+uint32_t xrinput_register(struct xr_input *self, XrSpace space, XrPath path,
+                          XrAction grab, XrAction lever);
+void xrinput_sample(struct openxr_internal *xr);
+void xrinput_locate(struct openxr_internal *xr);
+void xrinput_track_velocity(struct xr_input *self, bool_t track,
+                            float smoothing);
+void xrinput_predict(struct xr_input *self, uint32_t slot, XrTime time,
+                     XrPosef *pose);
+void xrinput_models(struct openxr_internal *xr, const mat4_t *origin);
+void xrinput_destroy(struct xr_input *self);
+
+mat4_t xrpose_offset(vec3_t rot, vec3_t origin);
+void xrpose_models(const XrPosef *poses, size_t stride, uint32_t count,
+                   const mat4_t *offset, const mat4_t *origin,
+                   mat4_t *models, mat4_t *worlds);
+
+void xrres_range(struct xr_resolution *self, float min_scale, float max_scale);
+void xrres_init(struct openxr_internal *xr);
+void xrres_update(struct openxr_internal *xr);
+void xrres_begin(struct openxr_internal *xr);
+void xrres_end(struct openxr_internal *xr);
+void xrres_submit(struct openxr_internal *xr);
+void xrres_destroy(struct openxr_internal *xr);
+
+GLuint xr_program(const char *prefix, const char *vs_source,
+                  const char *fs_source);
+void xrmask_init(struct openxr_internal *xr);
+void xrmask_invalidate(struct openxr_internal *xr);
+bool_t xrmask_prime(struct openxr_internal *xr, GLuint framebuffer,
+                    uint32_t view, const mat4_t *projections);
+void xrmask_destroy(struct openxr_internal *xr);
+
+uint64_t xr_time_ns(void);
+void xrstats_waited(struct openxr_internal *xr, uint64_t wait_ns);
+void xrstats_begin(struct openxr_internal *xr);
+void xrstats_mark(struct openxr_internal *xr, enum xr_stats_phase phase,
+                  uint32_t view);
+void xrstats_view_begin(struct openxr_internal *xr, uint32_t view);
+void xrstats_view_drawn(struct openxr_internal *xr, uint32_t view);
+void xrstats_view_end(struct openxr_internal *xr, uint32_t view);
+void xrstats_end(struct openxr_internal *xr, bool_t rendered);
+void xrstats_draw_overlay(struct openxr_internal *xr, GLuint framebuffer,
+                          uint32_t view);
+void xrstats_destroy(struct openxr_internal *xr);
+
+void xrquad_draw(struct openxr_internal *xr);
+uint32_t xrquad_layers(struct openxr_internal *xr, XrCompositionLayerQuad *layers);
+void xrquad_destroy(struct openxr_internal *xr, uint32_t quad);
+
+/* the capability cache's name in the user's cache directory */
+#define XR_CAPS_CACHE "xrcaps.cache"
+
+bool_t xr_resource_path(const char *name, char *path, size_t size);
+bool_t xr_cache_file(const char *name, char *path, size_t size);
+bool_t xr_cache_entry(const char *source, const char *suffix, char *path,
+                      size_t size);
+
+XrPath xr_path(struct openxr_internal *xr, const char *string);
+XrPath xr_path_join(struct openxr_internal *xr, const char *prefix,
+                    const char *suffix);
+void xraction_bind(struct openxr_internal *xr, uint32_t profile,
+                   XrAction action, XrPath binding);
+bool_t xraction_body(struct openxr_internal *xr, struct xrbody_internal *body,
+                     const char *path);
+void xraction_suggest(struct openxr_internal *xr);
+void xraction_destroy(struct openxr_internal *xr);
+
+uint32_t xrhaptic_register(struct xr_haptics *self, XrAction action, XrPath path);
+uint32_t xrhaptic_play(struct openxr_internal *xr, uint32_t slot,
+                       const struct openxr_haptic_step *steps, uint32_t count,
+                       uint32_t repeat);
+void xrhaptic_cancel(struct openxr_internal *xr, uint32_t slot, uint32_t id);
+void xrhaptic_update(struct openxr_internal *xr);
+void xrhaptic_destroy(struct xr_haptics *self);
+
+bool_t xrgl_binding(struct openxr_internal *self);
+
+bool_t xrcaps_probe(struct xr_caps *self);
+bool_t xrcaps_load(struct xr_caps *self);
+void xrcaps_save(const struct xr_caps *self);
+uint32_t xrcaps_extensions_enabled(const struct xr_caps *self,
+                                   const char **names, uint32_t capacity);
+
+/* Interleaved position, normal and uv of each vertex and the triangle
+ * indices of a cached OBJ, valid until xrmesh_close. */
+#define XRMESH_VERTEX_FLOATS 8
+struct xrmesh_data
 {
-	if (XR_SUCCEEDED(result))
-		return true;
+	const float *vertices;
+	uint32_t vertex_count;
+	const uint32_t *indices;
+	uint32_t index_count;
+	void *handle;
+};
+
+mesh_t *xrmesh_load(const char *path);
+mesh_t *xrmesh_load_level(const char *path, uint32_t level);
+bool_t xrmesh_open(const char *path, struct xrmesh_data *data);
+bool_t xrmesh_open_level(const char *path, uint32_t level,
+                         struct xrmesh_data *data);
+void xrmesh_close(struct xrmesh_data *data);
+uint64_t xr_hash(const uint8_t *data, size_t size);
 
-	char resultString[XR_MAX_RESULT_STRING_SIZE];
-	xrResultToString(instance, result, resultString);
+GLuint xrtex_fallback(void);
+GLuint xrtex_load(const char *path, bool_t srgb, uint32_t *width,
+                  uint32_t *height);
 
-	char formatRes[1024] = ""; // + " []\n"
-	snprintf(formatRes, 1023, "%s [%s]\n", format, resultString);
+void xrctrl_actions(struct openxr_internal *xr);
+void xrctrl_init(struct openxr_internal *xr, uint32_t right_slot,
+                 uint32_t left_slot);
+void xrctrl_sample(struct openxr_internal *xr);
+void xrctrl_draw(struct openxr_internal *xr, GLuint framebuffer, uint32_t view,
+                 const mat4_t *view_projection, GLuint scene_depth);
+void xrctrl_destroy(struct openxr_internal *xr);
 
-	va_list args;
-	va_start(args, format);
-	vprintf(formatRes, args);
-	va_end(args);
-	return false;
-}
+uint32_t xrlod_select(const struct openxr_internal *xr, vec3_t center,
+                      float radius, uint32_t level_count, uint32_t current);
@@ -0,0 +1,202 @@
+#include "../openxr.h"
+#include "../../candle/candle.h"
+#include "xrmock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Runs the plugin's frame loop headless against the mock runtime on a
+ * surfaceless EGL context and reports frame time percentiles. The mock releases
+ * frames as fast as they are submitted unless -t is given, so the numbers
+ * are the cost of the loop itself. */
+
+#define XRBENCH_BOOT_FRAMES 1000
+
+static uint64_t xrbench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int xrbench_compare(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+/* Nearest rank percentile of sorted values. */
+static uint64_t xrbench_percentile(const uint64_t *sorted, uint32_t count,
+                                   float percentile)
+{
+	uint32_t rank = (uint32_t)(percentile / 100.0f * count + 0.5f);
+	if (rank < 1)
+		rank = 1;
+	if (rank > count)
+		rank = count;
+	return sorted[rank - 1];
+}
+
+static void xrbench_report(const char *name, uint64_t *values, uint32_t count,
+                           float scale)
+{
+	if (!count)
+		return;
+	qsort(values, count, sizeof(*values), xrbench_compare);
+	printf("%-10s p50 %8.3f  p90 %8.3f  p99 %8.3f  max %8.3f ms\n", name,
+	       xrbench_percentile(values, count, 50.0f) * scale,
+	       xrbench_percentile(values, count, 90.0f) * scale,
+	       xrbench_percentile(values, count, 99.0f) * scale,
+	       values[count - 1] * scale);
+}
+
+static void xrbench_usage(const char *name)
+{
+	printf("usage: %s [-n frames] [-w warmup] [-p period_ns] [-s width height]\n"
+	       "          [-t] [-P] [-d stats.csv]\n"
+	       "  -t  throttle to the display period\n"
+	       "  -P  pipelined frame pacing\n"
+	       "  -d  dump the per frame records of the last frames\n", name);
+}
+
+/* One frame the way candle's loop runs it, so every world_pre_draw
+ * listener, the bodies' included, runs before the world_draw ones. */
+static void xrbench_frame(void)
+{
+	entity_signal(entity_null, ref("world_pre_draw"), NULL, NULL);
+	entity_signal(entity_null, ref("world_draw"), NULL, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	struct xrmock_config config;
+	uint32_t frames = 1000, warmup = 100;
+	bool_t pipelined = false;
+	const char *dump = NULL;
+
+	xrmock_default_config(&config);
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+			warmup = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			config.display_period = strtoll(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-s") && i + 2 < argc)
+		{
+			config.width = (uint32_t)strtoul(argv[++i], NULL, 10);
+			config.height = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "-t"))
+			config.throttle = XR_TRUE;
+		else if (!strcmp(argv[i], "-P"))
+			pipelined = true;
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+			dump = argv[++i];
+		else
+		{
+			xrbench_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!frames || config.display_period <= 0)
+	{
+		xrbench_usage(argv[0]);
+		return 1;
+	}
+	xrmock_configure(&config);
+
+	/* no window, the views render to their own framebuffers */
+	if (!openxr_surfaceless_context())
+		return 1;
+	printf("GL %s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+	/* registers the components and the resauce index, no window is made */
+	candle_new();
+
+	c_openxr_t *xr = NULL;
+	entity_new({
+		xr = c_openxr_new();
+	});
+	c_openxr_set_pipelined(xr, pipelined);
+	c_openxr_set_stats(xr, true, false);
+
+	/* init is staged over several frames, wait for the first submitted one */
+	uint32_t boot = 0;
+	while (c_openxr_stats_totals(xr).frames == 0 && boot < XRBENCH_BOOT_FRAMES)
+	{
+		xrbench_frame();
+		boot++;
+	}
+	if (c_openxr_stats_totals(xr).frames == 0)
+	{
+		printf("no frame was submitted after %u frames\n", boot);
+		return 1;
+	}
+	printf("first frame after %u frames\n", boot);
+
+	for (uint32_t i = 0; i < warmup; i++)
+		xrbench_frame();
+
+	struct xrmock_counters before, after;
+	const struct openxr_stats_totals totals = c_openxr_stats_totals(xr);
+	uint64_t *times = malloc(sizeof(*times) * frames);
+	xrmock_get_counters(&before);
+	const uint64_t start = xrbench_now();
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		const uint64_t frame_start = xrbench_now();
+		xrbench_frame();
+		times[i] = xrbench_now() - frame_start;
+	}
+	glFinish();
+	const uint64_t elapsed = xrbench_now() - start;
+	xrmock_get_counters(&after);
+
+	/* the plugin's own records, only the most recent ones are kept */
+	struct openxr_frame_stats *records = malloc(sizeof(*records) * frames);
+	const uint32_t count = c_openxr_stats(xr, records, frames);
+	uint64_t *cpu = malloc(sizeof(*cpu) * count);
+	uint64_t *gpu = malloc(sizeof(*gpu) * count);
+	uint32_t gpu_count = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		cpu[i] = records[i].cpu_total;
+		if (!records[i].gpu_valid)
+			continue;
+		gpu[gpu_count] = 0;
+		for (uint32_t v = 0; v < records[i].view_count; v++)
+			gpu[gpu_count] += records[i].draw_gpu[v] + records[i].blit_gpu[v];
+		gpu_count++;
+	}
+
+	const struct openxr_stats_totals end = c_openxr_stats_totals(xr);
+	printf("%u frames in %.3f s, %.1f fps\n", frames, elapsed * 1e-9,
+	       frames / (elapsed * 1e-9));
+	printf("submitted %llu, not rendered %llu, missed %llu, syncs %llu, haptics %llu\n",
+	       (unsigned long long)(after.frames_ended - before.frames_ended),
+	       (unsigned long long)(end.not_rendered - totals.not_rendered),
+	       (unsigned long long)(end.missed - totals.missed),
+	       (unsigned long long)(after.syncs - before.syncs),
+	       (unsigned long long)(after.haptics - before.haptics));
+	xrbench_report("frame", times, frames, 1e-6f);
+	xrbench_report("cpu", cpu, count, 1e-3f);
+	xrbench_report("gpu", gpu, gpu_count, 1e-3f);
+
+	if (dump && !c_openxr_stats_dump(xr, dump))
+		printf("failed to write %s\n", dump);
+
+	/* let the session stop cleanly */
+	xrmock_request_exit();
+	for (uint32_t i = 0; i < 4; i++)
+		xrbench_frame();
+
+	free(gpu);
+	free(cpu);
+	free(records);
+	free(times);
+	return 0;
+}
@@ -0,0 +1,1258 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define XR_USE_GRAPHICS_API_OPENGL
+#include "xrmock.h"
+#include <openxr/openxr_platform.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/* Runtime state, there is one instance with one session at a time. */
+
+#define XRMOCK_NAME "xrmock"
+/* display times start at one second, zero is not a valid XrTime */
+#define XRMOCK_EPOCH 1000000000ll
+#define XRMOCK_MAX_PATHS 1024
+#define XRMOCK_PATH_SIZE 128
+#define XRMOCK_MAX_ACTIONS 256
+#define XRMOCK_MAX_BINDINGS 4
+#define XRMOCK_MAX_SPACES 256
+#define XRMOCK_MAX_SWAPCHAINS 8
+#define XRMOCK_IMAGES 3
+#define XRMOCK_EVENTS 16
+#define XRMOCK_VIEWS 2
+
+#define XRMOCK_HANDLE(type, ptr) ((type)(uintptr_t)(ptr))
+#define XRMOCK_PTR(type, handle) ((type*)(uintptr_t)(handle))
+
+struct xrmock_action
+{
+	char name[XR_MAX_ACTION_NAME_SIZE];
+	XrActionType type;
+	XrPath bindings[XRMOCK_MAX_BINDINGS];
+	uint32_t binding_count;
+	/* value at the previous query, for changedSinceLastSync */
+	float last;
+	XrBool32 used;
+};
+
+enum xrmock_space_kind
+{
+	XRMOCK_SPACE_FREE,
+	XRMOCK_SPACE_REFERENCE,
+	XRMOCK_SPACE_ACTION
+};
+
+struct xrmock_space
+{
+	enum xrmock_space_kind kind;
+	XrReferenceSpaceType reference;
+	/* top level user path an action space follows */
+	char path[XRMOCK_PATH_SIZE];
+	XrPosef offset;
+};
+
+struct xrmock_swapchain
+{
+	XrBool32 used;
+	GLuint images[XRMOCK_IMAGES];
+	uint32_t next;
+};
+
+static struct
+{
+	pthread_mutex_t lock;
+	XrBool32 configured;
+	struct xrmock_config config;
+
+	XrBool32 instance;
+	XrBool32 session;
+	XrSessionState state;
+	XrBool32 running;
+
+	char paths[XRMOCK_MAX_PATHS][XRMOCK_PATH_SIZE];
+	uint32_t path_count;
+	struct xrmock_action actions[XRMOCK_MAX_ACTIONS];
+	struct xrmock_space spaces[XRMOCK_MAX_SPACES];
+	struct xrmock_swapchain swapchains[XRMOCK_MAX_SWAPCHAINS];
+
+	XrEventDataSessionStateChanged events[XRMOCK_EVENTS];
+	uint32_t event_head;
+	uint32_t event_count;
+
+	/* predicted display time of the last waited and last synced frame */
+	XrTime display_time;
+	XrTime sync_time;
+	uint64_t wall_start;
+	struct xrmock_counters counters;
+} mock = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static uint64_t xrmock_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* ------------------------------------------------------------------------ */
+/* default script */
+
+static const XrPosef xrmock_identity = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+
+static double xrmock_seconds(XrTime time)
+{
+	return (double)(time - XRMOCK_EPOCH) * 1e-9;
+}
+
+static XrQuaternionf xrmock_yaw(float angle)
+{
+	XrQuaternionf q = {0.0f, sinf(angle * 0.5f), 0.0f, cosf(angle * 0.5f)};
+	return q;
+}
+
+/* Head swaying slowly with the hands circling in front of it. */
+static XrBool32 xrmock_script_pose(void *user, XrTime time, const char *path,
+                                   XrPosef *pose)
+{
+	const double t = xrmock_seconds(time);
+	const float tau = 6.2831853f;
+	(void)user;
+
+	*pose = xrmock_identity;
+	if (!strcmp(path, "/user/head"))
+	{
+		pose->position.x = 0.05f * sinf(tau * 0.25f * (float)t);
+		pose->position.y = 1.6f;
+		pose->orientation = xrmock_yaw(0.3f * sinf(tau * 0.1f * (float)t));
+		return XR_TRUE;
+	}
+	const float side = !strcmp(path, "/user/hand/left") ? -1.0f
+	                 : !strcmp(path, "/user/hand/right") ? 1.0f : 0.0f;
+	if (side == 0.0f)
+		return XR_FALSE;
+	const float phase = tau * 0.5f * (float)t + (side > 0.0f ? 0.0f : tau * 0.5f);
+	pose->position.x = side * 0.2f + 0.05f * cosf(phase);
+	pose->position.y = 1.2f + 0.05f * sinf(phase);
+	pose->position.z = -0.3f;
+	pose->orientation = xrmock_yaw(side * 0.2f);
+	return XR_TRUE;
+}
+
+/* Analog inputs sweep the full range twice a second, clicks follow them. */
+static float xrmock_script_value(void *user, XrTime time, const char *binding)
+{
+	const double t = xrmock_seconds(time);
+	const float sweep = 0.5f + 0.5f * sinf(6.2831853f * (float)t);
+	(void)user;
+
+	if (strstr(binding, "/value") || strstr(binding, "/force"))
+		return sweep;
+	if (strstr(binding, "/click") || strstr(binding, "/touch"))
+		return sweep > 0.5f ? 1.0f : 0.0f;
+	return 0.0f;
+}
+
+static const struct xrmock_script xrmock_default_script = {
+	xrmock_script_pose, xrmock_script_value, NULL
+};
+
+static uint32_t xrmock_env(const char *name, uint32_t fallback)
+{
+	const char *value = getenv(name);
+	return value && *value ? (uint32_t)strtoul(value, NULL, 10) : fallback;
+}
+
+void xrmock_default_config(struct xrmock_config *config)
+{
+	config->display_period = xrmock_env("XRMOCK_PERIOD_NS", 11111111);
+	config->width = xrmock_env("XRMOCK_WIDTH", 1440);
+	config->height = xrmock_env("XRMOCK_HEIGHT", 1600);
+	config->throttle = xrmock_env("XRMOCK_THROTTLE", 0) != 0;
+	config->ipd = 0.064f;
+	config->fov = 0.87f;
+	config->script = &xrmock_default_script;
+}
+
+void xrmock_configure(const struct xrmock_config *config)
+{
+	pthread_mutex_lock(&mock.lock);
+	mock.config = *config;
+	if (!mock.config.script)
+		mock.config.script = &xrmock_default_script;
+	mock.configured = XR_TRUE;
+	pthread_mutex_unlock(&mock.lock);
+}
+
+void xrmock_get_counters(struct xrmock_counters *counters)
+{
+	pthread_mutex_lock(&mock.lock);
+	*counters = mock.counters;
+	pthread_mutex_unlock(&mock.lock);
+}
+
+/* ------------------------------------------------------------------------ */
+/* events */
+
+static void xrmock_push_state(XrSessionState state)
+{
+	if (mock.event_count == XRMOCK_EVENTS)
+		return;
+	XrEventDataSessionStateChanged *event =
+		&mock.events[(mock.event_head + mock.event_count++) % XRMOCK_EVENTS];
+	event->type = XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED;
+	event->next = NULL;
+	event->session = XRMOCK_HANDLE(XrSession, &mock.session);
+	event->state = state;
+	event->time = mock.display_time;
+}
+
+void xrmock_request_exit(void)
+{
+	pthread_mutex_lock(&mock.lock);
+	if (mock.running)
+		xrmock_push_state(XR_SESSION_STATE_STOPPING);
+	pthread_mutex_unlock(&mock.lock);
+}
+
+XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer *eventData)
+{
+	(void)instance;
+	pthread_mutex_lock(&mock.lock);
+	if (!mock.event_count)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_EVENT_UNAVAILABLE;
+	}
+	const XrEventDataSessionStateChanged *event = &mock.events[mock.event_head];
+	mock.event_head = (mock.event_head + 1) % XRMOCK_EVENTS;
+	mock.event_count--;
+	memcpy(eventData, event, sizeof(*event));
+	mock.state = event->state;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------ */
+/* instance and system */
+
+XrResult xrEnumerateApiLayerProperties(uint32_t propertyCapacityInput,
+                                       uint32_t *propertyCountOutput,
+                                       XrApiLayerProperties *properties)
+{
+	(void)propertyCapacityInput;
+	(void)properties;
+	*propertyCountOutput = 0;
+	return XR_SUCCESS;
+}
+
+static const char *const xrmock_extensions[] = {
+	XR_KHR_OPENGL_ENABLE_EXTENSION_NAME,
+#ifdef XR_KHR_locate_spaces
+	XR_KHR_LOCATE_SPACES_EXTENSION_NAME,
+#endif
+#ifdef XR_MNDX_egl_enable
+	XR_MNDX_EGL_ENABLE_EXTENSION_NAME,
+#endif
+};
+#define XRMOCK_EXTENSION_COUNT \
+	(uint32_t)(sizeof(xrmock_extensions) / sizeof(*xrmock_extensions))
+
+XrResult xrEnumerateInstanceExtensionProperties(const char *layerName,
+                                                uint32_t propertyCapacityInput,
+                                                uint32_t *propertyCountOutput,
+                                                XrExtensionProperties *properties)
+{
+	(void)layerName;
+	*propertyCountOutput = XRMOCK_EXTENSION_COUNT;
+	if (!propertyCapacityInput)
+		return XR_SUCCESS;
+	if (propertyCapacityInput < XRMOCK_EXTENSION_COUNT)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	for (uint32_t i = 0; i < XRMOCK_EXTENSION_COUNT; i++)
+	{
+		snprintf(properties[i].extensionName, sizeof(properties[i].extensionName),
+		         "%s", xrmock_extensions[i]);
+		properties[i].extensionVersion = 1;
+	}
+	return XR_SUCCESS;
+}
+
+XrResult xrCreateInstance(const XrInstanceCreateInfo *createInfo,
+                          XrInstance *instance)
+{
+	if (createInfo->enabledApiLayerCount)
+		return XR_ERROR_API_LAYER_NOT_PRESENT;
+
+	pthread_mutex_lock(&mock.lock);
+	if (!mock.configured)
+	{
+		xrmock_default_config(&mock.config);
+		mock.configured = XR_TRUE;
+	}
+	mock.instance = XR_TRUE;
+	mock.path_count = 0;
+	mock.display_time = XRMOCK_EPOCH;
+	mock.sync_time = XRMOCK_EPOCH;
+	memset(&mock.counters, 0, sizeof(mock.counters));
+	pthread_mutex_unlock(&mock.lock);
+
+	*instance = XRMOCK_HANDLE(XrInstance, &mock.instance);
+	return XR_SUCCESS;
+}
+
+XrResult xrDestroyInstance(XrInstance instance)
+{
+	if (instance == XR_NULL_HANDLE)
+		return XR_ERROR_HANDLE_INVALID;
+	mock.instance = XR_FALSE;
+	return XR_SUCCESS;
+}
+
+XrResult xrGetInstanceProperties(XrInstance instance,
+                                 XrInstanceProperties *instanceProperties)
+{
+	(void)instance;
+	instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+	snprintf(instanceProperties->runtimeName,
+	         sizeof(instanceProperties->runtimeName), "%s", XRMOCK_NAME);
+	return XR_SUCCESS;
+}
+
+XrResult xrResultToString(XrInstance instance, XrResult value,
+                          char buffer[XR_MAX_RESULT_STRING_SIZE])
+{
+	(void)instance;
+	switch (value)
+	{
+	case XR_SUCCESS: snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_SUCCESS"); break;
+	case XR_EVENT_UNAVAILABLE: snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_EVENT_UNAVAILABLE"); break;
+	case XR_SESSION_NOT_FOCUSED: snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_SESSION_NOT_FOCUSED"); break;
+	default: snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_RESULT_%d", (int)value); break;
+	}
+	return XR_SUCCESS;
+}
+
+XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo *getInfo,
+                     XrSystemId *systemId)
+{
+	(void)instance;
+	if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY)
+		return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+	*systemId = 1;
+	return XR_SUCCESS;
+}
+
+XrResult xrGetSystemProperties(XrInstance instance, XrSystemId systemId,
+                               XrSystemProperties *properties)
+{
+	(void)instance;
+	properties->systemId = systemId;
+	properties->vendorId = 0;
+	snprintf(properties->systemName, sizeof(properties->systemName), "%s",
+	         XRMOCK_NAME);
+	properties->graphicsProperties.maxSwapchainImageWidth = 4096;
+	properties->graphicsProperties.maxSwapchainImageHeight = 4096;
+	properties->graphicsProperties.maxLayerCount = XR_MIN_COMPOSITION_LAYERS_SUPPORTED;
+	properties->trackingProperties.orientationTracking = XR_TRUE;
+	properties->trackingProperties.positionTracking = XR_TRUE;
+	return XR_SUCCESS;
+}
+
+XrResult xrEnumerateViewConfigurations(XrInstance instance, XrSystemId systemId,
+                                       uint32_t viewConfigurationTypeCapacityInput,
+                                       uint32_t *viewConfigurationTypeCountOutput,
+                                       XrViewConfigurationType *viewConfigurationTypes)
+{
+	(void)instance;
+	(void)systemId;
+	*viewConfigurationTypeCountOutput = 1;
+	if (viewConfigurationTypeCapacityInput)
+		viewConfigurationTypes[0] = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+	return XR_SUCCESS;
+}
+
+XrResult xrEnumerateViewConfigurationViews(XrInstance instance, XrSystemId systemId,
+                                           XrViewConfigurationType viewConfigurationType,
+                                           uint32_t viewCapacityInput,
+                                           uint32_t *viewCountOutput,
+                                           XrViewConfigurationView *views)
+{
+	(void)instance;
+	(void)systemId;
+	if (viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+		return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+	*viewCountOutput = XRMOCK_VIEWS;
+	if (!viewCapacityInput)
+		return XR_SUCCESS;
+	if (viewCapacityInput < XRMOCK_VIEWS)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	for (uint32_t i = 0; i < XRMOCK_VIEWS; i++)
+	{
+		views[i].recommendedImageRectWidth = mock.config.width;
+		views[i].recommendedImageRectHeight = mock.config.height;
+		views[i].maxImageRectWidth = mock.config.width * 2;
+		views[i].maxImageRectHeight = mock.config.height * 2;
+		views[i].recommendedSwapchainSampleCount = 1;
+		views[i].maxSwapchainSampleCount = 1;
+	}
+	return XR_SUCCESS;
+}
+
+XrResult xrEnumerateEnvironmentBlendModes(XrInstance instance, XrSystemId systemId,
+                                          XrViewConfigurationType viewConfigurationType,
+                                          uint32_t environmentBlendModeCapacityInput,
+                                          uint32_t *environmentBlendModeCountOutput,
+                                          XrEnvironmentBlendMode *environmentBlendModes)
+{
+	(void)instance;
+	(void)systemId;
+	(void)viewConfigurationType;
+	*environmentBlendModeCountOutput = 1;
+	if (environmentBlendModeCapacityInput)
+		environmentBlendModes[0] = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+	return XR_SUCCESS;
+}
+
+static XrResult xrmock_graphics_requirements(XrInstance instance, XrSystemId systemId,
+                                             XrGraphicsRequirementsOpenGLKHR *requirements)
+{
+	(void)instance;
+	(void)systemId;
+	requirements->minApiVersionSupported = XR_MAKE_VERSION(3, 3, 0);
+	requirements->maxApiVersionSupported = XR_MAKE_VERSION(4, 6, 0);
+	return XR_SUCCESS;
+}
+
+#ifdef XR_KHR_locate_spaces
+static XrResult xrmock_locate_spaces(XrSession session,
+                                     const XrSpacesLocateInfoKHR *locateInfo,
+                                     XrSpaceLocationsKHR *spaceLocations);
+#endif
+
+XrResult xrGetInstanceProcAddr(XrInstance instance, const char *name,
+                               PFN_xrVoidFunction *function)
+{
+	(void)instance;
+	*function = NULL;
+	if (!strcmp(name, "xrGetOpenGLGraphicsRequirementsKHR"))
+		*function = (PFN_xrVoidFunction)xrmock_graphics_requirements;
+#ifdef XR_KHR_locate_spaces
+	else if (!strcmp(name, "xrLocateSpacesKHR"))
+		*function = (PFN_xrVoidFunction)xrmock_locate_spaces;
+#endif
+	return *function ? XR_SUCCESS : XR_ERROR_FUNCTION_UNSUPPORTED;
+}
+
+/* ------------------------------------------------------------------------ */
+/* paths */
+
+XrResult xrStringToPath(XrInstance instance, const char *pathString,
+                        XrPath *path)
+{
+	(void)instance;
+	if (!pathString[0] || pathString[0] != '/'
+	    || strlen(pathString) >= XRMOCK_PATH_SIZE)
+		return XR_ERROR_PATH_FORMAT_INVALID;
+
+	pthread_mutex_lock(&mock.lock);
+	for (uint32_t i = 0; i < mock.path_count; i++)
+	{
+		if (!strcmp(mock.paths[i], pathString))
+		{
+			pthread_mutex_unlock(&mock.lock);
+			*path = i + 1;
+			return XR_SUCCESS;
+		}
+	}
+	if (mock.path_count == XRMOCK_MAX_PATHS)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_PATH_COUNT_EXCEEDED;
+	}
+	snprintf(mock.paths[mock.path_count], XRMOCK_PATH_SIZE, "%s", pathString);
+	*path = ++mock.path_count;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+static const char *xrmock_path(XrPath path)
+{
+	return path && path <= mock.path_count ? mock.paths[path - 1] : "";
+}
+
+XrResult xrPathToString(XrInstance instance, XrPath path, uint32_t bufferCapacityInput,
+                        uint32_t *bufferCountOutput, char *buffer)
+{
+	(void)instance;
+	if (!path || path > mock.path_count)
+		return XR_ERROR_PATH_INVALID;
+	const char *string = xrmock_path(path);
+	*bufferCountOutput = (uint32_t)strlen(string) + 1;
+	if (!bufferCapacityInput)
+		return XR_SUCCESS;
+	if (bufferCapacityInput < *bufferCountOutput)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	memcpy(buffer, string, *bufferCountOutput);
+	return XR_SUCCESS;
+}
+
+/* Top level user path of an input path, "/user/hand/left/input/x" gives
+ * "/user/hand/left". */
+static void xrmock_user_path(const char *binding, char *out)
+{
+	const char *input = strstr(binding, "/input/");
+	const char *output = strstr(binding, "/output/");
+	const char *end = input ? input : output;
+	size_t length = end ? (size_t)(end - binding) : strlen(binding);
+	if (length >= XRMOCK_PATH_SIZE)
+		length = XRMOCK_PATH_SIZE - 1;
+	memcpy(out, binding, length);
+	out[length] = '\0';
+}
+
+/* ------------------------------------------------------------------------ */
+/* session */
+
+XrResult xrCreateSession(XrInstance instance, const XrSessionCreateInfo *createInfo,
+                         XrSession *session)
+{
+	(void)instance;
+	(void)createInfo;
+	pthread_mutex_lock(&mock.lock);
+	if (mock.session)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_LIMIT_REACHED;
+	}
+	mock.session = XR_TRUE;
+	mock.running = XR_FALSE;
+	mock.event_head = mock.event_count = 0;
+	mock.state = XR_SESSION_STATE_UNKNOWN;
+	memset(mock.actions, 0, sizeof(mock.actions));
+	memset(mock.spaces, 0, sizeof(mock.spaces));
+	xrmock_push_state(XR_SESSION_STATE_IDLE);
+	xrmock_push_state(XR_SESSION_STATE_READY);
+	pthread_mutex_unlock(&mock.lock);
+	*session = XRMOCK_HANDLE(XrSession, &mock.session);
+	return XR_SUCCESS;
+}
+
+XrResult xrDestroySession(XrSession session)
+{
+	if (session == XR_NULL_HANDLE)
+		return XR_ERROR_HANDLE_INVALID;
+	pthread_mutex_lock(&mock.lock);
+	mock.session = XR_FALSE;
+	mock.running = XR_FALSE;
+	mock.event_count = 0;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+XrResult xrBeginSession(XrSession session, const XrSessionBeginInfo *beginInfo)
+{
+	(void)session;
+	if (beginInfo->primaryViewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+		return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+	pthread_mutex_lock(&mock.lock);
+	if (mock.running)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_SESSION_RUNNING;
+	}
+	mock.running = XR_TRUE;
+	mock.wall_start = xrmock_now();
+	xrmock_push_state(XR_SESSION_STATE_SYNCHRONIZED);
+	xrmock_push_state(XR_SESSION_STATE_VISIBLE);
+	xrmock_push_state(XR_SESSION_STATE_FOCUSED);
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+XrResult xrEndSession(XrSession session)
+{
+	(void)session;
+	pthread_mutex_lock(&mock.lock);
+	if (!mock.running)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_SESSION_NOT_RUNNING;
+	}
+	mock.running = XR_FALSE;
+	xrmock_push_state(XR_SESSION_STATE_IDLE);
+	xrmock_push_state(XR_SESSION_STATE_EXITING);
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------ */
+/* frames */
+
+XrResult xrWaitFrame(XrSession session, const XrFrameWaitInfo *frameWaitInfo,
+                     XrFrameState *frameState)
+{
+	(void)session;
+	(void)frameWaitInfo;
+	pthread_mutex_lock(&mock.lock);
+	if (!mock.running)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_SESSION_NOT_RUNNING;
+	}
+	const uint64_t frame = mock.counters.frames_waited++;
+	const XrDuration period = mock.config.display_period;
+	const XrBool32 throttle = mock.config.throttle;
+	const uint64_t release = mock.wall_start + frame * (uint64_t)period;
+	mock.display_time = XRMOCK_EPOCH + (XrTime)(frame + 1) * period;
+	frameState->predictedDisplayTime = mock.display_time;
+	frameState->predictedDisplayPeriod = period;
+	frameState->shouldRender = mock.state == XR_SESSION_STATE_VISIBLE
+	                        || mock.state == XR_SESSION_STATE_FOCUSED;
+	pthread_mutex_unlock(&mock.lock);
+
+	if (throttle)
+	{
+		uint64_t now = xrmock_now();
+		while (now < release)
+		{
+			const uint64_t left = release - now;
+			struct timespec ts = {(time_t)(left / 1000000000ull),
+			                      (long)(left % 1000000000ull)};
+			nanosleep(&ts, NULL);
+			now = xrmock_now();
+		}
+	}
+	return XR_SUCCESS;
+}
+
+XrResult xrBeginFrame(XrSession session, const XrFrameBeginInfo *frameBeginInfo)
+{
+	(void)session;
+	(void)frameBeginInfo;
+	pthread_mutex_lock(&mock.lock);
+	const XrBool32 discarded = mock.counters.frames_begun > mock.counters.frames_ended;
+	if (mock.counters.frames_begun >= mock.counters.frames_waited)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_CALL_ORDER_INVALID;
+	}
+	mock.counters.frames_begun++;
+	if (discarded)
+		mock.counters.frames_ended++;
+	pthread_mutex_unlock(&mock.lock);
+	return discarded ? XR_FRAME_DISCARDED : XR_SUCCESS;
+}
+
+XrResult xrEndFrame(XrSession session, const XrFrameEndInfo *frameEndInfo)
+{
+	(void)session;
+	if (frameEndInfo->environmentBlendMode != XR_ENVIRONMENT_BLEND_MODE_OPAQUE)
+		return XR_ERROR_ENVIRONMENT_BLEND_MODE_UNSUPPORTED;
+	if (frameEndInfo->displayTime <= 0)
+		return XR_ERROR_TIME_INVALID;
+	pthread_mutex_lock(&mock.lock);
+	if (mock.counters.frames_ended >= mock.counters.frames_begun)
+	{
+		pthread_mutex_unlock(&mock.lock);
+		return XR_ERROR_CALL_ORDER_INVALID;
+	}
+	mock.counters.frames_ended++;
+	mock.counters.layers += frameEndInfo->layerCount;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------ */
+/* swapchains */
+
+XrResult xrEnumerateSwapchainFormats(XrSession session, uint32_t formatCapacityInput,
+                                     uint32_t *formatCountOutput, int64_t *formats)
+{
+	static const int64_t supported[] = {GL_SRGB8_ALPHA8, GL_RGBA8, GL_RGBA16F};
+	const uint32_t count = sizeof(supported) / sizeof(*supported);
+	(void)session;
+	*formatCountOutput = count;
+	if (!formatCapacityInput)
+		return XR_SUCCESS;
+	if (formatCapacityInput < count)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	memcpy(formats, supported, sizeof(supported));
+	return XR_SUCCESS;
+}
+
+XrResult xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo *createInfo,
+                           XrSwapchain *swapchain)
+{
+	struct xrmock_swapchain *self = NULL;
+	(void)session;
+	for (uint32_t i = 0; i < XRMOCK_MAX_SWAPCHAINS && !self; i++)
+	{
+		if (!mock.swapchains[i].used)
+			self = &mock.swapchains[i];
+	}
+	if (!self)
+		return XR_ERROR_LIMIT_REACHED;
+	if (!createInfo->width || !createInfo->height || !createInfo->arraySize)
+		return XR_ERROR_VALIDATION_FAILURE;
+
+	const GLenum target = createInfo->arraySize > 1 ? GL_TEXTURE_2D_ARRAY
+	                                                : GL_TEXTURE_2D;
+	const GLsizei levels = createInfo->mipCount ? createInfo->mipCount : 1;
+	glGenTextures(XRMOCK_IMAGES, self->images);
+	for (uint32_t i = 0; i < XRMOCK_IMAGES; i++)
+	{
+		glBindTexture(target, self->images[i]);
+		if (target == GL_TEXTURE_2D_ARRAY)
+			glTexStorage3D(target, levels, (GLenum)createInfo->format,
+			               createInfo->width, createInfo->height,
+			               createInfo->arraySize);
+		else
+			glTexStorage2D(target, levels, (GLenum)createInfo->format,
+			               createInfo->width, createInfo->height);
+	}
+	glBindTexture(target, 0);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		glDeleteTextures(XRMOCK_IMAGES, self->images);
+		return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+	}
+	self->used = XR_TRUE;
+	self->next = 0;
+	*swapchain = XRMOCK_HANDLE(XrSwapchain, self);
+	return XR_SUCCESS;
+}
+
+XrResult xrDestroySwapchain(XrSwapchain swapchain)
+{
+	struct xrmock_swapchain *self = XRMOCK_PTR(struct xrmock_swapchain, swapchain);
+	if (!self || !self->used)
+		return XR_ERROR_HANDLE_INVALID;
+	glDeleteTextures(XRMOCK_IMAGES, self->images);
+	self->used = XR_FALSE;
+	return XR_SUCCESS;
+}
+
+XrResult xrEnumerateSwapchainImages(XrSwapchain swapchain, uint32_t imageCapacityInput,
+                                    uint32_t *imageCountOutput,
+                                    XrSwapchainImageBaseHeader *images)
+{
+	struct xrmock_swapchain *self = XRMOCK_PTR(struct xrmock_swapchain, swapchain);
+	*imageCountOutput = XRMOCK_IMAGES;
+	if (!imageCapacityInput)
+		return XR_SUCCESS;
+	if (imageCapacityInput < XRMOCK_IMAGES)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	XrSwapchainImageOpenGLKHR *gl_images = (XrSwapchainImageOpenGLKHR*)images;
+	for (uint32_t i = 0; i < XRMOCK_IMAGES; i++)
+		gl_images[i].image = self->images[i];
+	return XR_SUCCESS;
+}
+
+XrResult xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                 const XrSwapchainImageAcquireInfo *acquireInfo,
+                                 uint32_t *index)
+{
+	struct xrmock_swapchain *self = XRMOCK_PTR(struct xrmock_swapchain, swapchain);
+	(void)acquireInfo;
+	*index = self->next;
+	self->next = (self->next + 1) % XRMOCK_IMAGES;
+	return XR_SUCCESS;
+}
+
+XrResult xrWaitSwapchainImage(XrSwapchain swapchain,
+                              const XrSwapchainImageWaitInfo *waitInfo)
+{
+	(void)swapchain;
+	(void)waitInfo;
+	return XR_SUCCESS;
+}
+
+XrResult xrReleaseSwapchainImage(XrSwapchain swapchain,
+                                 const XrSwapchainImageReleaseInfo *releaseInfo)
+{
+	(void)swapchain;
+	(void)releaseInfo;
+	return XR_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------ */
+/* spaces */
+
+static XrQuaternionf xrmock_quat_mul(XrQuaternionf a, XrQuaternionf b)
+{
+	XrQuaternionf q = {
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+	};
+	return q;
+}
+
+static XrVector3f xrmock_rotate(XrQuaternionf q, XrVector3f v)
+{
+	const XrQuaternionf p = {v.x, v.y, v.z, 0.0f};
+	const XrQuaternionf inv = {-q.x, -q.y, -q.z, q.w};
+	const XrQuaternionf r = xrmock_quat_mul(xrmock_quat_mul(q, p), inv);
+	XrVector3f out = {r.x, r.y, r.z};
+	return out;
+}
+
+static XrPosef xrmock_pose_mul(XrPosef a, XrPosef b)
+{
+	XrPosef out;
+	const XrVector3f t = xrmock_rotate(a.orientation, b.position);
+	out.orientation = xrmock_quat_mul(a.orientation, b.orientation);
+	out.position.x = a.position.x + t.x;
+	out.position.y = a.position.y + t.y;
+	out.position.z = a.position.z + t.z;
+	return out;
+}
+
+static XrPosef xrmock_pose_invert(XrPosef a)
+{
+	XrPosef out;
+	out.orientation.x = -a.orientation.x;
+	out.orientation.y = -a.orientation.y;
+	out.orientation.z = -a.orientation.z;
+	out.orientation.w = a.orientation.w;
+	out.position = xrmock_rotate(out.orientation, a.position);
+	out.position.x = -out.position.x;
+	out.position.y = -out.position.y;
+	out.position.z = -out.position.z;
+	return out;
+}
+
+/* Pose of a space in the local space, stage and local coincide. */
+static XrBool32 xrmock_space_pose(const struct xrmock_space *space, XrTime time,
+                                  XrPosef *pose)
+{
+	const struct xrmock_script *script = mock.config.script;
+	XrPosef origin = xrmock_identity;
+
+	switch (space->kind)
+	{
+	case XRMOCK_SPACE_REFERENCE:
+		if (space->reference == XR_REFERENCE_SPACE_TYPE_VIEW
+		    && !script->pose(script->user, time, "/user/head", &origin))
+			return XR_FALSE;
+		break;
+	case XRMOCK_SPACE_ACTION:
+		if (!script->pose(script->user, time, space->path, &origin))
+			return XR_FALSE;
+		break;
+	default:
+		return XR_FALSE;
+	}
+	*pose = xrmock_pose_mul(origin, space->offset);
+	return XR_TRUE;
+}
+
+static XrBool32 xrmock_locate(XrSpace space, XrSpace baseSpace, XrTime time,
+                              XrPosef *pose, XrVector3f *linear)
+{
+	const struct xrmock_space *self = XRMOCK_PTR(struct xrmock_space, space);
+	const struct xrmock_space *base = XRMOCK_PTR(struct xrmock_space, baseSpace);
+	XrPosef world, origin, later;
+
+	if (!self || !base || !xrmock_space_pose(self, time, &world)
+	    || !xrmock_space_pose(base, time, &origin))
+		return XR_FALSE;
+	*pose = xrmock_pose_mul(xrmock_pose_invert(origin), world);
+	if (linear)
+	{
+		/* finite difference over a millisecond of the script */
+		const XrTime dt = 1000000;
+		if (!xrmock_space_pose(self, time + dt, &later)
+		    || !xrmock_space_pose(base, time + dt, &origin))
+			return XR_FALSE;
+		later = xrmock_pose_mul(xrmock_pose_invert(origin), later);
+		linear->x = (later.position.x - pose->position.x) * 1000.0f;
+		linear->y = (later.position.y - pose->position.y) * 1000.0f;
+		linear->z = (later.position.z - pose->position.z) * 1000.0f;
+	}
+	return XR_TRUE;
+}
+
+static const XrSpaceLocationFlags xrmock_located =
+	XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT
+	| XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+
+static struct xrmock_space *xrmock_space_alloc(void)
+{
+	for (uint32_t i = 0; i < XRMOCK_MAX_SPACES; i++)
+	{
+		if (mock.spaces[i].kind == XRMOCK_SPACE_FREE)
+			return &mock.spaces[i];
+	}
+	return NULL;
+}
+
+XrResult xrEnumerateReferenceSpaces(XrSession session, uint32_t spaceCapacityInput,
+                                    uint32_t *spaceCountOutput,
+                                    XrReferenceSpaceType *spaces)
+{
+	static const XrReferenceSpaceType supported[] = {
+		XR_REFERENCE_SPACE_TYPE_VIEW, XR_REFERENCE_SPACE_TYPE_LOCAL,
+		XR_REFERENCE_SPACE_TYPE_STAGE
+	};
+	const uint32_t count = sizeof(supported) / sizeof(*supported);
+	(void)session;
+	*spaceCountOutput = count;
+	if (!spaceCapacityInput)
+		return XR_SUCCESS;
+	if (spaceCapacityInput < count)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+	memcpy(spaces, supported, sizeof(supported));
+	return XR_SUCCESS;
+}
+
+XrResult xrCreateReferenceSpace(XrSession session,
+                                const XrReferenceSpaceCreateInfo *createInfo,
+                                XrSpace *space)
+{
+	(void)session;
+	pthread_mutex_lock(&mock.lock);
+	struct xrmock_space *self = xrmock_space_alloc();
+	if (self)
+	{
+		self->kind = XRMOCK_SPACE_REFERENCE;
+		self->reference = createInfo->referenceSpaceType;
+		self->offset = createInfo->poseInReferenceSpace;
+	}
+	pthread_mutex_unlock(&mock.lock);
+	if (!self)
+		return XR_ERROR_LIMIT_REACHED;
+	*space = XRMOCK_HANDLE(XrSpace, self);
+	return XR_SUCCESS;
+}
+
+XrResult xrCreateActionSpace(XrSession session,
+                             const XrActionSpaceCreateInfo *createInfo,
+                             XrSpace *space)
+{
+	const struct xrmock_action *action =
+		XRMOCK_PTR(struct xrmock_action, createInfo->action);
+	const char *binding = NULL;
+	(void)session;
+
+	if (!action || action->type != XR_ACTION_TYPE_POSE_INPUT)
+		return XR_ERROR_ACTION_TYPE_MISMATCH;
+	pthread_mutex_lock(&mock.lock);
+	for (uint32_t i = 0; i < action->binding_count && !binding; i++)
+	{
+		const char *candidate = xrmock_path(action->bindings[i]);
+		if (createInfo->subactionPath == XR_NULL_PATH
+		    || !strncmp(candidate, xrmock_path(createInfo->subactionPath),
+		                strlen(xrmock_path(createInfo->subactionPath))))
+			binding = candidate;
+	}
+	struct xrmock_space *self = xrmock_space_alloc();
+	if (self)
+	{
+		self->kind = XRMOCK_SPACE_ACTION;
+		self->offset = createInfo->poseInActionSpace;
+		/* unbound pose actions follow the subaction path itself */
+		xrmock_user_path(binding ? binding : xrmock_path(createInfo->subactionPath),
+		                 self->path);
+	}
+	pthread_mutex_unlock(&mock.lock);
+	if (!self)
+		return XR_ERROR_LIMIT_REACHED;
+	*space = XRMOCK_HANDLE(XrSpace, self);
+	return XR_SUCCESS;
+}
+
+XrResult xrDestroySpace(XrSpace space)
+{
+	struct xrmock_space *self = XRMOCK_PTR(struct xrmock_space, space);
+	if (!self)
+		return XR_ERROR_HANDLE_INVALID;
+	pthread_mutex_lock(&mock.lock);
+	self->kind = XRMOCK_SPACE_FREE;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+XrResult xrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time,
+                       XrSpaceLocation *location)
+{
+	XrSpaceVelocity *velocity = location->next;
+	XrVector3f linear = {0.0f, 0.0f, 0.0f};
+	const XrBool32 chained = velocity && velocity->type == XR_TYPE_SPACE_VELOCITY;
+
+	location->locationFlags = 0;
+	if (!xrmock_locate(space, baseSpace, time, &location->pose,
+	                   chained ? &linear : NULL))
+		return XR_SUCCESS;
+	location->locationFlags = xrmock_located;
+	if (chained)
+	{
+		velocity->velocityFlags = XR_SPACE_VELOCITY_LINEAR_VALID_BIT
+		                        | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT;
+		velocity->linearVelocity = linear;
+		velocity->angularVelocity.x = 0.0f;
+		velocity->angularVelocity.y = 0.0f;
+		velocity->angularVelocity.z = 0.0f;
+	}
+	return XR_SUCCESS;
+}
+
+#ifdef XR_KHR_locate_spaces
+static XrResult xrmock_locate_spaces(XrSession session,
+                                     const XrSpacesLocateInfoKHR *locateInfo,
+                                     XrSpaceLocationsKHR *spaceLocations)
+{
+	XrSpaceVelocitiesKHR *velocities = spaceLocations->next;
+	(void)session;
+	if (velocities && velocities->type != XR_TYPE_SPACE_VELOCITIES_KHR)
+		velocities = NULL;
+	if (spaceLocations->locationCount < locateInfo->spaceCount)
+		return XR_ERROR_VALIDATION_FAILURE;
+
+	for (uint32_t i = 0; i < locateInfo->spaceCount; i++)
+	{
+		XrSpaceLocationDataKHR *location = &spaceLocations->locations[i];
+		XrVector3f linear = {0.0f, 0.0f, 0.0f};
+		const XrBool32 found = xrmock_locate(locateInfo->spaces[i],
+		                                     locateInfo->baseSpace, locateInfo->time,
+		                                     &location->pose,
+		                                     velocities ? &linear : NULL);
+		location->locationFlags = found ? xrmock_located : 0;
+		if (velocities)
+		{
+			XrSpaceVelocityDataKHR *velocity = &velocities->velocities[i];
+			velocity->velocityFlags = found ? XR_SPACE_VELOCITY_LINEAR_VALID_BIT
+			                                  | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT
+			                                : 0;
+			velocity->linearVelocity = linear;
+			velocity->angularVelocity.x = 0.0f;
+			velocity->angularVelocity.y = 0.0f;
+			velocity->angularVelocity.z = 0.0f;
+		}
+	}
+	return XR_SUCCESS;
+}
+#endif
+
+XrResult xrLocateViews(XrSession session, const XrViewLocateInfo *viewLocateInfo,
+                       XrViewState *viewState, uint32_t viewCapacityInput,
+                       uint32_t *viewCountOutput, XrView *views)
+{
+	const struct xrmock_space *base = XRMOCK_PTR(struct xrmock_space,
+	                                             viewLocateInfo->space);
+	const struct xrmock_script *script = mock.config.script;
+	XrPosef head, origin;
+	(void)session;
+
+	*viewCountOutput = XRMOCK_VIEWS;
+	if (!viewCapacityInput)
+		return XR_SUCCESS;
+	if (viewCapacityInput < XRMOCK_VIEWS)
+		return XR_ERROR_SIZE_INSUFFICIENT;
+
+	viewState->viewStateFlags = 0;
+	if (!base || !script->pose(script->user, viewLocateInfo->displayTime,
+	                           "/user/head", &head)
+	    || !xrmock_space_pose(base, viewLocateInfo->displayTime, &origin))
+		return XR_SUCCESS;
+	head = xrmock_pose_mul(xrmock_pose_invert(origin), head);
+	viewState->viewStateFlags = xrmock_located;
+
+	for (uint32_t i = 0; i < XRMOCK_VIEWS; i++)
+	{
+		XrPosef eye = xrmock_identity;
+		eye.position.x = (i == 0 ? -0.5f : 0.5f) * mock.config.ipd;
+		views[i].pose = xrmock_pose_mul(head, eye);
+		views[i].fov.angleLeft = -mock.config.fov;
+		views[i].fov.angleRight = mock.config.fov;
+		views[i].fov.angleUp = mock.config.fov;
+		views[i].fov.angleDown = -mock.config.fov;
+	}
+	return XR_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------ */
+/* actions */
+
+XrResult xrCreateActionSet(XrInstance instance,
+                           const XrActionSetCreateInfo *createInfo,
+                           XrActionSet *actionSet)
+{
+	(void)instance;
+	(void)createInfo;
+	*actionSet = XRMOCK_HANDLE(XrActionSet, &mock.actions);
+	return XR_SUCCESS;
+}
+
+XrResult xrDestroyActionSet(XrActionSet actionSet)
+{
+	(void)actionSet;
+	return XR_SUCCESS;
+}
+
+XrResult xrCreateAction(XrActionSet actionSet, const XrActionCreateInfo *createInfo,
+                        XrAction *action)
+{
+	struct xrmock_action *self = NULL;
+	(void)actionSet;
+	pthread_mutex_lock(&mock.lock);
+	for (uint32_t i = 0; i < XRMOCK_MAX_ACTIONS; i++)
+	{
+		if (mock.actions[i].used && !strcmp(mock.actions[i].name, createInfo->actionName))
+		{
+			pthread_mutex_unlock(&mock.lock);
+			return XR_ERROR_NAME_DUPLICATED;
+		}
+		if (!self && !mock.actions[i].used)
+			self = &mock.actions[i];
+	}
+	if (self)
+	{
+		memset(self, 0, sizeof(*self));
+		self->used = XR_TRUE;
+		self->type = createInfo->actionType;
+		snprintf(self->name, sizeof(self->name), "%s", createInfo->actionName);
+	}
+	pthread_mutex_unlock(&mock.lock);
+	if (!self)
+		return XR_ERROR_LIMIT_REACHED;
+	*action = XRMOCK_HANDLE(XrAction, self);
+	return XR_SUCCESS;
+}
+
+XrResult xrDestroyAction(XrAction action)
+{
+	struct xrmock_action *self = XRMOCK_PTR(struct xrmock_action, action);
+	if (!self)
+		return XR_ERROR_HANDLE_INVALID;
+	self->used = XR_FALSE;
+	return XR_SUCCESS;
+}
+
+XrResult xrSuggestInteractionProfileBindings(XrInstance instance,
+		const XrInteractionProfileSuggestedBinding *suggestedBindings)
+{
+	(void)instance;
+	pthread_mutex_lock(&mock.lock);
+	for (uint32_t i = 0; i < suggestedBindings->countSuggestedBindings; i++)
+	{
+		const XrActionSuggestedBinding *binding = &suggestedBindings->suggestedBindings[i];
+		struct xrmock_action *action = XRMOCK_PTR(struct xrmock_action, binding->action);
+		if (!action || !action->used)
+		{
+			pthread_mutex_unlock(&mock.lock);
+			return XR_ERROR_HANDLE_INVALID;
+		}
+		if (action->binding_count < XRMOCK_MAX_BINDINGS)
+			action->bindings[action->binding_count++] = binding->binding;
+	}
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+XrResult xrAttachSessionActionSets(XrSession session,
+                                   const XrSessionActionSetsAttachInfo *attachInfo)
+{
+	(void)session;
+	(void)attachInfo;
+	return XR_SUCCESS;
+}
+
+XrResult xrSyncActions(XrSession session, const XrActionsSyncInfo *syncInfo)
+{
+	(void)session;
+	(void)syncInfo;
+	pthread_mutex_lock(&mock.lock);
+	mock.counters.syncs++;
+	mock.sync_time = mock.display_time;
+	const XrBool32 focused = mock.state == XR_SESSION_STATE_FOCUSED;
+	pthread_mutex_unlock(&mock.lock);
+	return focused ? XR_SUCCESS : XR_SESSION_NOT_FOCUSED;
+}
+
+/* Script value of the binding of an action matching the subaction path. */
+static XrBool32 xrmock_action_value(const XrActionStateGetInfo *getInfo,
+                                    XrActionType type, float *value,
+                                    XrBool32 *changed)
+{
+	struct xrmock_action *action = XRMOCK_PTR(struct xrmock_action,
+	                                          getInfo->action);
+	const struct xrmock_script *script = mock.config.script;
+	const char *subaction = xrmock_path(getInfo->subactionPath);
+
+	if (!action || action->type != type)
+		return XR_FALSE;
+	for (uint32_t i = 0; i < action->binding_count; i++)
+	{
+		const char *binding = xrmock_path(action->bindings[i]);
+		if (getInfo->subactionPath == XR_NULL_PATH
+		    || !strncmp(binding, subaction, strlen(subaction)))
+		{
+			*value = script->value(script->user, mock.sync_time, binding);
+			*changed = *value != action->last;
+			action->last = *value;
+			return XR_TRUE;
+		}
+	}
+	return XR_FALSE;
+}
+
+XrResult xrGetActionStateFloat(XrSession session, const XrActionStateGetInfo *getInfo,
+                               XrActionStateFloat *state)
+{
+	float value = 0.0f;
+	XrBool32 changed = XR_FALSE;
+	(void)session;
+	state->isActive = xrmock_action_value(getInfo, XR_ACTION_TYPE_FLOAT_INPUT,
+	                                      &value, &changed);
+	state->changedSinceLastSync = changed;
+	state->currentState = value;
+	state->lastChangeTime = mock.sync_time;
+	return XR_SUCCESS;
+}
+
+XrResult xrGetActionStateBoolean(XrSession session, const XrActionStateGetInfo *getInfo,
+                                 XrActionStateBoolean *state)
+{
+	float value = 0.0f;
+	XrBool32 changed = XR_FALSE;
+	(void)session;
+	state->isActive = xrmock_action_value(getInfo, XR_ACTION_TYPE_BOOLEAN_INPUT,
+	                                      &value, &changed);
+	state->changedSinceLastSync = changed;
+	state->currentState = value > 0.5f;
+	state->lastChangeTime = mock.sync_time;
+	return XR_SUCCESS;
+}
+
+XrResult xrApplyHapticFeedback(XrSession session,
+                               const XrHapticActionInfo *hapticActionInfo,
+                               const XrHapticBaseHeader *hapticFeedback)
+{
+	(void)session;
+	(void)hapticActionInfo;
+	(void)hapticFeedback;
+	pthread_mutex_lock(&mock.lock);
+	mock.counters.haptics++;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
+
+XrResult xrStopHapticFeedback(XrSession session,
+                              const XrHapticActionInfo *hapticActionInfo)
+{
+	(void)session;
+	(void)hapticActionInfo;
+	pthread_mutex_lock(&mock.lock);
+	mock.counters.haptics++;
+	pthread_mutex_unlock(&mock.lock);
+	return XR_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#ifndef XRMOCK_H
+#define XRMOCK_H
+
+#include <openxr/openxr.h>
+
+/* A fake OpenXR runtime linked in place of the loader. It implements the
+ * entry points the plugin uses with a deterministic clock: display times
+ * advance by exactly one display period per xrWaitFrame, so two runs see
+ * the same poses and action values frame by frame. Swapchain images are
+ * plain GL textures of the current context. */
+
+/* Poses and action values as functions of the predicted display time.
+ * path is a top level user path, "/user/head" or "/user/hand/left", and
+ * binding the full input path an action was suggested for. */
+struct xrmock_script
+{
+	XrBool32 (*pose)(void *user, XrTime time, const char *path, XrPosef *pose);
+	float (*value)(void *user, XrTime time, const char *binding);
+	void *user;
+};
+
+struct xrmock_config
+{
+	/* nanoseconds between predicted display times */
+	XrDuration display_period;
+	/* recommended size of each view */
+	uint32_t width;
+	uint32_t height;
+	/* sleep in xrWaitFrame to keep the display period in real time,
+	 * otherwise frames are released as fast as they are submitted */
+	XrBool32 throttle;
+	float ipd;
+	/* half angle of the symmetric field of view, radians */
+	float fov;
+	const struct xrmock_script *script;
+};
+
+struct xrmock_counters
+{
+	uint64_t frames_waited;
+	uint64_t frames_begun;
+	uint64_t frames_ended;
+	uint64_t layers;
+	uint64_t syncs;
+	uint64_t haptics;
+};
+
+/* Defaults, overridden by XRMOCK_PERIOD_NS, XRMOCK_WIDTH, XRMOCK_HEIGHT
+ * and XRMOCK_THROTTLE from the environment. */
+void xrmock_default_config(struct xrmock_config *config);
+/* Must be called before the instance is created to take effect. */
+void xrmock_configure(const struct xrmock_config *config);
+/* Queues the STOPPING transition, as if the user closed the app. */
+void xrmock_request_exit(void);
+void xrmock_get_counters(struct xrmock_counters *counters);
+
+#endif /* !XRMOCK_H */
@@ -6,106 +6,274 @@
 #include "../candle/systems/sauces.h"
 
 #include "internals.h"
+#include <errno.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#define xr_mkdir(path) _mkdir(path)
+#else
+#define xr_mkdir(path) mkdir(path, 0755)
+#endif
+
+/* Finds a plugin resource by file name in candle's resauce index, which
+ * knows where every plugin's resauces live whatever the working directory
+ * is. */
+bool_t xr_resource_path(const char *name, char *path, size_t size)
+{
+	const char *found = c_sauces_get_path(c_sauces(&SYS), name);
+	if (!found)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "resource %s is not in candle's resauce index", name);
+		return false;
+	}
+	snprintf(path, size, "%s", found);
+	return true;
+}
 
-bool_t is_extension_supported(char* extensionName, XrExtensionProperties* instanceExtensionProperties,
-                            uint32_t instanceExtensionCount)
+static bool_t xr_make_dir(const char *dir)
 {
-	for (uint32_t supportedIndex = 0; supportedIndex < instanceExtensionCount;
-	     supportedIndex++)
+	return !xr_mkdir(dir) || errno == EEXIST;
+}
+
+/* Path of name in the user's cache directory, which is created on first
+ * use. The plugin's own directory may well be read only. */
+bool_t xr_cache_file(const char *name, char *path, size_t size)
+{
+	char dir[512];
+#ifdef _WIN32
+	const char *base = getenv("LOCALAPPDATA");
+	if (!base || !base[0])
+		base = getenv("TEMP");
+	if (!base || !base[0])
+		return false;
+	snprintf(dir, sizeof(dir), "%s\\openxr.candle", base);
+#else
+	const char *base = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	if (base && base[0])
+	{
+		snprintf(dir, sizeof(dir), "%s/openxr.candle", base);
+	}
+	else if (home && home[0])
+	{
+		snprintf(dir, sizeof(dir), "%s/.cache", home);
+		xr_make_dir(dir);
+		snprintf(dir, sizeof(dir), "%s/.cache/openxr.candle", home);
+	}
+	else
+	{
+		return false;
+	}
+#endif
+	if (!xr_make_dir(dir))
 	{
-		printf("%s\n", instanceExtensionProperties[supportedIndex].extensionName);
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "cache directory %s is not writable", dir);
+		return false;
 	}
-	for (uint32_t supportedIndex = 0; supportedIndex < instanceExtensionCount;
-	     supportedIndex++)
+	snprintf(path, size, "%s/%s", dir, name);
+	return true;
+}
+
+/* Cache entry derived from the file at source, named after it and the hash
+ * of its path so same named sources don't share an entry. */
+bool_t xr_cache_entry(const char *source, const char *suffix, char *path,
+                      size_t size)
+{
+	char name[256];
+	const char *base = source;
+	for (const char *c = source; *c; c++)
 	{
-		if (!strcmp(extensionName, instanceExtensionProperties[supportedIndex].extensionName))
+		if (*c == '/' || *c == '\\')
+			base = c + 1;
+	}
+	snprintf(name, sizeof(name), "%s.%08x%s", base,
+	         (unsigned)xr_hash((const uint8_t*)source, strlen(source)), suffix);
+	return xr_cache_file(name, path, size);
+}
+
+/* Attaches the swapchain image and a depth texture shared by every image of
+ * the same swapchain. This is done once, the framebuffers are reused for the
+ * whole session. Returns false if the driver can't render into them. */
+static bool_t openxr_framebuffers_init(struct openxr_internal *self,
+                                       uint32_t swapchain, uint32_t length)
+{
+	bool_t complete = true;
+	const uint32_t w = self->views[swapchain].swapchain_width;
+	const uint32_t h = self->views[swapchain].swapchain_height;
+	const GLuint depth = self->depth_textures[swapchain];
+
+	glBindTexture(GL_TEXTURE_2D, depth);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, w, h);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (uint32_t j = 0; j < length; j++)
+	{
+		const GLuint image = self->images[swapchain][j].image;
+		glBindFramebuffer(GL_FRAMEBUFFER, self->framebuffers[swapchain][j]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, image, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		                       GL_TEXTURE_2D, depth, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		{
-			return true;
+			xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+			       "swapchain %u image %u is not renderable", swapchain, j);
+			complete = false;
 		}
 	}
-	return false;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glerr();
+	return complete;
 }
-XrDebugUtilsMessengerEXT xr_debug;
 
-static void c_openxr_init_actions(struct openxr_internal *self);
-PFN_xrCreateDebugUtilsMessengerEXT    ext_xrCreateDebugUtilsMessengerEXT;
-PFN_xrDestroyDebugUtilsMessengerEXT   ext_xrDestroyDebugUtilsMessengerEXT;
+/* Lower ranks are preferred. A format matching the renderer's output needs
+ * no conversion, otherwise sRGB 8 bit is preferred for LDR output and a
+ * compact float format for HDR output. Formats we don't know go last and
+ * keep the runtime's own order. */
+static int openxr_format_rank(int64_t format, int64_t output_format)
+{
+	static const int64_t ldr[] = {GL_SRGB8_ALPHA8, GL_SRGB8, GL_RGBA8,
+	                              GL_RGB10_A2, GL_R11F_G11F_B10F, GL_RGBA16F};
+	static const int64_t hdr[] = {GL_R11F_G11F_B10F, GL_RGBA16F, GL_RGB10_A2,
+	                              GL_SRGB8_ALPHA8, GL_SRGB8, GL_RGBA8};
+	const bool_t is_hdr = output_format == GL_R11F_G11F_B10F ||
+	                      output_format == GL_RGBA16F ||
+	                      output_format == GL_RGB16F;
+	const int64_t *ranking = is_hdr ? hdr : ldr;
+	const int count = sizeof(ldr) / sizeof(ldr[0]);
+
+	if (output_format && format == output_format)
+		return 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (ranking[i] == format)
+			return i + 1;
+	}
+	return count + 1;
+}
 
-static XrBool32 _debug_cb(XrDebugUtilsMessageSeverityFlagsEXT severity, XrDebugUtilsMessageTypeFlagsEXT types,
-		const XrDebugUtilsMessengerCallbackDataEXT *msg, void* user_data) {
-	printf("%s: %s\n", msg->functionName, msg->message);
-	return (XrBool32)XR_FALSE;
+static void openxr_formats_rank(int64_t *formats, uint32_t count,
+                                int64_t output_format)
+{
+	/* insertion sort, stable so the runtime's preference breaks ties */
+	for (uint32_t i = 1; i < count; i++)
+	{
+		int64_t format = formats[i];
+		int rank = openxr_format_rank(format, output_format);
+		uint32_t j = i;
+		while (j > 0 && openxr_format_rank(formats[j - 1], output_format) > rank)
+		{
+			formats[j] = formats[j - 1];
+			j--;
+		}
+		formats[j] = format;
+	}
 }
 
-int openxr_internal_init(struct openxr_internal *self)
+static bool_t openxr_swapchains_try(struct openxr_internal *self,
+                                    int64_t format, XrSwapchainUsageFlags usage,
+                                    uint32_t *swapchainLength)
 {
-	glFinish();
-	glerr();
 	XrResult result;
+	for (uint32_t i = 0; i < self->swapchain_count; i++) {
+		XrSwapchainCreateInfo swapchainCreateInfo = {
+		    .type = XR_TYPE_SWAPCHAIN_CREATE_INFO,
+		    .usageFlags = usage,
+		    .createFlags = 0,
+		    .format = format,
+		    .sampleCount = 1,
+		    .width = self->views[i].swapchain_width,
+		    .height = self->views[i].swapchain_height,
+		    .faceCount = 1,
+		    .arraySize = 1,
+		    .mipCount = 1,
+		    .next = NULL,
+		};
 
-	uint32_t extensionCount = 0;
-	result =
-	    xrEnumerateInstanceExtensionProperties(NULL, 0, &extensionCount, NULL);
+		result = xrCreateSwapchain(self->session, &swapchainCreateInfo,
+		                           &self->swapchains[i]);
+		if (xr_result(self->instance, result, "failed to create swapchain %d!", i))
+		{
+			result = xrEnumerateSwapchainImages(self->swapchains[i], 0,
+			                                    &swapchainLength[i], NULL);
+			if (xr_result(self->instance, result, "failed to enumerate swapchains"))
+				continue;
+			xrDestroySwapchain(self->swapchains[i]);
+		}
+		while (i--)
+			xrDestroySwapchain(self->swapchains[i]);
+		return false;
+	}
+	return true;
+}
 
-	/* TODO: instance null will not be able to convert XrResult to string */
-	if (!xr_result(NULL, result,
-	               "failed to enumerate number of extension properties"))
-		return 0;
+/* Tries the best ranked formats first, then a blit target instead of
+ * rendering straight into the images. The number of attempts is bounded by
+ * the usages below and the number of candidate formats. */
+static bool_t openxr_swapchains_create(struct openxr_internal *self,
+                                       int64_t *formats, uint32_t format_count,
+                                       uint32_t *swapchainLength)
+{
+	const XrSwapchainUsageFlags usages[] = {
+		XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT,
+		XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT,
+	};
+	const uint32_t max_formats = format_count < 3 ? format_count : 3;
 
-	printf("Runtime supports %d extensions\n", extensionCount);
+	openxr_formats_rank(formats, format_count, self->output_format);
 
-	XrExtensionProperties extensionProperties[256];
-	for (uint16_t i = 0; i < extensionCount; i++) {
-		extensionProperties[i].type = XR_TYPE_EXTENSION_PROPERTIES;
-		extensionProperties[i].next = NULL;
+	self->swapchains = malloc(sizeof(XrSwapchain) * self->view_count);
+	self->swapchain_count = self->view_count;
+	for (uint32_t u = 0; u < sizeof(usages) / sizeof(usages[0]); u++)
+	{
+		for (uint32_t f = 0; f < max_formats; f++)
+		{
+			if (!openxr_swapchains_try(self, formats[f], usages[u],
+			                           swapchainLength))
+				continue;
+			self->swapchain_format = formats[f];
+			self->zero_copy = (usages[u] &
+			                   XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) != 0;
+			xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN,
+			       "created %u swapchains with format 0x%x",
+			       self->swapchain_count, (unsigned int)formats[f]);
+			return true;
+		}
 	}
+	self->swapchain_count = 0;
+	return false;
+}
 
-	result = xrEnumerateInstanceExtensionProperties(
-	    NULL, extensionCount, &extensionCount, extensionProperties);
-	if (!xr_result(NULL, result, "failed to enumerate extension properties"))
-		return 0;
+XrDebugUtilsMessengerEXT xr_debug;
 
-	if (!is_extension_supported(XR_KHR_OPENGL_ENABLE_EXTENSION_NAME,
-	                          extensionProperties, extensionCount)) {
-		printf("Runtime does not support OpenGL extension!\n");
-		return 0;
-	}
+static void c_openxr_init_actions(struct openxr_internal *self);
+PFN_xrCreateDebugUtilsMessengerEXT    ext_xrCreateDebugUtilsMessengerEXT;
+PFN_xrDestroyDebugUtilsMessengerEXT   ext_xrDestroyDebugUtilsMessengerEXT;
 
-	printf("Runtime supports required extension %s\n",
-	       XR_KHR_OPENGL_ENABLE_EXTENSION_NAME);
-
-	// --- Enumerate API layers
-	bool_t lunargCoreValidationSupported = false;
-	uint32_t apiLayerCount;
-	xrEnumerateApiLayerProperties(0, &apiLayerCount, NULL);
-	printf("Loader found %d api layers%s", apiLayerCount,
-	       apiLayerCount == 0 ? "\n" : ": ");
-	XrApiLayerProperties apiLayerProperties[512];
-	memset(apiLayerProperties, 0, apiLayerCount * sizeof(XrApiLayerProperties));
-
-	for (uint32_t i = 0; i < apiLayerCount; i++) {
-		apiLayerProperties[i].type = XR_TYPE_API_LAYER_PROPERTIES;
-		apiLayerProperties[i].next = NULL;
-	}
-	xrEnumerateApiLayerProperties(apiLayerCount, &apiLayerCount,
-	                              apiLayerProperties);
-	for (uint32_t i = 0; i < apiLayerCount; i++) {
-		if (strcmp(apiLayerProperties[i].layerName,
-		                  "XR_APILAYER_LUNARG_core_validation") == 0) {
-			lunargCoreValidationSupported = true;
-		}
-		printf("%s%s", apiLayerProperties[i].layerName,
-		       i < apiLayerCount - 1 ? ", " : "\n");
-	}
+static XrBool32 _debug_cb(XrDebugUtilsMessageSeverityFlagsEXT severity, XrDebugUtilsMessageTypeFlagsEXT types,
+		const XrDebugUtilsMessengerCallbackDataEXT *msg, void* user_data) {
+	/* copied into the log ring, written later by the log thread */
+	xrlog_messenger(severity, msg);
+	return (XrBool32)XR_FALSE;
+}
 
-	// --- Create XrInstance
-	const char* const enabledExtensions[] = {XR_KHR_OPENGL_ENABLE_EXTENSION_NAME};
+/* Creates the instance with the extensions in self->caps, the runtime's
+ * properties are returned to check them against the cached ones. */
+static bool_t openxr_instance_create(struct openxr_internal *self,
+                                     XrInstanceProperties *instanceProperties)
+{
+	XrResult result;
+	const char* enabledExtensions[8];
+	const uint32_t enabledExtensionCount = xrcaps_extensions_enabled(
+			&self->caps, enabledExtensions, 8);
 
 	XrInstanceCreateInfo instanceCreateInfo = {
 	    .type = XR_TYPE_INSTANCE_CREATE_INFO,
 	    .next = NULL,
 	    .createFlags = 0,
-	    .enabledExtensionCount = 1,
+	    .enabledExtensionCount = enabledExtensionCount,
 	    .enabledApiLayerCount = 0,
 	    .enabledApiLayerNames = NULL,
 	    .applicationInfo =
@@ -120,42 +288,94 @@ int openxr_internal_init(struct openxr_internal *self)
 	instanceCreateInfo.enabledExtensionNames = enabledExtensions;
 	const bool_t useCoreValidationLayer = true;
 
-	if (lunargCoreValidationSupported && useCoreValidationLayer) {
+	const char* const enabledApiLayers[] = {
+	    "XR_APILAYER_LUNARG_core_validation"};
+	if ((self->caps.flags & XR_CAP_CORE_VALIDATION) && useCoreValidationLayer) {
 		instanceCreateInfo.enabledApiLayerCount = 1;
-		const char* const enabledApiLayers[] = {
-		    "XR_APILAYER_LUNARG_core_validation"};
 		instanceCreateInfo.enabledApiLayerNames = enabledApiLayers;
 	}
 
 	result = xrCreateInstance(&instanceCreateInfo, &self->instance);
 	if (!xr_result(NULL, result, "failed to create XR instance."))
-		return 0;
+		return false;
 
-	// Checking instance properties is optional!
+	instanceProperties->type = XR_TYPE_INSTANCE_PROPERTIES;
+	instanceProperties->next = NULL;
+	result = xrGetInstanceProperties(self->instance, instanceProperties);
+	if (!xr_result(NULL, result, "failed to get instance info"))
 	{
-		XrInstanceProperties instanceProperties = {
-		    .type = XR_TYPE_INSTANCE_PROPERTIES,
-		    .next = NULL,
-		};
+		xrDestroyInstance(self->instance);
+		self->instance = XR_NULL_HANDLE;
+		return false;
+	}
 
-		result = xrGetInstanceProperties(self->instance, &instanceProperties);
-		if (!xr_result(NULL, result, "failed to get instance info"))
-			return 0;
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME, "runtime %s %d.%d.%d",
+	       instanceProperties->runtimeName,
+	       XR_VERSION_MAJOR(instanceProperties->runtimeVersion),
+	       XR_VERSION_MINOR(instanceProperties->runtimeVersion),
+	       XR_VERSION_PATCH(instanceProperties->runtimeVersion));
+	return true;
+}
 
-		printf("Runtime Name: %s\n", instanceProperties.runtimeName);
-		printf("Runtime Version: %d.%d.%d\n",
-		       XR_VERSION_MAJOR(instanceProperties.runtimeVersion),
-		       XR_VERSION_MINOR(instanceProperties.runtimeVersion),
-		       XR_VERSION_PATCH(instanceProperties.runtimeVersion));
+/* Instance and system creation, nothing here touches GL so it runs on the
+ * boot thread while the desktop view keeps drawing. */
+static bool_t openxr_probe(struct openxr_internal *self)
+{
+	XrResult result;
+	XrInstanceProperties instanceProperties;
+	struct xr_caps *caps = &self->caps;
+
+	/* the cached capabilities are trusted as long as the instance comes
+	 * from the same runtime, otherwise everything is enumerated again */
+	bool_t cached = xrcaps_load(caps);
+	while (true)
+	{
+		if (!cached && !xrcaps_probe(caps))
+			return false;
+		if (!(caps->flags & XR_CAP_OPENGL)) {
+			xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_RUNTIME,
+			       "runtime does not support the OpenGL extension");
+			return false;
+		}
+		if (openxr_instance_create(self, &instanceProperties))
+		{
+			if (!cached
+			    || (!strcmp(caps->runtime_name, instanceProperties.runtimeName)
+			        && caps->runtime_version == instanceProperties.runtimeVersion))
+				break;
+			xrDestroyInstance(self->instance);
+			self->instance = XR_NULL_HANDLE;
+		}
+		else if (!cached)
+		{
+			return false;
+		}
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN,
+		       "runtime changed, probing its capabilities again");
+		cached = false;
+	}
+	if (!cached)
+	{
+		snprintf(caps->runtime_name, sizeof(caps->runtime_name), "%s",
+		         instanceProperties.runtimeName);
+		caps->runtime_version = instanceProperties.runtimeVersion;
+		xrcaps_save(caps);
 	}
 
+	if (caps->flags & XR_CAP_VISIBILITY_MASK)
+		xrGetInstanceProcAddr(self->instance, "xrGetVisibilityMaskKHR",
+		                      (PFN_xrVoidFunction *)&self->mask.get);
+#ifdef XR_KHR_locate_spaces
+	if (caps->flags & XR_CAP_LOCATE_SPACES)
+		xrGetInstanceProcAddr(self->instance, "xrLocateSpacesKHR",
+		                      (PFN_xrVoidFunction *)&self->locate_spaces);
+#endif
 
 	xrGetInstanceProcAddr(self->instance, "xrCreateDebugUtilsMessengerEXT",    (PFN_xrVoidFunction *)(&ext_xrCreateDebugUtilsMessengerEXT   ));
 	xrGetInstanceProcAddr(self->instance, "xrDestroyDebugUtilsMessengerEXT",   (PFN_xrVoidFunction *)(&ext_xrDestroyDebugUtilsMessengerEXT  ));
 
-	// Set up a really verbose debug log! Great for dev, but turn this off or
-	// down for final builds. WMR doesn't produce much output here, but it
-	// may be more useful for other runtimes?
+	// Only the severities the log filter lets through are requested, the
+	// runtime then doesn't build the others at all.
 	// Here's some extra information aboutxr_instance the message types and severities:
 	// https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#debug-message-categorization
 	XrDebugUtilsMessengerCreateInfoEXT debug_info = { XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT };
@@ -164,28 +384,21 @@ int openxr_internal_init(struct openxr_internal *self)
 		XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT  |
 		XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT |
 		XR_DEBUG_UTILS_MESSAGE_TYPE_CONFORMANCE_BIT_EXT;
-	debug_info.messageSeverities =
-		XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-		XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT    |
-		XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-		XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	debug_info.messageSeverities = xrlog_messenger_severities();
 	debug_info.userCallback = _debug_cb; // Start up the debug utils!
 	if (ext_xrCreateDebugUtilsMessengerEXT)
 		ext_xrCreateDebugUtilsMessengerEXT(self->instance, &debug_info, &xr_debug);
-	
+
 
 	// --- Create XrSystem
 	XrSystemGetInfo systemGetInfo = {.type = XR_TYPE_SYSTEM_GET_INFO,
 	                                 .formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY,
 	                                 .next = NULL};
 
-	XrSystemId systemId;
-	result = xrGetSystem(self->instance, &systemGetInfo, &systemId);
+	result = xrGetSystem(self->instance, &systemGetInfo, &self->system_id);
 	if (!xr_result(self->instance, result,
 	               "failed to get system for HMD form factor."))
-		return 0;
-
-	printf("Successfully got XrSystem %lu for HMD form factor\n", (unsigned long)systemId);
+		return false;
 
 	// checking system properties is optional!
 	{
@@ -196,96 +409,65 @@ int openxr_internal_init(struct openxr_internal *self)
 		    .trackingProperties = {0},
 		};
 
-		result = xrGetSystemProperties(self->instance, systemId, &systemProperties);
+		result = xrGetSystemProperties(self->instance, self->system_id, &systemProperties);
 		if (!xr_result(self->instance, result, "failed to get System properties"))
-			return 0;
-
-		printf("System properties for system %lu: \"%s\", vendor ID %d\n",
-		       (unsigned long)systemProperties.systemId, systemProperties.systemName,
-		       (int)systemProperties.vendorId);
-		printf("\tMax layers          : %d\n",
-		       systemProperties.graphicsProperties.maxLayerCount);
-		printf("\tMax swapchain height: %d\n",
+			return false;
+
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME,
+		       "system \"%s\", vendor ID %d, max layers %d, max swapchain %dx%d",
+		       systemProperties.systemName, (int)systemProperties.vendorId,
+		       systemProperties.graphicsProperties.maxLayerCount,
+		       systemProperties.graphicsProperties.maxSwapchainImageWidth,
 		       systemProperties.graphicsProperties.maxSwapchainImageHeight);
-		printf("\tMax swapchain width : %d\n",
-		       systemProperties.graphicsProperties.maxSwapchainImageWidth);
-		printf("\tOrientation Tracking: %d\n",
-		       systemProperties.trackingProperties.orientationTracking);
-		printf("\tPosition Tracking   : %d\n",
-		       systemProperties.trackingProperties.positionTracking);
 	}
 
 	// --- Enumerate and set up Views
+	XrViewConfigurationType stereoViewConfigType =
+	    XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+
 	uint32_t viewConfigurationCount;
-	result = xrEnumerateViewConfigurations(self->instance, systemId, 0,
+	result = xrEnumerateViewConfigurations(self->instance, self->system_id, 0,
 	                                       &viewConfigurationCount, NULL);
 	if (!xr_result(self->instance, result,
 	               "failed to get view configuration count"))
-		return 0;
+		return false;
 
-	printf("Runtime supports %d view configurations\n", viewConfigurationCount);
-
-	XrViewConfigurationType viewConfigurations[512];
+	XrViewConfigurationType *viewConfigurations = malloc(
+			sizeof(*viewConfigurations) * (viewConfigurationCount + 1));
 	result = xrEnumerateViewConfigurations(
-	    self->instance, systemId, viewConfigurationCount, &viewConfigurationCount,
-	    viewConfigurations);
+	    self->instance, self->system_id, viewConfigurationCount,
+	    &viewConfigurationCount, viewConfigurations);
+	bool_t stereoSupported = false;
+	for (uint32_t i = 0; XR_SUCCEEDED(result) && i < viewConfigurationCount; ++i)
+		stereoSupported |= viewConfigurations[i] == stereoViewConfigType;
+	free(viewConfigurations);
 	if (!xr_result(self->instance, result,
 	               "failed to enumerate view configurations!"))
-		return 0;
-
-	XrViewConfigurationType stereoViewConfigType =
-	    XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
-
+		return false;
+	if (!stereoSupported) {
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_RUNTIME,
+		       "runtime does not support the stereo view configuration");
+		return false;
+	}
 
 	uint32_t blend_count = 0;
-	xrEnumerateEnvironmentBlendModes(self->instance, systemId, stereoViewConfigType ,
-		1, &blend_count, &self->xr_blend);
-	/* Checking if the runtime supports the view configuration we want to use is
-	 * optional! If stereoViewConfigType.type is unset after the loop, the runtime
-	 * does not support Stereo VR. */
-	{
-		XrViewConfigurationProperties stereoViewConfigProperties = {0};
-		for (uint32_t i = 0; i < viewConfigurationCount; ++i) {
-			XrViewConfigurationProperties properties = {
-			    .type = XR_TYPE_VIEW_CONFIGURATION_PROPERTIES, .next = NULL};
-
-			result = xrGetViewConfigurationProperties(
-			    self->instance, systemId, viewConfigurations[i], &properties);
-			if (!xr_result(self->instance, result,
-			               "failed to get view configuration info %d!", i))
-				return 0;
-
-			if (viewConfigurations[i] == stereoViewConfigType &&
-			    /* just to verify */ properties.viewConfigurationType ==
-			        stereoViewConfigType) {
-				printf("Runtime supports our VR view configuration, yay!\n");
-				stereoViewConfigProperties = properties;
-			} else {
-				printf(
-				    "Runtime supports a view configuration we are not interested in: "
-				    "%d\n",
-				    properties.viewConfigurationType);
-			}
-		}
-		if (stereoViewConfigProperties.type !=
-		    XR_TYPE_VIEW_CONFIGURATION_PROPERTIES) {
-			printf("Couldn't get VR View Configuration from Runtime!\n");
-			return 0;
-		}
+	xrEnumerateEnvironmentBlendModes(self->instance, self->system_id,
+		stereoViewConfigType, 1, &blend_count, &self->xr_blend);
 
-		printf("VR View Configuration:\n");
-		printf("\tview configuratio type: %d\n",
-		       stereoViewConfigProperties.viewConfigurationType);
-		printf("\tFOV mutable           : %s\n",
-		       stereoViewConfigProperties.fovMutable ? "yes" : "no");
-	}
-
-	result = xrEnumerateViewConfigurationViews(self->instance, systemId,
+	result = xrEnumerateViewConfigurationViews(self->instance, self->system_id,
 	                                           stereoViewConfigType, 0,
 	                                           &self->view_count, NULL);
 	if (!xr_result(self->instance, result,
 	               "failed to get view configuration view count!"))
-		return 0;
+		return false;
+	/* every per view array of the frame loop is sized for this many */
+	if (self->view_count > XR_MAX_VIEWS)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "runtime has %u views, at most %u are supported",
+		       self->view_count, (unsigned)XR_MAX_VIEWS);
+		return false;
+	}
 
 	self->configuration_views =
 	    malloc(sizeof(XrViewConfigurationView) * self->view_count);
@@ -295,25 +477,25 @@ int openxr_internal_init(struct openxr_internal *self)
 	}
 
 	result = xrEnumerateViewConfigurationViews(
-	    self->instance, systemId, stereoViewConfigType, self->view_count,
+	    self->instance, self->system_id, stereoViewConfigType, self->view_count,
 	    &self->view_count, self->configuration_views);
 	if (!xr_result(self->instance, result,
 	               "failed to enumerate view configuration views!"))
-		return 0;
+		return false;
 
-	printf("View count: %d\n", self->view_count);
 	for (uint32_t i = 0; i < self->view_count; i++) {
-		printf("View %d:\n", i);
-		printf("\tResolution       : Recommended %dx%d, Max: %dx%d\n",
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME,
+		       "view %d: recommended %dx%d, max %dx%d", i,
 		       self->configuration_views[i].recommendedImageRectWidth,
 		       self->configuration_views[i].recommendedImageRectHeight,
 		       self->configuration_views[i].maxImageRectWidth,
 		       self->configuration_views[i].maxImageRectHeight);
-		printf("\tSwapchain Samples: Recommended: %d, Max: %d)\n",
-		       self->configuration_views[i].recommendedSwapchainSampleCount,
-		       self->configuration_views[i].maxSwapchainSampleCount);
 	}
 
+	self->views = calloc(sizeof(*self->views), self->view_count);
+	for (uint32_t i = 0; i < self->view_count; i++)
+		self->views[i].previous_view = mat4();
+
 	// For all graphics APIs, it's required to make the
 	// "xrGet...GraphicsRequirements" call before creating a session. The
 	// information retrieved by the OpenGL version of this call isn't very useful.
@@ -325,47 +507,50 @@ int openxr_internal_init(struct openxr_internal *self)
 		PFN_xrGetOpenGLGraphicsRequirementsKHR pfnGetOpenGLGraphicsRequirementsKHR = NULL;
 		result = xrGetInstanceProcAddr(self->instance, "xrGetOpenGLGraphicsRequirementsKHR",
 		                               (PFN_xrVoidFunction *)&pfnGetOpenGLGraphicsRequirementsKHR);
-		result = pfnGetOpenGLGraphicsRequirementsKHR(self->instance, systemId, &opengl_reqs);
+		result = pfnGetOpenGLGraphicsRequirementsKHR(self->instance, self->system_id, &opengl_reqs);
 		if (!xr_result(self->instance, result,
 		               "failed to get OpenGL graphics requirements!"))
-			return 0;
+			return false;
 
 		XrVersion desired_opengl_version = XR_MAKE_VERSION(4, 5, 0);
 		if (desired_opengl_version > opengl_reqs.maxApiVersionSupported ||
 		    desired_opengl_version < opengl_reqs.minApiVersionSupported) {
-			printf(
-			    "We want OpenGL %d.%d.%d, but runtime only supports OpenGL "
-			    "%d.%d.%d - %d.%d.%d!\n",
+			xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_RUNTIME,
+			    "OpenGL %d.%d is needed, but the runtime only supports "
+			    "OpenGL %d.%d.%d - %d.%d.%d",
 			    XR_VERSION_MAJOR(desired_opengl_version),
 			    XR_VERSION_MINOR(desired_opengl_version),
-			    XR_VERSION_PATCH(desired_opengl_version),
 			    XR_VERSION_MAJOR(opengl_reqs.minApiVersionSupported),
 			    XR_VERSION_MINOR(opengl_reqs.minApiVersionSupported),
 			    XR_VERSION_PATCH(opengl_reqs.minApiVersionSupported),
 			    XR_VERSION_MAJOR(opengl_reqs.maxApiVersionSupported),
 			    XR_VERSION_MINOR(opengl_reqs.maxApiVersionSupported),
 			    XR_VERSION_PATCH(opengl_reqs.maxApiVersionSupported));
-			return 0;
+			return false;
 		}
 	}
+	return true;
+}
 
-	// --- Create session
+/* Creates the session on the render thread, whose GL context the runtime
+ * shares. */
+static bool_t openxr_session_create(struct openxr_internal *self)
+{
+	XrResult result;
 
-	self->graphics_binding_gl.type = XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR;
-	self->graphics_binding_gl.next = NULL;
-	self->graphics_binding_gl.hGLRC = wglGetCurrentContext();
-	self->graphics_binding_gl.hDC = wglGetCurrentDC();
+	if (!xrgl_binding(self))
+		return false;
 
 	XrSessionCreateInfo session_create_info = {.type =
 	                                               XR_TYPE_SESSION_CREATE_INFO,
-	                                           .next = &self->graphics_binding_gl,
-	                                           .systemId = systemId};
+	                                           .next = &self->graphics_binding,
+	                                           .systemId = self->system_id};
 
 
 	result =
 	    xrCreateSession(self->instance, &session_create_info, &self->session);
 	if (!xr_result(self->instance, result, "failed to create session"))
-		return 0;
+		return false;
 
 	// --- Check supported reference spaces
 	// we don't *need* to check the supported reference spaces if we're confident
@@ -376,45 +561,24 @@ int openxr_internal_init(struct openxr_internal *self)
 		                                    NULL);
 		if (!xr_result(self->instance, result,
 		               "Getting number of reference spaces failed!"))
-			return 0;
+			return false;
 
-		XrReferenceSpaceType referenceSpaces[512];
-		for (uint32_t i = 0; i < referenceSpacesCount; i++)
-			referenceSpaces[i] = XR_REFERENCE_SPACE_TYPE_VIEW;
+		XrReferenceSpaceType *referenceSpaces = malloc(
+				sizeof(*referenceSpaces) * (referenceSpacesCount + 1));
 		result = xrEnumerateReferenceSpaces(self->session, referenceSpacesCount,
 		                                    &referenceSpacesCount, referenceSpaces);
+		bool_t localSpaceSupported = false;
+		for (uint32_t i = 0; XR_SUCCEEDED(result) && i < referenceSpacesCount; i++)
+			localSpaceSupported |= referenceSpaces[i] == XR_REFERENCE_SPACE_TYPE_LOCAL;
+		free(referenceSpaces);
 		if (!xr_result(self->instance, result,
 		               "Enumerating reference spaces failed!"))
-			return 0;
-
-		bool_t stageSpaceSupported = false;
-		bool_t localSpaceSupported = false;
-		printf("Runtime supports %d reference spaces: ", referenceSpacesCount);
-		for (uint32_t i = 0; i < referenceSpacesCount; i++) {
-			if (referenceSpaces[i] == XR_REFERENCE_SPACE_TYPE_LOCAL) {
-				printf("XR_REFERENCE_SPACE_TYPE_LOCAL%s",
-				       i == referenceSpacesCount - 1 ? "\n" : ", ");
-				localSpaceSupported = true;
-			} else if (referenceSpaces[i] == XR_REFERENCE_SPACE_TYPE_STAGE) {
-				printf("XR_REFERENCE_SPACE_TYPE_STAGE%s",
-				       i == referenceSpacesCount - 1 ? "\n" : ", ");
-				stageSpaceSupported = true;
-			} else if (referenceSpaces[i] == XR_REFERENCE_SPACE_TYPE_VIEW) {
-				printf("XR_REFERENCE_SPACE_TYPE_VIEW%s",
-				       i == referenceSpacesCount - 1 ? "\n" : ", ");
-			} else {
-				printf("some other space with type %u%s", referenceSpaces[i],
-				       i == referenceSpacesCount - 1 ? "\n" : ", ");
-			}
-		}
+			return false;
 
-		if (/* !stageSpaceSupported || */ !localSpaceSupported) {
-			printf(
-			    "runtime does not support required spaces! stage: %s, "
-			    "local: %s\n",
-			    stageSpaceSupported ? "supported" : "NOT SUPPORTED",
-			    localSpaceSupported ? "supported" : "NOT SUPPORTED");
-			return 0;
+		if (!localSpaceSupported) {
+			xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_RUNTIME,
+			       "runtime does not support the local reference space");
+			return false;
 		}
 	}
 
@@ -430,81 +594,53 @@ int openxr_internal_init(struct openxr_internal *self)
 	result = xrCreateReferenceSpace(self->session, &localSpaceCreateInfo,
 	                                &self->local_space);
 	if (!xr_result(self->instance, result, "failed to create local space!"))
-		return 0;
+		return false;
 
-	// --- Begin session
-	XrSessionBeginInfo sessionBeginInfo = {.type = XR_TYPE_SESSION_BEGIN_INFO,
-	                                       .next = NULL,
-	                                       .primaryViewConfigurationType =
-	                                           stereoViewConfigType};
-	result = xrBeginSession(self->session, &sessionBeginInfo);
-	if (!xr_result(self->instance, result, "failed to begin session!"))
-		return 0;
-	printf("Session started!\n");
+	// --- The session is begun once the runtime reports it READY
+	self->session_state = XR_SESSION_STATE_UNKNOWN;
+	return true;
+}
 
+static bool_t openxr_swapchains_init(struct openxr_internal *self)
+{
+	XrResult result;
+	bool_t ok = false;
 
+	xrres_init(self);
 
-	// --- Create Swapchains
 	uint32_t swapchainFormatCount;
 	result = xrEnumerateSwapchainFormats(self->session, 0, &swapchainFormatCount,
 	                                     NULL);
 	if (!xr_result(self->instance, result,
 	               "failed to get number of supported swapchain formats"))
-		return 0;
+		return false;
 
-	printf("Runtime supports %d swapchain formats\n", swapchainFormatCount);
-	int64_t swapchainFormats[512];
+	int64_t *swapchainFormats = malloc(sizeof(*swapchainFormats)
+	                                   * (swapchainFormatCount + 1));
+	uint32_t *swapchainLength = NULL;
 	result = xrEnumerateSwapchainFormats(self->session, swapchainFormatCount,
 	                                     &swapchainFormatCount, swapchainFormats);
 	if (!xr_result(self->instance, result,
 	               "failed to enumerate swapchain formats"))
-		return 0;
-
-	// TODO: Determine which format we want to use instead of using the first one
-	int64_t swapchainFormatToUse = swapchainFormats[0];
+		goto end;
 
-	/* First create swapchains and query the length for each swapchain. */
-	self->swapchains = malloc(sizeof(XrSwapchain) * self->view_count);
-
-	uint32_t swapchainLength[512];
-
-retry:
-	for (uint32_t i = 0; i < self->view_count; i++) {
-		XrSwapchainCreateInfo swapchainCreateInfo = {
-		    .type = XR_TYPE_SWAPCHAIN_CREATE_INFO,
-		    /* .usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | */
-		    /*               XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT, */
-		    .usageFlags = XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT,
-		    .createFlags = 0,
-		    .format = swapchainFormatToUse,
-		    /* .format = GL_SRGB8, */
-		    .sampleCount = 1,
-		    .width = self->configuration_views[i].recommendedImageRectWidth,
-		    .height = self->configuration_views[i].recommendedImageRectHeight,
-		    .faceCount = 1,
-		    .arraySize = 1,
-		    .mipCount = 1,
-		    .next = NULL,
-		};
-
-		result = xrCreateSwapchain(self->session, &swapchainCreateInfo,
-		                           &self->swapchains[i]);
-		if (!xr_result(self->instance, result, "failed to create swapchain %d!", i))
-			goto retry;
-
-		result = xrEnumerateSwapchainImages(self->swapchains[i], 0,
-		                                    &swapchainLength[i], NULL);
-		if (!xr_result(self->instance, result, "failed to enumerate swapchains"))
-			return 0;
-		printf("Created swapchain %d\n", i);
+	/* one swapchain per view at most, kept to release the framebuffers */
+	swapchainLength = malloc(sizeof(*swapchainLength) * (self->view_count + 1));
+	self->swapchain_lengths = swapchainLength;
+	if (!openxr_swapchains_create(self, swapchainFormats, swapchainFormatCount,
+	                              swapchainLength))
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "could not create swapchains with any configuration");
+		goto end;
 	}
 
-	// allocate one array of images and framebuffers per view
-	self->images = malloc(sizeof(XrSwapchainImageOpenGLKHR*) * self->view_count);
-	self->framebuffers = malloc(sizeof(GLuint*) * self->view_count);
+	// allocate one array of images and framebuffers per swapchain
+	self->images = calloc(self->swapchain_count, sizeof(XrSwapchainImageOpenGLKHR*));
+	self->framebuffers = calloc(self->swapchain_count, sizeof(GLuint*));
 
-	for (uint32_t i = 0; i < self->view_count; i++) {
-		// allocate array of images and framebuffers for this view
+	for (uint32_t i = 0; i < self->swapchain_count; i++) {
+		// allocate array of images and framebuffers for this swapchain
 		self->images[i] =
 		    malloc(sizeof(XrSwapchainImageOpenGLKHR) * swapchainLength[i]);
 
@@ -518,7 +654,7 @@ retry:
 		    (XrSwapchainImageBaseHeader*)self->images[i]);
 		if (!xr_result(self->instance, result,
 		               "failed to enumerate swapchain images"))
-			return 0;
+			goto end;
 
 		// framebuffers are not managed or mandated by OpenXR, it's just how we
 		// happen to render into textures in this example
@@ -526,62 +662,338 @@ retry:
 		glGenFramebuffers(swapchainLength[i], self->framebuffers[i]);
 	}
 
-	c_openxr_init_actions(self);
-	self->initiated = true;
+	self->depth_textures = malloc(sizeof(GLuint) * self->swapchain_count);
+	glGenTextures(self->swapchain_count, self->depth_textures);
+	for (uint32_t i = 0; i < self->swapchain_count; i++) {
+		if (!openxr_framebuffers_init(self, i, swapchainLength[i]))
+			self->zero_copy = false;
+	}
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN, "rendering %s the swapchain images",
+	       self->zero_copy ? "directly into" : "with a blit into");
+
+	xrmask_init(self);
+	ok = true;
+
+end:
+	free(swapchainFormats);
+	return ok;
+}
+
+/* Releases what openxr_swapchains_init created, also when it stopped
+ * halfway. */
+static void openxr_swapchains_destroy(struct openxr_internal *self)
+{
+	for (uint32_t i = 0; i < self->swapchain_count; i++)
+	{
+		if (self->framebuffers && self->framebuffers[i])
+		{
+			glDeleteFramebuffers(self->swapchain_lengths[i], self->framebuffers[i]);
+			free(self->framebuffers[i]);
+		}
+		if (self->images)
+			free(self->images[i]);
+		xrDestroySwapchain(self->swapchains[i]);
+	}
+	if (self->depth_textures)
+		glDeleteTextures(self->swapchain_count, self->depth_textures);
+	free(self->depth_textures);
+	free(self->framebuffers);
+	free(self->images);
+	free(self->swapchains);
+	free(self->swapchain_lengths);
+	self->depth_textures = NULL;
+	self->framebuffers = NULL;
+	self->images = NULL;
+	self->swapchains = NULL;
+	self->swapchain_lengths = NULL;
+	self->swapchain_count = 0;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI openxr_boot_loop(void *data)
+#else
+static void *openxr_boot_loop(void *data)
+#endif
+{
+	struct openxr_internal *self = data;
+	xr_atomic_store(&self->boot_stage,
+	                openxr_probe(self) ? XR_BOOT_SESSION : XR_BOOT_FAILED);
 	return 0;
 }
 
+static void openxr_boot_start(struct openxr_internal *self)
+{
+	xr_atomic_store(&self->boot_stage, XR_BOOT_PROBING);
+#ifdef _WIN32
+	self->boot_thread = CreateThread(NULL, 0, openxr_boot_loop, self, 0, NULL);
+	self->boot_joinable = self->boot_thread != NULL;
+#else
+	self->boot_joinable = !pthread_create(&self->boot_thread, NULL,
+	                                      openxr_boot_loop, self);
+#endif
+	if (!self->boot_joinable)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "failed to start init thread, probing on main thread");
+		openxr_boot_loop(self);
+	}
+}
+
+static void openxr_boot_join(struct openxr_internal *self)
+{
+	if (!self->boot_joinable)
+		return;
+#ifdef _WIN32
+	WaitForSingleObject(self->boot_thread, INFINITE);
+	CloseHandle(self->boot_thread);
+#else
+	pthread_join(self->boot_thread, NULL);
+#endif
+	self->boot_joinable = false;
+}
+
+static void openxr_views_init(c_openxr_t *self);
+
+/* Runs one step of the init per frame, the GL bound steps are kept apart so
+ * none of them stalls the desktop view for long. */
+static void openxr_boot_step(c_openxr_t *c)
+{
+	struct openxr_internal *self = c->internal;
+	const long stage = xr_atomic_load(&self->boot_stage);
+	bool_t ok = true;
+
+	switch (stage)
+	{
+	case XR_BOOT_IDLE:
+		if (c->renderer && c->renderer->output)
+		{
+			GLint format = 0;
+			glBindTexture(GL_TEXTURE_2D, c->renderer->output->bufs[0].id);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,
+			                         GL_TEXTURE_INTERNAL_FORMAT, &format);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			self->output_format = format;
+		}
+		openxr_boot_start(self);
+		return;
+	case XR_BOOT_PROBING:
+		return;
+	case XR_BOOT_SESSION:
+		openxr_boot_join(self);
+		ok = openxr_session_create(self);
+		break;
+	case XR_BOOT_SWAPCHAINS:
+		ok = openxr_swapchains_init(self);
+		break;
+	case XR_BOOT_MODELS:
+		c_openxr_init_actions(self);
+		openxr_views_init(c);
+		self->initiated = true;
+		break;
+	case XR_BOOT_FAILED:
+		openxr_boot_join(self);
+		ok = false;
+		break;
+	}
+	if (!ok)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "OpenXR init failed");
+		self->failed = true;
+		xr_atomic_store(&self->boot_stage, XR_BOOT_FAILED);
+		return;
+	}
+	xr_atomic_store(&self->boot_stage, stage + 1);
+}
+
 void c_openxr_init(c_openxr_t *self)
 {
+	xrlog_start();
 	self->internal = calloc(sizeof(*self->internal), 1);
-	self->internal->previous_view[0] = mat4();
-	self->internal->previous_view[1] = mat4();
+	self->internal->frames_in_flight = XR_MAX_FRAMES_IN_FLIGHT;
+	xr_signal_init(&self->internal->pacing_signal);
+}
+
+/* Waits for the GPU to finish the frame that used this fence slot, leaving
+ * up to frames_in_flight frames queued instead of draining after each eye. */
+static void openxr_frame_throttle(struct openxr_internal *self)
+{
+	const uint32_t slot = self->frame_index % self->frames_in_flight;
+	GLsync fence = self->frame_fences[slot];
+	if (!fence)
+		return;
+
+	/* a frame taking this long means a hung GPU or a lost context, the
+	 * fence is dropped rather than blocking the render thread for good */
+	const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+	                                       XR_FENCE_TIMEOUT_NS);
+	if (status == GL_TIMEOUT_EXPIRED)
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "frame fence still pending after %llu ms, not waiting longer",
+		       (unsigned long long)(XR_FENCE_TIMEOUT_NS / 1000000ull));
+	else if (status == GL_WAIT_FAILED)
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN, "failed to wait for frame fence");
+
+	glDeleteSync(fence);
+	self->frame_fences[slot] = NULL;
 }
 
-void renderFrame(renderer_t *renderer, int w, int h,
+static void openxr_frame_fence(struct openxr_internal *self)
+{
+	const uint32_t slot = self->frame_index % self->frames_in_flight;
+	self->frame_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	self->frame_index++;
+}
+
+static void renderer_set_view(renderer_t *renderer, uint32_t camid,
+                              mat4_t absolute, mat4_t projectionmatrix,
+                              mat4_t cammatrix, mat4_t *previous_view)
+{
+	/* renderer_update_projection(renderer); */
+	renderer->glvars[camid].projection = projectionmatrix;
+	renderer->glvars[camid].inv_projection = mat4_invert(renderer->glvars[camid].projection); 
+
+	/* renderer->glvars[camid].model = mat4_mul(absolute, cammatrix); */
+	renderer->glvars[camid].model = mat4_mul(absolute, cammatrix);
+	renderer->glvars[camid].inv_model = mat4_invert(renderer->glvars[camid].model);
+	renderer->glvars[camid].pos = vec4_xyz(mat4_mul_vec4(renderer->glvars[camid].model,
+				vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+	renderer->glvars[camid].previous_view = *previous_view; 
+	renderer->ubo_changed[camid] = true;
+
+	*previous_view = renderer->glvars[camid].inv_model;
+}
+
+/* Allocates the per view renderers once. */
+static void openxr_views_init(c_openxr_t *self)
+{
+	struct openxr_internal *xr = self->internal;
+	if (!self->view_pipeline)
+		return;
+	for (uint32_t i = 0; i < xr->view_count; i++)
+	{
+		xr->views[i].renderer = renderer_new(1.0f);
+		self->view_pipeline(xr->views[i].renderer);
+		renderer_resize(xr->views[i].renderer, xr->views[i].width,
+		                xr->views[i].height);
+	}
+}
+
+/* Resizes only when the renderer's targets don't match the view, which
+ * happens once for dedicated renderers. */
+static renderer_t *xr_view_renderer(struct xr_view *view, renderer_t *shared)
+{
+	renderer_t *renderer = view->renderer ? view->renderer : shared;
+	if (renderer && (renderer->width != view->width ||
+	                 renderer->height != view->height))
+	{
+		renderer_resize(renderer, view->width, view->height);
+	}
+	return renderer;
+}
+
+/* Primes the hidden area into the depth and stencil of the renderer's
+ * first pass, whichever it is, and makes that pass load them instead of
+ * clearing them. Returns the pass's clear bits for openxr_mask_end, or
+ * XR_MASK_NONE when nothing was primed. */
+#define XR_MASK_NONE 0xffffffffu
+static uint32_t openxr_mask_begin(struct openxr_internal *xr, renderer_t *renderer,
+                                  uint32_t view, const mat4_t *projections)
+{
+	if (!renderer->passes_size)
+		return XR_MASK_NONE;
+	pass_t *first = &renderer->passes[0];
+	/* pipelines without an offscreen first target would prime the window */
+	if (!first->output || !first->output->frame_buffer[0])
+		return XR_MASK_NONE;
+	if (!xrmask_prime(xr, first->output->frame_buffer[0], view, projections))
+		return XR_MASK_NONE;
+	const uint32_t clear = first->clear;
+	first->clear &= ~(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	return clear;
+}
+
+static void openxr_mask_end(renderer_t *renderer, uint32_t clear)
+{
+	if (clear != XR_MASK_NONE)
+		renderer->passes[0].clear = clear;
+}
+
+/* Makes the renderer's final pass write into the given framebuffer instead
+ * of its own output, returning the framebuffer it replaced. */
+static GLuint renderer_redirect_output(renderer_t *renderer, GLuint framebuffer)
+{
+	GLuint previous = renderer->output->frame_buffer[0];
+	renderer->output->frame_buffer[0] = framebuffer;
+	return previous;
+}
+
+/* Depth texture of the scene candle last drew, 0 if it keeps none. */
+static GLuint renderer_scene_depth(renderer_t *renderer)
+{
+	texture_t *gbuffer = renderer_tex(renderer, ref("gbuffer"));
+	return gbuffer && gbuffer->depth_buffer ? gbuffer->bufs[0].id : 0;
+}
+
+void renderFrame(struct openxr_internal *xr, uint32_t view_index,
+                 renderer_t *shared,
 		 mat4_t absolute,
-                 mat4_t projectionmatrix,
+                 mat4_t *projectionmatrices,
                  mat4_t cammatrix,
-		 mat4_t *previous_view,
-                 GLuint framebuffer)
+                 GLuint framebuffer,
+                 bool_t zero_copy)
 {
+	struct xr_view *view = &xr->views[view_index];
+	renderer_t *renderer = xr_view_renderer(view, shared);
+	const int w = view->width;
+	const int h = view->height;
 
 	if (renderer)
 	{
-		renderer_resize(renderer, w, h);
-		/* renderer_update_projection(renderer); */
-		renderer->glvars[0].projection = projectionmatrix;
-		renderer->glvars[0].inv_projection = mat4_invert(renderer->glvars[0].projection); 
-
-		/* renderer->glvars[0].model = mat4_mul(absolute, cammatrix); */
-		renderer->glvars[0].model = mat4_mul(absolute, cammatrix);
-		renderer->glvars[0].inv_model = mat4_invert(renderer->glvars[0].model);
-		renderer->glvars[0].pos = vec4_xyz(mat4_mul_vec4(renderer->glvars[0].model,
-					vec4(0.0f, 0.0f, 0.0f, 1.0f)));
-		renderer->glvars[0].previous_view = *previous_view; 
-		renderer->ubo_changed[0] = true;
-
-		*previous_view = renderer->glvars[0].inv_model;
-
-		renderer_draw(renderer);
-
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->output->frame_buffer[0]);
-		glBlitFramebuffer((GLint)0,     // srcX0
-		                  (GLint)0,     // srcY0
-		                  (GLint)w,     // srcX1
-		                  (GLint)h,     // srcY1
-		                  (GLint)0,     // dstX0
-		                  (GLint)0,     // dstY0
-		                  (GLint)w,     // dstX1
-		                  (GLint)h,     // dstY1
-		                  (GLbitfield)GL_COLOR_BUFFER_BIT, // mask
-		                  (GLenum)GL_LINEAR);              // filter
-
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-	}
-	glFinish();
+		renderer_set_view(renderer, 0, absolute,
+		                  projectionmatrices[view_index], cammatrix,
+		                  &view->previous_view);
+		const uint32_t clear = openxr_mask_begin(xr, renderer, view_index,
+		                                         projectionmatrices);
+
+		xrstats_view_begin(xr, view_index);
+		if (zero_copy)
+		{
+			GLuint output = renderer_redirect_output(renderer, framebuffer);
+			renderer_draw(renderer);
+			renderer_redirect_output(renderer, output);
+			openxr_mask_end(renderer, clear);
+			xrstats_view_drawn(xr, view_index);
+		}
+		else
+		{
+			renderer_draw(renderer);
+			openxr_mask_end(renderer, clear);
+			xrstats_view_drawn(xr, view_index);
+
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->output->frame_buffer[0]);
+			glBlitFramebuffer((GLint)0,     // srcX0
+			                  (GLint)0,     // srcY0
+			                  (GLint)w,     // srcX1
+			                  (GLint)h,     // srcY1
+			                  (GLint)0,     // dstX0
+			                  (GLint)0,     // dstY0
+			                  (GLint)w,     // dstX1
+			                  (GLint)h,     // dstY1
+			                  (GLbitfield)GL_COLOR_BUFFER_BIT, // mask
+			                  (GLenum)GL_LINEAR);              // filter
+
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		}
+		xrstats_view_end(xr, view_index);
+
+		const mat4_t view_projection = mat4_mul(projectionmatrices[view_index],
+				mat4_invert(mat4_mul(absolute, cammatrix)));
+		xrctrl_draw(xr, framebuffer, view_index, &view_projection,
+		            renderer_scene_depth(renderer));
+		xrstats_draw_overlay(xr, framebuffer, view_index);
+	}
 
 	/* if (leftHand) { */
 	/* 	mat4_t leftMatrix; */
@@ -624,6 +1036,68 @@ void renderFrame(renderer_t *renderer, int w, int h,
 	/* } */
 }
 
+/* Controllers drawn by candle as plain models of their body. */
+static void c_openxr_static_bodies(void)
+{
+	const char *sides[2] = {"right", "left"};
+
+	for (uint32_t h = 0; h < 2; h++)
+	{
+		char name[64];
+		mesh_t *levels[XR_LOD_LEVELS];
+		uint32_t level_count = 0;
+		c_xrbody_t *body = NULL;
+
+		/* binary cache first, parsing the OBJs takes a long time. The
+		 * shipped low_res meshes are LFS stubs, coarser levels are
+		 * decimated from the full mesh instead */
+		char path[512];
+		sprintf(name, "body_%s.obj", sides[h]);
+		const bool_t found = xr_resource_path(name, path, sizeof(path));
+		while (found && level_count < XR_LOD_LEVELS)
+		{
+			mesh_t *level = xrmesh_load_level(path, level_count);
+			if (!level)
+				break;
+			levels[level_count++] = level;
+		}
+		if (!level_count)
+			levels[level_count++] = sauces(name);
+
+		/* candle owns and describes the textures of its materials, the
+		 * compressed cache only feeds the plugin's own controllers. The
+		 * spec maps aren't shipped, a missing one reads as mid roughness */
+		mat_t *mat = mat_new(sides[h], "default");
+		sprintf(name, "valve_controller_knu_1_0_%s_diff.png", sides[h]);
+		mat1t(mat, ref("albedo.texture"), sauces(name));
+		mat1f(mat, ref("albedo.blend"), 1.0f);
+		sprintf(name, "valve_controller_knu_1_0_%s_spec.png", sides[h]);
+		texture_t *spec = sauces(name);
+		if (spec)
+		{
+			mat1t(mat, ref("roughness.texture"), spec);
+			mat1f(mat, ref("roughness.blend"), 1.0f);
+		}
+		else
+		{
+			mat1f(mat, ref("roughness.value"), 0.5f);
+		}
+		mat1f(mat, ref("metalness.value"), 0.5f);
+
+		sprintf(name, "/user/hand/%s", sides[h]);
+		entity_new({
+			body = c_xrbody_new(name);
+			/* shadows come from the coarse proxy when there are levels */
+			c_model_new(levels[0], mat, level_count == 1, true);
+		});
+		if (level_count > 1)
+		{
+			/* the knuckles fit in a 12 cm sphere around their origin */
+			c_xrbody_set_lod(body, levels, level_count, 0.12f, mat);
+		}
+	}
+}
+
 static void c_openxr_init_actions(struct openxr_internal *self)
 {
 
@@ -636,57 +1110,32 @@ static void c_openxr_init_actions(struct openxr_internal *self)
 		.localizedActionSetName = "Candle Action Set"
 	};
 	result = xrCreateActionSet(self->instance, &exampleSetInfo, &self->main_set);
-	mesh_t *right = sauces("body_right.obj");
-	mesh_t *left = sauces("body_left.obj");
-	mat_t *mat_right = mat_new("right", "default");
-	mat_t *mat_left = mat_new("left", "default");
-
-	mat1t(mat_left, ref("albedo.texture"), sauces("valve_controller_knu_1_0_left_diff.png"));
-	mat1f(mat_left, ref("albedo.blend"), 1.0f);
-	mat1t(mat_left, ref("roughness.texture"), sauces("valve_controller_knu_1_0_left_spec.png"));
-	mat1f(mat_left, ref("roughness.blend"), 1.0f);
-	mat1f(mat_left, ref("metalness.value"), 0.5f);
-
-	mat1t(mat_right, ref("albedo.texture"), sauces("valve_controller_knu_1_0_right_diff.png"));
-	mat1f(mat_right, ref("albedo.blend"), 1.0f);
-	mat1t(mat_right, ref("roughness.texture"), sauces("valve_controller_knu_1_0_right_spec.png"));
-	mat1f(mat_right, ref("roughness.blend"), 1.0f);
-	mat1f(mat_right, ref("metalness.value"), 0.5f);
-
-	entity_new({
-		c_xrbody_new("/user/hand/right");
-		c_model_new(right, mat_right, true, true);
-	});
-	entity_new({
-		c_xrbody_new("/user/hand/left");
-		c_model_new(left, mat_left, true, true);
-	});
-
-	/* for (int i = 0; i < 2; i++) */
-	do
+	/* candle's material shaders can't read the late latch corrections, so
+	 * late latched controllers are drawn by the plugin, at rest unless
+	 * animated */
+	self->controllers.enabled = self->controllers.animated || self->late_latch;
+	if (self->controllers.enabled)
 	{
-		XrPath interactionProfilePath;
-		/* if (i == 0) */
-			/* result = xrStringToPath(self->instance, "/interaction_profiles/khr/simple_controller", &interactionProfilePath); */
-		/* else */
-		result = xrStringToPath(self->instance, "/interaction_profiles/valve/index_controller", &interactionProfilePath);
-		if (!xr_result(self->instance, result, "failed to get interaction profile"))
-			continue;
-		const XrInteractionProfileSuggestedBinding suggestedBindings = {
-			.type = XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING,
-			.next = NULL,
-			.interactionProfile = interactionProfilePath,
-			.countSuggestedBindings = self->bindings_num,
-			.suggestedBindings = self->bindings
-		};
-
-		result = xrSuggestInteractionProfileBindings(self->instance, &suggestedBindings);
-		if (!xr_result(self->instance, result, "failed to suggest bindings"))
-			continue;
-
-	} while (0);
-
+		/* the bodies only track, the controllers draw themselves */
+		c_xrbody_t *right_body = NULL;
+		c_xrbody_t *left_body = NULL;
+		entity_new({
+			right_body = c_xrbody_new("/user/hand/right");
+		});
+		entity_new({
+			left_body = c_xrbody_new("/user/hand/left");
+		});
+		if (self->controllers.animated)
+			xrctrl_actions(self);
+		xrctrl_init(self, c_xrbody_late_latch_slot(right_body),
+		            c_xrbody_late_latch_slot(left_body));
+	}
+	else
+	{
+		c_openxr_static_bodies();
+	}
 
+	xraction_suggest(self);
 
 	XrSessionActionSetsAttachInfo attachInfo = {
 		.type = XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO,
@@ -735,107 +1184,298 @@ static mat4_t mat4_asymmetrical_perspective(const float tanAngleLeft,
 	return M;
 }
 
-int c_openxr_pre_draw(c_openxr_t *self)
+#ifdef _WIN32
+static DWORD WINAPI openxr_pacing_loop(void *data)
+#else
+static void *openxr_pacing_loop(void *data)
+#endif
 {
-	bool_t running = true;
-	bool_t isVisible = true;
-	XrResult result;
+	struct openxr_internal *self = data;
+	XrFrameWaitInfo frameWaitInfo = {.type = XR_TYPE_FRAME_WAIT_INFO,
+					 .next = NULL};
 
-	XrEventDataBuffer runtimeEvent = {.type = XR_TYPE_EVENT_DATA_BUFFER,
-					  .next = NULL};
-	bool_t isStopping = false;
-	XrResult pollResult = xrPollEvent(self->internal->instance, &runtimeEvent);
-	if (pollResult == XR_SUCCESS) {
-		switch (runtimeEvent.type) {
-		case XR_TYPE_EVENT_DATA_EVENTS_LOST: {
-			XrEventDataEventsLost* event = (XrEventDataEventsLost*)&runtimeEvent;
-			printf("EVENT: %d events data lost!\n", event->lostEventCount);
-			// do we care if the runtime loses events?
-			break;
-		}
-		case XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING: {
-			XrEventDataInstanceLossPending* event =
-			    (XrEventDataInstanceLossPending*)&runtimeEvent;
-			printf("EVENT: instance loss pending at %lu! Destroying instance.\n",
-			       (unsigned long)event->lossTime);
-			// Handling this: spec says destroy instance
-			// (can optionally recreate it)
-			running = false;
-			break;
-		}
-		case XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED: {
-			printf("EVENT: session state changed ");
-			XrEventDataSessionStateChanged* event =
-			    (XrEventDataSessionStateChanged*)&runtimeEvent;
-			XrSessionState state = event->state;
-
-			// it would be better to handle each state change
-			isVisible = event->state <= XR_SESSION_STATE_FOCUSED;
-			printf("to %d. Visible: %d", state, isVisible);
-			if (event->state >= XR_SESSION_STATE_STOPPING) {
-				printf("\nSession is in state stopping...");
-				isStopping = true;
-			}
-			printf("\n");
-			break;
-		}
-		case XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING: {
-			printf("EVENT: reference space change pending!\n");
-			XrEventDataReferenceSpaceChangePending* event =
-			    (XrEventDataReferenceSpaceChangePending*)&runtimeEvent;
-			(void)event;
-			// TODO: do something
-			break;
-		}
-		case XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED: {
-			printf("EVENT: interaction profile changed!\n");
-			XrEventDataInteractionProfileChanged* event =
-			    (XrEventDataInteractionProfileChanged*)&runtimeEvent;
-			(void)event;
-			// TODO: do something
+	for (;;)
+	{
+		/* sleep until the main thread began the previous frame */
+		xr_signal_lock(&self->pacing_signal);
+		while (xr_atomic_load(&self->pacing_running)
+		       && xr_atomic_load(&self->pacing_slot) != XR_FRAME_SLOT_EMPTY)
+			xr_signal_wait(&self->pacing_signal);
+		xr_signal_unlock(&self->pacing_signal);
+		if (!xr_atomic_load(&self->pacing_running))
 			break;
-		}
 
-		case XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR: {
-			printf("EVENT: visibility mask changed!!\n");
-			XrEventDataVisibilityMaskChangedKHR* event =
-			    (XrEventDataVisibilityMaskChangedKHR*)&runtimeEvent;
-			(void)event;
-			// this event is from an extension
-			break;
-		}
-		case XR_TYPE_EVENT_DATA_PERF_SETTINGS_EXT: {
-			printf("EVENT: perf settings!\n");
-			XrEventDataPerfSettingsEXT* event =
-			    (XrEventDataPerfSettingsEXT*)&runtimeEvent;
-			(void)event;
-			// this event is from an extension
+		self->pacing_frame_state.type = XR_TYPE_FRAME_STATE;
+		self->pacing_frame_state.next = NULL;
+		const uint64_t wait_start = xr_time_ns();
+		XrResult result = xrWaitFrame(self->session, &frameWaitInfo,
+		                              &self->pacing_frame_state);
+		if (!xr_result(self->instance, result, "pacing xrWaitFrame() failed"))
+		{
+			/* retrying would spin on a broken session */
+			xr_atomic_store(&self->pacing_slot, XR_FRAME_SLOT_FAILED);
 			break;
 		}
-		default: printf("Unhandled event type %d\n", runtimeEvent.type);
-		}
-	} else if (pollResult == XR_EVENT_UNAVAILABLE) {
-		// this is the usual case
-	} else {
-		printf("failed to poll events!\n");
+		self->pacing_wait = xr_time_ns() - wait_start;
+		xr_atomic_store(&self->pacing_slot, XR_FRAME_SLOT_READY);
+	}
+	return 0;
+}
+
+static void openxr_pacing_start(struct openxr_internal *self)
+{
+	xr_atomic_store(&self->pacing_slot, XR_FRAME_SLOT_EMPTY);
+	xr_atomic_store(&self->pacing_running, 1);
+#ifdef _WIN32
+	self->pacing_thread = CreateThread(NULL, 0, openxr_pacing_loop, self, 0, NULL);
+	if (!self->pacing_thread)
+#else
+	if (pthread_create(&self->pacing_thread, NULL, openxr_pacing_loop, self))
+#endif
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "failed to start frame pacing thread, waiting on main thread");
+		xr_atomic_store(&self->pacing_running, 0);
+		self->pipelined = false;
+	}
+}
+
+static void openxr_pacing_stop(struct openxr_internal *self)
+{
+	if (!xr_atomic_load(&self->pacing_running))
+		return;
+	xr_signal_lock(&self->pacing_signal);
+	xr_atomic_store(&self->pacing_running, 0);
+	xr_signal_notify(&self->pacing_signal);
+	xr_signal_unlock(&self->pacing_signal);
+#ifdef _WIN32
+	WaitForSingleObject(self->pacing_thread, INFINITE);
+	CloseHandle(self->pacing_thread);
+#else
+	pthread_join(self->pacing_thread, NULL);
+#endif
+}
+
+/* Lets the pacing thread wait for the next frame, called once the taken one
+ * was begun. */
+static void openxr_pacing_release(struct openxr_internal *self)
+{
+	xr_signal_lock(&self->pacing_signal);
+	xr_atomic_store(&self->pacing_slot, XR_FRAME_SLOT_EMPTY);
+	xr_signal_notify(&self->pacing_signal);
+	xr_signal_unlock(&self->pacing_signal);
+}
+
+/* Hands the frame state published by the pacing thread to the main thread,
+ * returns false if the compositor has not released the next frame yet. */
+static bool_t openxr_pacing_take(struct openxr_internal *self)
+{
+	const long slot = xr_atomic_load(&self->pacing_slot);
+	if (slot == XR_FRAME_SLOT_FAILED)
+	{
+		/* the thread is gone, waits happen on the main thread until the
+		 * session restarts */
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "frame pacing thread stopped, waiting on main thread");
+		openxr_pacing_stop(self);
+		return false;
+	}
+	if (slot != XR_FRAME_SLOT_READY)
+		return false;
+	self->frame_state = self->pacing_frame_state;
+	xrstats_waited(self, self->pacing_wait);
+	xr_atomic_store(&self->pacing_slot, XR_FRAME_SLOT_TAKEN);
+	return true;
+}
+
+static void openxr_session_begin(struct openxr_internal *self)
+{
+	XrSessionBeginInfo sessionBeginInfo = {.type = XR_TYPE_SESSION_BEGIN_INFO,
+	                                       .next = NULL,
+	                                       .primaryViewConfigurationType =
+	                                           XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO};
+	XrResult result = xrBeginSession(self->session, &sessionBeginInfo);
+	if (!xr_result(self->instance, result, "failed to begin session!"))
+		return;
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN, "session started");
+	self->session_running = true;
+	self->frame_waited = false;
+	if (self->pipelined)
+		openxr_pacing_start(self);
+}
+
+static void openxr_session_end(struct openxr_internal *self)
+{
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN, "ending session");
+	openxr_pacing_stop(self);
+	xrEndSession(self->session);
+	self->session_running = false;
+	self->frame_waited = false;
+}
+
+static void openxr_session_state_changed(struct openxr_internal *self,
+                                         XrEventDataSessionStateChanged *event)
+{
+	self->session_state = event->state;
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME, "session state changed to %d",
+	       (int)event->state);
+
+	switch (event->state) {
+	case XR_SESSION_STATE_READY:
+		openxr_session_begin(self);
+		break;
+	case XR_SESSION_STATE_STOPPING:
+		openxr_session_end(self);
+		break;
+	case XR_SESSION_STATE_EXITING:
+	case XR_SESSION_STATE_LOSS_PENDING:
+		if (self->session_running)
+			openxr_session_end(self);
+		/* nothing left to render to, stop trying */
+		self->failed = true;
+		break;
+	default:
+		break;
+	}
+}
+
+static void openxr_handle_event(struct openxr_internal *self,
+                                XrEventDataBuffer *runtimeEvent)
+{
+	switch (runtimeEvent->type) {
+	case XR_TYPE_EVENT_DATA_EVENTS_LOST: {
+		XrEventDataEventsLost* event = (XrEventDataEventsLost*)runtimeEvent;
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_RUNTIME, "%u events lost",
+		       event->lostEventCount);
+		break;
+	}
+	case XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING: {
+		XrEventDataInstanceLossPending* event =
+		    (XrEventDataInstanceLossPending*)runtimeEvent;
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_RUNTIME,
+		       "instance loss pending at %lld, stopping",
+		       (long long)event->lossTime);
+		// Handling this: spec says destroy instance
+		// (can optionally recreate it)
+		if (self->session_running)
+			openxr_session_end(self);
+		self->failed = true;
+		break;
+	}
+	case XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED: {
+		openxr_session_state_changed(self,
+				(XrEventDataSessionStateChanged*)runtimeEvent);
+		break;
+	}
+	case XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING: {
+		XrEventDataReferenceSpaceChangePending* event =
+		    (XrEventDataReferenceSpaceChangePending*)runtimeEvent;
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME,
+		       "reference space %d recentered", (int)event->referenceSpaceType);
+		/* the space keeps its handle, only the view history has to be
+		 * dropped once the new origin applies */
+		if (event->referenceSpaceType == XR_REFERENCE_SPACE_TYPE_LOCAL)
+			self->local_space_change = event->changeTime ? event->changeTime : 1;
+		break;
+	}
+	case XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED: {
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME, "interaction profile changed");
+		XrEventDataInteractionProfileChanged* event =
+		    (XrEventDataInteractionProfileChanged*)runtimeEvent;
+		(void)event;
+		break;
+	}
+
+	case XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR: {
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME, "visibility mask changed");
+		XrEventDataVisibilityMaskChangedKHR* event =
+		    (XrEventDataVisibilityMaskChangedKHR*)runtimeEvent;
+		(void)event;
+		// this event is from an extension, the mesh is rebuilt before the
+		// next view is drawn
+		xrmask_invalidate(self);
+		break;
+	}
+	case XR_TYPE_EVENT_DATA_PERF_SETTINGS_EXT: {
+		xr_log(OPENXR_LOG_VERBOSE, OPENXR_LOG_RUNTIME, "perf settings notification");
+		XrEventDataPerfSettingsEXT* event =
+		    (XrEventDataPerfSettingsEXT*)runtimeEvent;
+		(void)event;
+		// this event is from an extension
+		break;
+	}
+	default:
+		xr_log(OPENXR_LOG_VERBOSE, OPENXR_LOG_RUNTIME, "unhandled event type %d",
+		       (int)runtimeEvent->type);
+	}
+}
+
+/* Visible sessions are rendered, only focused ones receive input. */
+static bool_t openxr_session_visible(struct openxr_internal *self)
+{
+	return self->session_state == XR_SESSION_STATE_VISIBLE ||
+	       self->session_state == XR_SESSION_STATE_FOCUSED;
+}
+
+int c_openxr_pre_draw(c_openxr_t *self)
+{
+	XrResult result;
+
+	if (!self->internal->initiated || self->internal->failed)
 		return CONTINUE;
+
+	self->internal->actions_synced = false;
+
+	/* drain every pending event, bursts of state changes are common */
+	while (true) {
+		XrEventDataBuffer runtimeEvent = {.type = XR_TYPE_EVENT_DATA_BUFFER,
+		                                  .next = NULL};
+		XrResult pollResult = xrPollEvent(self->internal->instance, &runtimeEvent);
+		if (pollResult == XR_EVENT_UNAVAILABLE)
+			break; // this is the usual case
+		if (pollResult != XR_SUCCESS) {
+			xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "failed to poll events!");
+			return CONTINUE;
+		}
+		openxr_handle_event(self->internal, &runtimeEvent);
 	}
 
-	if (isStopping) {
-		printf("Ending session...\n");
-		xrEndSession(self->internal->session);
+	/* idle, stopping or lost, there is no frame to wait for */
+	if (!self->internal->session_running || self->internal->failed)
 		return CONTINUE;
+
+	if (self->internal->frame_waited)
+	{
+		/* the previous frame was never begun, its wait still stands */
 	}
-	//
-	// --- Wait for our turn to do head-pose dependent computation and render a
-	// frame
-	self->internal->frame_state.type = XR_TYPE_FRAME_STATE;
-	self->internal->frame_state.next = NULL;
-	XrFrameWaitInfo frameWaitInfo = {.type = XR_TYPE_FRAME_WAIT_INFO,
-					 .next = NULL};
-	result = xrWaitFrame(self->internal->session, &frameWaitInfo, &self->internal->frame_state);
-	if (!xr_result(self->internal->instance, result,
-		       "xrWaitFrame() was not successful, exiting..."))
+	else if (xr_atomic_load(&self->internal->pacing_running))
+	{
+		/* keep simulating, the frame is submitted once the pacing thread
+		 * got one from the compositor */
+		if (!openxr_pacing_take(self->internal))
+			return CONTINUE;
+		self->internal->frame_waited = true;
+	}
+	else
+	{
+		//
+		// --- Wait for our turn to do head-pose dependent computation and render a
+		// frame
+		self->internal->frame_state.type = XR_TYPE_FRAME_STATE;
+		self->internal->frame_state.next = NULL;
+		XrFrameWaitInfo frameWaitInfo = {.type = XR_TYPE_FRAME_WAIT_INFO,
+						 .next = NULL};
+		const uint64_t wait_start = xr_time_ns();
+		result = xrWaitFrame(self->internal->session, &frameWaitInfo, &self->internal->frame_state);
+		if (!xr_result(self->internal->instance, result,
+			       "xrWaitFrame() was not successful, exiting..."))
+			return CONTINUE;
+		xrstats_waited(self->internal, xr_time_ns() - wait_start);
+		self->internal->frame_waited = true;
+	}
+
+	/* input is only delivered to the focused session */
+	if (self->internal->session_state != XR_SESSION_STATE_FOCUSED)
 		return CONTINUE;
 
 	const XrActiveActionSet activeActionSet = {
@@ -850,12 +1490,160 @@ int c_openxr_pre_draw(c_openxr_t *self)
 	};
 
 	result = xrSyncActions(self->internal->session, &syncInfo);
-	xr_result(self->internal->instance, result, "failed to sync actions!");
-
+	self->internal->actions_synced = xr_result(self->internal->instance,
+			result, "failed to sync actions!");
+	if (self->internal->actions_synced)
+	{
+		xrinput_sample(self->internal);
+		if (self->renderer)
+			xrinput_models(self->internal, &self->renderer->glvars[0].model);
+		xrctrl_sample(self->internal);
+		xrhaptic_update(self->internal);
+	}
 
 	return CONTINUE;
 }
 
+/* Locates the bodies again right before a view is drawn. Only the
+ * difference to their world_pre_draw placement is uploaded, to the block at
+ * OPENXR_LATE_LATCH_BINDING, the nodes candle draws from are left as they
+ * were. */
+static void openxr_late_latch(struct openxr_internal *self)
+{
+	struct xr_input *input = &self->input;
+	mat4_t corrections[OPENXR_LATE_LATCH_MAX];
+	uint32_t count = input->count;
+
+	if (!self->late_latch || !count)
+		return;
+	if (count > OPENXR_LATE_LATCH_MAX)
+		count = OPENXR_LATE_LATCH_MAX;
+
+	/* without fresh input the pre_draw placement stands, corrections from
+	 * an earlier frame must not be applied to it */
+	mat4_t latched[OPENXR_LATE_LATCH_MAX];
+	if (self->actions_synced)
+	{
+		xrinput_locate(self);
+		xrpose_models(&input->locations[0].pose, sizeof(*input->locations), count,
+		              &self->actions.grip, NULL, latched, NULL);
+	}
+
+	const mat4_t inv_origin = mat4_invert(input->origin);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!self->actions_synced
+		    || !(input->locations[i].locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT))
+		{
+			corrections[i] = mat4();
+			continue;
+		}
+		mat4_t delta = mat4_mul(latched[i], mat4_invert(input->models[i]));
+		corrections[i] = mat4_mul(input->origin, mat4_mul(delta, inv_origin));
+	}
+
+	if (!self->late_latch_ubo)
+		glGenBuffers(1, &self->late_latch_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, self->late_latch_ubo);
+	/* orphaned, the previous view's draws may still read the old block */
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(corrections), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4_t) * count, corrections);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, OPENXR_LATE_LATCH_BINDING,
+	                 self->late_latch_ubo);
+}
+
+/* Locates the head again right before a view is drawn. The view's camera
+ * and the pose submitted for it both take the new pose, the field of view
+ * of the frame's first location is kept along with its projection. A
+ * failed or untracked location leaves the first one in place. */
+static void openxr_late_latch_view(struct openxr_internal *self, uint32_t view,
+                                   XrView *views, mat4_t *model)
+{
+	if (!self->late_latch)
+		return;
+
+	XrViewLocateInfo viewLocateInfo = {
+	    .type = XR_TYPE_VIEW_LOCATE_INFO,
+	    .next = NULL,
+	    .viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+	    .displayTime = self->frame_state.predictedDisplayTime,
+	    .space = self->local_space};
+	XrView latched[XR_MAX_VIEWS];
+	for (uint32_t i = 0; i < self->view_count; i++)
+	{
+		latched[i].type = XR_TYPE_VIEW;
+		latched[i].next = NULL;
+	}
+	XrViewState viewState = {.type = XR_TYPE_VIEW_STATE, .next = NULL};
+	uint32_t viewCountOutput = 0;
+	XrResult result = xrLocateViews(self->session, &viewLocateInfo, &viewState,
+	                                self->view_count, &viewCountOutput, latched);
+	if (XR_FAILED(result) || viewCountOutput <= view
+	    || !(viewState.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT))
+		return;
+
+	views[view].pose = latched[view].pose;
+	xrpose_models(&views[view].pose, sizeof(*views), 1, NULL, NULL, model, NULL);
+}
+
+/* Stops the session on results that leave nothing to render to. */
+static void openxr_check_loss(struct openxr_internal *self, XrResult result)
+{
+	if (result != XR_ERROR_SESSION_LOST && result != XR_ERROR_INSTANCE_LOST)
+		return;
+	if (self->session_running)
+		openxr_session_end(self);
+	self->failed = true;
+}
+
+/* Only an out of order xrBeginFrame leaves the wait standing, after any
+ * other failure the next frame has to wait again. */
+static void openxr_begin_failed(struct openxr_internal *self, XrResult result)
+{
+	openxr_check_loss(self, result);
+	if (result == XR_ERROR_CALL_ORDER_INVALID)
+		return;
+	self->frame_waited = false;
+	if (xr_atomic_load(&self->pacing_running))
+		openxr_pacing_release(self);
+}
+
+/* Ends a begun frame without layers. */
+static void openxr_end_frame_without_layers(struct openxr_internal *self)
+{
+	XrFrameEndInfo frameEndInfo = {
+	    .type = XR_TYPE_FRAME_END_INFO,
+	    .displayTime = self->frame_state.predictedDisplayTime,
+	    .layerCount = 0,
+	    .layers = NULL,
+	    .environmentBlendMode = self->xr_blend,
+	    .next = NULL};
+	XrResult result = xrEndFrame(self->session, &frameEndInfo);
+	xr_result(self->instance, result, "failed to end frame!");
+	xrstats_mark(self, XR_STATS_END_FRAME, 0);
+	openxr_check_loss(self, result);
+}
+
+/* Frames the compositor asked not to render still have to be begun and
+ * ended to keep the session running, they are submitted without layers. */
+static void openxr_end_empty_frame(struct openxr_internal *self)
+{
+	XrFrameBeginInfo frameBeginInfo = {.type = XR_TYPE_FRAME_BEGIN_INFO,
+					   .next = NULL};
+	XrResult result = xrBeginFrame(self->session, &frameBeginInfo);
+	if (!xr_result(self->instance, result, "failed to begin frame!"))
+	{
+		openxr_begin_failed(self, result);
+		return;
+	}
+	xrstats_mark(self, XR_STATS_BEGIN_FRAME, 0);
+	self->frame_waited = false;
+	if (xr_atomic_load(&self->pacing_running))
+		openxr_pacing_release(self);
+	openxr_end_frame_without_layers(self);
+}
+
 
 int c_openxr_draw(c_openxr_t *self)
 {
@@ -864,10 +1652,17 @@ int c_openxr_draw(c_openxr_t *self)
 		return CONTINUE;
 	if (!self->internal->initiated)
 	{
-		self->internal->failed = true;
-		openxr_internal_init(self->internal);
-		if (self->internal->initiated)
-			self->internal->failed = false;
+		openxr_boot_step(self);
+		return CONTINUE;
+	}
+	if (!self->internal->session_running || !self->internal->frame_waited)
+		return CONTINUE;
+	xrstats_begin(self->internal);
+	if (!self->internal->frame_state.shouldRender ||
+	    !openxr_session_visible(self->internal))
+	{
+		openxr_end_empty_frame(self->internal);
+		xrstats_end(self->internal, false);
 		return CONTINUE;
 	}
 
@@ -879,7 +1674,7 @@ int c_openxr_draw(c_openxr_t *self)
 	    .displayTime = self->internal->frame_state.predictedDisplayTime,
 	    .space = self->internal->local_space};
 
-	XrView views[512];
+	XrView views[XR_MAX_VIEWS];
 	for (uint32_t i = 0; i < self->internal->view_count; i++) {
 		views[i].type = XR_TYPE_VIEW;
 		views[i].next = NULL;
@@ -890,86 +1685,138 @@ int c_openxr_draw(c_openxr_t *self)
 	result = xrLocateViews(self->internal->session, &viewLocateInfo, &viewState,
 			       self->internal->view_count, &viewCountOutput, views);
 	if (!xr_result(self->internal->instance, result, "Could not locate views"))
+	{
+		/* the waited frame still has to be ended, and its record closed */
+		openxr_end_empty_frame(self->internal);
+		xrstats_end(self->internal, false);
 		return CONTINUE;
+	}
+
+	openxr_frame_throttle(self->internal);
+	xrres_update(self->internal);
 
 	// --- Begin frame
 	XrFrameBeginInfo frameBeginInfo = {.type = XR_TYPE_FRAME_BEGIN_INFO,
 					   .next = NULL};
 
+	xrstats_mark(self->internal, XR_STATS_IDLE, 0);
 	result = xrBeginFrame(self->internal->session, &frameBeginInfo);
 	if (!xr_result(self->internal->instance, result, "failed to begin frame!"))
-		exit(1);
+	{
+		xrstats_end(self->internal, false);
+		openxr_begin_failed(self->internal, result);
+		return CONTINUE;
+	}
+	xrstats_mark(self->internal, XR_STATS_BEGIN_FRAME, 0);
+	self->internal->frame_waited = false;
+	/* the next xrWaitFrame may now run alongside this frame's submission */
+	if (xr_atomic_load(&self->internal->pacing_running))
+		openxr_pacing_release(self->internal);
 
-	XrCompositionLayerProjectionView projection_views[512];
+	XrCompositionLayerProjectionView projection_views[XR_MAX_VIEWS];
 
 	mat4_t start = mat4();
 	if (self->renderer)
 		start = self->renderer->glvars[0].model;
 
-	// render each eye and fill projection_views with the result
+	mat4_t projections[XR_MAX_VIEWS];
+	mat4_t model_matrices[XR_MAX_VIEWS];
+	mat4_t world_matrices[XR_MAX_VIEWS];
+	xrpose_models(&views[0].pose, sizeof(*views), self->internal->view_count,
+	              NULL, &start, model_matrices, world_matrices);
+	if (self->internal->local_space_change
+	    && self->internal->frame_state.predictedDisplayTime
+	       >= self->internal->local_space_change)
+	{
+		/* recentered, motion against the old origin is meaningless */
+		for (uint32_t i = 0; i < self->internal->view_count; i++)
+			self->internal->views[i].previous_view =
+				mat4_invert(mat4_mul(start, model_matrices[i]));
+		self->internal->local_space_change = 0;
+	}
 	for (uint32_t i = 0; i < self->internal->view_count; i++) {
-		mat4_t projection;
 		const XrFovf fov = views[i].fov;
 		const float tanLeft = tanf(fov.angleLeft);
 		const float tanRight = tanf(fov.angleRight);
 		const float tanDown = tanf(fov.angleDown);
 		const float tanUp = tanf(fov.angleUp);
-		projection = mat4_asymmetrical_perspective(tanLeft, tanRight, tanUp,
+		projections[i] = mat4_asymmetrical_perspective(tanLeft, tanRight, tanUp,
 				tanDown, 0.1f, 1000.f);
 		/* projection = mat4_perspective((tanUp - tanDown), 1.f, 0.1f, 1000.f); */
 
-		vec3_t translation = vec3(_vec3(views[i].pose.position));
-		vec4_t rot_quat = vec4(_vec4(views[i].pose.orientation));
-		mat4_t rot_matrix = quat_to_mat4(rot_quat);
+		struct xr_lod *lod = &self->internal->lod;
+		lod->positions[i] = vec3(world_matrices[i]._[3][0],
+		                         world_matrices[i]._[3][1],
+		                         world_matrices[i]._[3][2]);
+		lod->pixels_per_meter[i] = self->internal->views[i].height
+		                         / (tanUp - tanDown);
+		lod->view_count = i + 1;
 
-		mat4_t model_matrix = mat4();
-		model_matrix = mat4_mul(model_matrix, mat4_translate(translation));
-		model_matrix = mat4_mul(model_matrix, rot_matrix);
+		projection_views[i].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
+		projection_views[i].next = NULL;
+		projection_views[i].pose = views[i].pose;
+		projection_views[i].fov = views[i].fov;
+		projection_views[i].subImage.swapchain = self->internal->swapchains[i];
+		projection_views[i].subImage.imageArrayIndex = 0;
+		projection_views[i].subImage.imageRect.offset.x = 0;
+		projection_views[i].subImage.imageRect.offset.y = 0;
+		projection_views[i].subImage.imageRect.extent.width =
+		    self->internal->views[i].width;
+		projection_views[i].subImage.imageRect.extent.height =
+		    self->internal->views[i].height;
+	}
 
+	// render each eye into its swapchain, one renderer_draw per view.
+	// candle's passes have no multiview targets or shaders to draw both
+	// eyes in a single pass with
+	bool_t submitted = true;
+	for (uint32_t i = 0; i < self->internal->swapchain_count && submitted; i++) {
 		XrSwapchainImageAcquireInfo swapchainImageAcquireInfo = {
 		    .type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO, .next = NULL};
 		uint32_t bufferIndex;
+		xrstats_mark(self->internal, XR_STATS_IDLE, i);
 		result = xrAcquireSwapchainImage(
 		    self->internal->swapchains[i], &swapchainImageAcquireInfo, &bufferIndex);
 		if (!xr_result(self->internal->instance, result,
 			       "failed to acquire swapchain image!"))
-			exit(1);
+		{
+			submitted = false;
+			break;
+		}
 
 		XrSwapchainImageWaitInfo swapchainImageWaitInfo = {
 		    .type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO,
 		    .next = NULL,
-		    .timeout = 1000};
+		    .timeout = XR_INFINITE_DURATION};
 		result =
 		    xrWaitSwapchainImage(self->internal->swapchains[i], &swapchainImageWaitInfo);
 		if (!xr_result(self->internal->instance, result,
 			       "failed to wait for swapchain image!"))
-			exit(1);
+		{
+			/* an acquired image must be released even unwritten */
+			XrSwapchainImageReleaseInfo releaseInfo = {
+			    .type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO, .next = NULL};
+			xrReleaseSwapchainImage(self->internal->swapchains[i], &releaseInfo);
+			submitted = false;
+			break;
+		}
+		xrstats_mark(self->internal, XR_STATS_SWAPCHAIN_WAIT, i);
 
-		projection_views[i].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
-		projection_views[i].next = NULL;
+		/* as close to the view's draw as the poses can be taken */
+		openxr_late_latch_view(self->internal, i, views, &model_matrices[i]);
 		projection_views[i].pose = views[i].pose;
-		projection_views[i].fov = views[i].fov;
-		projection_views[i].subImage.swapchain = self->internal->swapchains[i];
-		projection_views[i].subImage.imageArrayIndex = 0;
-		projection_views[i].subImage.imageRect.offset.x = 0;
-		projection_views[i].subImage.imageRect.offset.y = 0;
-		projection_views[i].subImage.imageRect.extent.width =
-		    self->internal->configuration_views[i].recommendedImageRectWidth;
-		projection_views[i].subImage.imageRect.extent.height =
-		    self->internal->configuration_views[i].recommendedImageRectHeight;
+		openxr_late_latch(self->internal);
 
+		xrres_begin(self->internal);
+		renderFrame(self->internal, i, self->renderer,
+				start, projections, model_matrices[i],
+				self->internal->framebuffers[i][bufferIndex],
+				self->internal->zero_copy);
+		xrres_end(self->internal);
 
-		uint32_t framebuffer = self->internal->framebuffers[i][bufferIndex];
-		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-				self->internal->images[i][bufferIndex].image, 0);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		renderFrame(self->renderer,
-				self->internal->configuration_views[i].recommendedImageRectWidth,
-				self->internal->configuration_views[i].recommendedImageRectHeight,
-				start, projection, model_matrix, &self->internal->previous_view[i],
-				framebuffer);
+		/* the runtime reads the image from its own context, the commands only
+		 * need to be submitted, not completed */
+		glFlush();
 
 		XrSwapchainImageReleaseInfo swapchainImageReleaseInfo = {
 		    .type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO, .next = NULL};
@@ -977,8 +1824,22 @@ int c_openxr_draw(c_openxr_t *self)
 						 &swapchainImageReleaseInfo);
 		if (!xr_result(self->internal->instance, result,
 			       "failed to release swapchain image!"))
-			exit(1);
+			submitted = false;
 	}
+	if (!submitted)
+	{
+		/* the begun frame is ended without the views it could not draw */
+		openxr_end_frame_without_layers(self->internal);
+		xrstats_end(self->internal, false);
+		openxr_check_loss(self->internal, result);
+		return CONTINUE;
+	}
+
+	/* static panels keep their last released image */
+	xrquad_draw(self->internal);
+
+	xrres_submit(self->internal);
+	openxr_frame_fence(self->internal);
 
 	XrCompositionLayerProjection projectionLayer = {
 	    .type = XR_TYPE_COMPOSITION_LAYER_PROJECTION,
@@ -989,17 +1850,24 @@ int c_openxr_draw(c_openxr_t *self)
 	    .views = projection_views,
 	};
 
-	const XrCompositionLayerBaseHeader* const submittedLayers[] = {
-	    (const XrCompositionLayerBaseHeader* const) & projectionLayer };
-	    /* (const XrCompositionLayerBaseHeader* const) & quadLayer}; */
+	XrCompositionLayerQuad quadLayers[XR_MAX_QUADS];
+	const uint32_t quad_count = xrquad_layers(self->internal, quadLayers);
+
+	const XrCompositionLayerBaseHeader* submittedLayers[1 + XR_MAX_QUADS] = {
+	    (const XrCompositionLayerBaseHeader*) & projectionLayer };
+	for (uint32_t i = 0; i < quad_count; i++)
+		submittedLayers[1 + i] = (const XrCompositionLayerBaseHeader*) & quadLayers[i];
 	XrFrameEndInfo frameEndInfo = {
 	    .type = XR_TYPE_FRAME_END_INFO,
 	    .displayTime = self->internal->frame_state.predictedDisplayTime,
-	    .layerCount = sizeof(submittedLayers) / sizeof(submittedLayers[0]),
+	    .layerCount = 1 + quad_count,
 	    .layers = submittedLayers,
 	    .environmentBlendMode = self->internal->xr_blend,
 	    .next = NULL};
+	xrstats_mark(self->internal, XR_STATS_IDLE, 0);
 	result = xrEndFrame(self->internal->session, &frameEndInfo);
+	xrstats_mark(self->internal, XR_STATS_END_FRAME, 0);
+	xrstats_end(self->internal, true);
 	if (!xr_result(self->internal->instance, result, "failed to end frame!"))
 		return CONTINUE;
 	return CONTINUE;
@@ -1012,10 +1880,120 @@ c_openxr_t *c_openxr_new()
 	return self;
 }
 
+void c_openxr_set_pipelined(c_openxr_t *self, bool_t pipelined)
+{
+	if (xr_atomic_load(&self->internal->boot_stage) != XR_BOOT_IDLE)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "c_openxr_set_pipelined must be called before the first frame");
+		return;
+	}
+	self->internal->pipelined = pipelined;
+}
+
+void c_openxr_set_dynamic_resolution(c_openxr_t *self, bool_t enabled,
+                                     float min_scale, float max_scale)
+{
+	if (xr_atomic_load(&self->internal->boot_stage) != XR_BOOT_IDLE)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "c_openxr_set_dynamic_resolution must be called before the first frame");
+		return;
+	}
+	self->internal->resolution.enabled = enabled;
+	xrres_range(&self->internal->resolution, min_scale, max_scale);
+}
+
+void c_openxr_set_graphics_binding(c_openxr_t *self, uint32_t binding)
+{
+	if (xr_atomic_load(&self->internal->boot_stage) != XR_BOOT_IDLE)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "c_openxr_set_graphics_binding must be called before the first frame");
+		return;
+	}
+	self->internal->graphics = binding;
+}
+
+void c_openxr_track_velocity(c_openxr_t *self, bool_t track, float smoothing)
+{
+	xrinput_track_velocity(&self->internal->input, track, smoothing);
+}
+
+void c_openxr_set_late_latch(c_openxr_t *self, bool_t late_latch)
+{
+	if (xr_atomic_load(&self->internal->boot_stage) != XR_BOOT_IDLE)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "c_openxr_set_late_latch must be called before the first frame");
+		return;
+	}
+	self->internal->late_latch = late_latch;
+}
+
+void c_openxr_set_animated_controllers(c_openxr_t *self, bool_t animated)
+{
+	if (xr_atomic_load(&self->internal->boot_stage) != XR_BOOT_IDLE)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "c_openxr_set_animated_controllers must be called before the first frame");
+		return;
+	}
+	self->internal->controllers.animated = animated;
+}
+
+void c_openxr_set_log_filter(c_openxr_t *self, uint32_t min_severity,
+                             uint32_t categories)
+{
+	xrlog_filter(min_severity, categories);
+}
+
+/* Runs on the render thread with the context current. Handles created
+ * under the instance that have no GL side, like actions and action spaces,
+ * go with it. */
 void c_openxr_destroy(c_openxr_t *self)
 {
-	xrDestroySession(self->internal->session);
-	xrDestroyInstance(self->internal->instance);
+	struct openxr_internal *xr = self->internal;
+	/* the instance may still be in the making */
+	openxr_boot_join(xr);
+	openxr_pacing_stop(xr);
+	xr_signal_destroy(&xr->pacing_signal);
+	for (uint32_t i = 0; i < XR_MAX_QUADS; i++)
+		xrquad_destroy(xr, i);
+	for (uint32_t i = 0; i < XR_MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (xr->frame_fences[i])
+			glDeleteSync(xr->frame_fences[i]);
+	}
+	openxr_swapchains_destroy(xr);
+	for (uint32_t i = 0; xr->views && i < xr->view_count; i++)
+	{
+		if (xr->views[i].renderer)
+			renderer_destroy(xr->views[i].renderer);
+	}
+	free(xr->views);
+	free(xr->configuration_views);
+	xrctrl_destroy(xr);
+	xrmask_destroy(xr);
+	xrstats_destroy(xr);
+	xrres_destroy(xr);
+	glDeleteBuffers(1, &xr->late_latch_ubo);
+
+	if (xr->local_space)
+		xrDestroySpace(xr->local_space);
+	if (xr->session)
+		xrDestroySession(xr->session);
+	if (xr_debug && ext_xrDestroyDebugUtilsMessengerEXT)
+		ext_xrDestroyDebugUtilsMessengerEXT(xr_debug);
+	xr_debug = XR_NULL_HANDLE;
+	if (xr->instance)
+		xrDestroyInstance(xr->instance);
+	xrinput_destroy(&xr->input);
+	xraction_destroy(xr);
+	xrhaptic_destroy(&xr->haptics);
+	xrlog_stop();
+	free(xr);
+	self->internal = NULL;
 }
 
 void ct_openxr(ct_t *self)
@@ -4,15 +4,167 @@
 #include "../candle/ecs/ecm.h"
 #include "../candle/utils/renderer.h"
 
+/* Uniform block filled in late latch mode, shaders drawing tracked bodies
+ * pre-multiply their model matrix with the correction of their slot:
+ * layout(std140) uniform xr_late_latch { mat4 correction[64]; }; */
+#define OPENXR_LATE_LATCH_BINDING 15
+#define OPENXR_LATE_LATCH_MAX 64
+
+typedef void(*openxr_pipeline_cb)(renderer_t *renderer);
+
+/* log severities and categories, see c_openxr_set_log_filter */
+enum
+{
+	OPENXR_LOG_VERBOSE,
+	OPENXR_LOG_INFO,
+	OPENXR_LOG_WARNING,
+	OPENXR_LOG_ERROR
+};
+enum
+{
+	/* failed OpenXR calls */
+	OPENXR_LOG_CALLS   = 1 << 0,
+	/* messages of the runtime's debug messenger */
+	OPENXR_LOG_RUNTIME = 1 << 1,
+	OPENXR_LOG_PLUGIN  = 1 << 2,
+	OPENXR_LOG_ALL     = 0x7
+};
+
 typedef struct c_openxr
 {
 	c_t super;
 	struct openxr_internal *internal;
 	renderer_t *renderer;
+	/* when set, every view gets its own renderer built by this callback,
+	 * with targets and temporal history of its own. Otherwise all views
+	 * share the renderer above and its targets */
+	openxr_pipeline_cb view_pipeline;
 } c_openxr_t;
 
 DEF_CASTER(ct_openxr, c_openxr, c_openxr_t)
 
 c_openxr_t *c_openxr_new();
+/* Moves xrWaitFrame to a pacing thread so simulation does not block on the
+ * compositor. Must be called before the first frame is drawn. */
+void c_openxr_set_pipelined(c_openxr_t *self, bool_t pipelined);
+
+/* window systems the session can share the GL context through */
+enum
+{
+	OPENXR_GRAPHICS_AUTO,
+	OPENXR_GRAPHICS_WIN32,
+	OPENXR_GRAPHICS_XLIB,
+	OPENXR_GRAPHICS_EGL
+};
+/* By default the binding follows the context current when the session is
+ * created, EGL when an EGL context is current, GLX otherwise. Must be
+ * called before the first frame is drawn. */
+void c_openxr_set_graphics_binding(c_openxr_t *self, uint32_t binding);
+/* Creates a GL 3.3 core context on EGL's surfaceless platform and makes it
+ * current, to run without a display server. The runtime has to support
+ * XR_MNDX_egl_enable. */
+bool_t openxr_surfaceless_context(void);
+/* Scales the rendered area of every view between min_scale and max_scale
+ * of the recommended size to stay within the display period, based on
+ * measured GPU time. Scales above 1 supersample, each view's swapchain is
+ * capped at the runtime's maxImageRect. Both are swapped when out of
+ * order. Must be called before the first frame is drawn. */
+void c_openxr_set_dynamic_resolution(c_openxr_t *self, bool_t enabled,
+                                     float min_scale, float max_scale);
+/* Chains velocity queries to the body pose queries. Smoothing in [0, 1)
+ * low-pass filters the velocities used for extrapolation. */
+void c_openxr_track_velocity(c_openxr_t *self, bool_t track, float smoothing);
+/* Re-locates the head and the first OPENXR_LATE_LATCH_MAX tracked bodies
+ * right before each view is drawn. The view is drawn and submitted with
+ * the new head pose. For the bodies only the difference to their
+ * world_pre_draw placement is written, to a uniform buffer at
+ * OPENXR_LATE_LATCH_BINDING indexed with c_xrbody_late_latch_slot, and
+ * their nodes are not moved. Candle's material shaders can't read it, so
+ * the controllers are drawn by the plugin instead, at rest unless
+ * animated. Other shaders drawing bodies have to apply it themselves. Must
+ * be called before the first frame is drawn. */
+void c_openxr_set_late_latch(c_openxr_t *self, bool_t late_latch);
+/* Draws the controllers from the parts of their component layout, animated
+ * by the trigger, thumbstick, trackpad, squeeze and buttons, in a single
+ * draw per hand. Only controllers the plugin draws, these or late latched
+ * ones, use the block compressed texture cache, the default static models
+ * are candle materials whose textures candle decodes from PNG. Must be
+ * called before the first frame is drawn. */
+void c_openxr_set_animated_controllers(c_openxr_t *self, bool_t animated);
+/* Drops log records below min_severity or outside the categories mask.
+ * Records are written by a background thread and repeated ones are rate
+ * limited per call site. Takes effect for the runtime's debug messenger if
+ * called before the first frame. */
+void c_openxr_set_log_filter(c_openxr_t *self, uint32_t min_severity,
+                             uint32_t categories);
+
+/* Timing of one frame in microseconds, see c_openxr_set_stats. GPU times
+ * are filled a few frames later, once gpu_valid is set. */
+#define OPENXR_STATS_VIEWS 4
+struct openxr_frame_stats
+{
+	uint64_t frame;
+	int64_t display_time;
+	uint32_t display_period;
+	/* display periods skipped since the previous frame */
+	uint32_t missed;
+	uint32_t rendered;
+	uint32_t gpu_valid;
+	uint32_t wait_frame;
+	uint32_t begin_frame;
+	uint32_t end_frame;
+	uint32_t cpu_total;
+	uint32_t view_count;
+	uint32_t swapchain_wait[OPENXR_STATS_VIEWS];
+	uint32_t draw_cpu[OPENXR_STATS_VIEWS];
+	uint32_t blit_cpu[OPENXR_STATS_VIEWS];
+	uint32_t draw_gpu[OPENXR_STATS_VIEWS];
+	uint32_t blit_gpu[OPENXR_STATS_VIEWS];
+};
+
+struct openxr_stats_totals
+{
+	uint64_t frames;
+	uint64_t not_rendered;
+	uint64_t missed;
+};
+
+/* Records the time blocked in xrWaitFrame, xrBeginFrame and xrEndFrame,
+ * the swapchain image waits and the CPU and GPU time of the draw and copy
+ * of each view, for the last frames. The overlay graphs them below the
+ * center of the views. */
+void c_openxr_set_stats(c_openxr_t *self, bool_t enabled, bool_t overlay);
+/* Copies up to max of the recorded frames, oldest first. Returns the count. */
+uint32_t c_openxr_stats(c_openxr_t *self, struct openxr_frame_stats *frames,
+                        uint32_t max);
+struct openxr_stats_totals c_openxr_stats_totals(c_openxr_t *self);
+/* Writes the recorded frames as CSV when path ends in .csv, otherwise as
+ * a header of magic, version, record size and count followed by the raw
+ * records. */
+bool_t c_openxr_stats_dump(c_openxr_t *self, const char *path);
+
+/* One constant segment of a haptic pattern, see c_xrbody_haptic_pattern.
+ * A frequency of 0 lets the runtime pick. */
+struct openxr_haptic_step
+{
+	float duration;
+	float amplitude;
+	float frequency;
+};
+/* repeat count of patterns that play until cancelled */
+#define OPENXR_HAPTIC_FOREVER 0xffffffffu
+
+/* Shows the output of a UI renderer on a quad layer of size_x by size_y
+ * meters, composited from its own width by height swapchain. The renderer is
+ * only drawn again after c_openxr_quad_invalidate. Returns the quad's id. */
+uint32_t c_openxr_add_quad(c_openxr_t *self, renderer_t *renderer,
+                           uint32_t width, uint32_t height,
+                           float size_x, float size_y);
+/* Places the quad's center in the tracking space. */
+void c_openxr_quad_set_pose(c_openxr_t *self, uint32_t quad,
+                            vec3_t position, vec4_t orientation);
+void c_openxr_quad_set_visible(c_openxr_t *self, uint32_t quad, bool_t visible);
+void c_openxr_quad_invalidate(c_openxr_t *self, uint32_t quad);
+void c_openxr_remove_quad(c_openxr_t *self, uint32_t quad);
 
 #endif /* !OPENXR_H */
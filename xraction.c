@@ -0,0 +1,213 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Action manifest. Every tracked body gets the actions declared below, and
+ * their bindings are collected per interaction profile and suggested in
+ * one call per profile once all bodies exist. Paths are interned in a hash
+ * table, so each string reaches xrStringToPath once per instance. */
+
+static const char *const xraction_profiles[XR_PROFILE_COUNT] = {
+	[XR_PROFILE_INDEX] = "/interaction_profiles/valve/index_controller",
+	[XR_PROFILE_SIMPLE] = "/interaction_profiles/khr/simple_controller",
+};
+
+/* Actions of a tracked body, with the input each profile binds them to
+ * relative to the body's path, NULL when a profile lacks it. */
+struct xr_action_decl
+{
+	const char *name;
+	XrActionType type;
+	size_t offset;
+	const char *inputs[XR_PROFILE_COUNT];
+};
+
+static const struct xr_action_decl xraction_body[] = {
+	{"trigger", XR_ACTION_TYPE_FLOAT_INPUT, offsetof(struct xrbody_internal, grabAction),
+	 {"/input/trigger/value", "/input/select/click"}},
+	{"lever", XR_ACTION_TYPE_FLOAT_INPUT, offsetof(struct xrbody_internal, leverAction),
+	 {"/input/thumbstick/y", NULL}},
+	{"handpose", XR_ACTION_TYPE_POSE_INPUT, offsetof(struct xrbody_internal, poseAction),
+	 {"/input/grip/pose", "/input/grip/pose"}},
+	{"haptic", XR_ACTION_TYPE_VIBRATION_OUTPUT, offsetof(struct xrbody_internal, hapticAction),
+	 {"/output/haptic", "/output/haptic"}},
+};
+
+#define XRACTION_BODY_COUNT (sizeof(xraction_body) / sizeof(*xraction_body))
+
+/* ------------------------------------------------------------------------ */
+/* interned paths */
+
+static struct xr_path_entry *xraction_find(struct xr_actions *self,
+                                           const char *string, uint64_t hash)
+{
+	uint32_t mask = self->path_capacity - 1;
+	uint32_t i = (uint32_t)hash & mask;
+	while (self->paths[i].string)
+	{
+		if (self->paths[i].hash == hash && !strcmp(self->paths[i].string, string))
+			break;
+		i = (i + 1) & mask;
+	}
+	return &self->paths[i];
+}
+
+static void xraction_grow(struct xr_actions *self)
+{
+	struct xr_path_entry *old = self->paths;
+	const uint32_t old_capacity = self->path_capacity;
+
+	self->path_capacity = old_capacity ? old_capacity * 2 : 64;
+	self->paths = calloc(self->path_capacity, sizeof(*self->paths));
+	for (uint32_t i = 0; i < old_capacity; i++)
+	{
+		if (old[i].string)
+			*xraction_find(self, old[i].string, old[i].hash) = old[i];
+	}
+	free(old);
+}
+
+/* Path of a string, asking the runtime only the first time it is seen. */
+XrPath xr_path(struct openxr_internal *xr, const char *string)
+{
+	struct xr_actions *self = &xr->actions;
+	const uint64_t hash = xr_hash((const uint8_t*)string, strlen(string));
+
+	if ((self->path_count + 1) * 2 > self->path_capacity)
+		xraction_grow(self);
+	struct xr_path_entry *entry = xraction_find(self, string, hash);
+	if (entry->string)
+		return entry->path;
+
+	XrPath path = XR_NULL_PATH;
+	XrResult result = xrStringToPath(xr->instance, string, &path);
+	if (!xr_result(xr->instance, result, "failed to create path %s", string))
+		return XR_NULL_PATH;
+	entry->hash = hash;
+	entry->string = strdup(string);
+	entry->path = path;
+	self->path_count++;
+	return path;
+}
+
+/* Interned path of prefix followed by suffix. */
+XrPath xr_path_join(struct openxr_internal *xr, const char *prefix,
+                    const char *suffix)
+{
+	char buffer[XR_MAX_PATH_LENGTH];
+	snprintf(buffer, sizeof(buffer), "%s%s", prefix, suffix);
+	return xr_path(xr, buffer);
+}
+
+/* ------------------------------------------------------------------------ */
+/* bindings */
+
+void xraction_bind(struct openxr_internal *xr, uint32_t profile,
+                   XrAction action, XrPath binding)
+{
+	struct xr_actions *self = &xr->actions;
+	if (binding == XR_NULL_PATH || profile >= XR_PROFILE_COUNT)
+		return;
+	if (self->binding_count[profile] == self->binding_capacity[profile])
+	{
+		self->binding_capacity[profile] = self->binding_capacity[profile]
+		                                ? self->binding_capacity[profile] * 2 : 32;
+		self->bindings[profile] = realloc(self->bindings[profile],
+				sizeof(*self->bindings[profile]) * self->binding_capacity[profile]);
+	}
+	XrActionSuggestedBinding *suggested =
+		&self->bindings[profile][self->binding_count[profile]++];
+	suggested->action = action;
+	suggested->binding = binding;
+}
+
+/* Creates the manifest's actions for the body at path and queues their
+ * bindings. Names only need to be unique, the body's index makes them so. */
+bool_t xraction_body(struct openxr_internal *xr, struct xrbody_internal *body,
+                     const char *path)
+{
+	struct xr_actions *self = &xr->actions;
+	const uint32_t index = self->body_count++;
+	XrResult result;
+
+	/* rotation, in degrees, and origin of the grip pose in the controller
+	 * mesh. The mesh drawn is always the Index one, whatever profile the
+	 * runtime emulates on the controller held, so every body uses it. */
+	if (!index)
+		self->grip = xrpose_offset(vec3(15.392f, 2.071f, 0.303f),
+		                           vec3(0.0f, -0.015f, 0.13f));
+
+	body->path = xr_path(xr, path);
+	if (body->path == XR_NULL_PATH)
+		return false;
+
+	for (uint32_t i = 0; i < XRACTION_BODY_COUNT; i++)
+	{
+		const struct xr_action_decl *decl = &xraction_body[i];
+		XrAction *action = (XrAction*)((char*)body + decl->offset);
+		XrActionCreateInfo actionInfo = {
+			.type = XR_TYPE_ACTION_CREATE_INFO,
+			.next = NULL,
+			.actionType = decl->type,
+			.countSubactionPaths = 1,
+			.subactionPaths = &body->path
+		};
+		snprintf(actionInfo.actionName, sizeof(actionInfo.actionName),
+		         "body%u_%s", index, decl->name);
+		snprintf(actionInfo.localizedActionName,
+		         sizeof(actionInfo.localizedActionName), "%s %s", path, decl->name);
+
+		result = xrCreateAction(xr->main_set, &actionInfo, action);
+		if (!xr_result(xr->instance, result, "failed to create %s action",
+		               decl->name))
+			return false;
+
+		for (uint32_t p = 0; p < XR_PROFILE_COUNT; p++)
+		{
+			if (decl->inputs[p])
+				xraction_bind(xr, p, *action, xr_path_join(xr, path, decl->inputs[p]));
+		}
+	}
+	xr_log(OPENXR_LOG_VERBOSE, OPENXR_LOG_PLUGIN, "bound %u actions of %s",
+	       (uint32_t)XRACTION_BODY_COUNT, path);
+	return true;
+}
+
+/* Suggests every profile's bindings in one call each, before the action
+ * set is attached. */
+void xraction_suggest(struct openxr_internal *xr)
+{
+	struct xr_actions *self = &xr->actions;
+	for (uint32_t p = 0; p < XR_PROFILE_COUNT; p++)
+	{
+		if (!self->binding_count[p])
+			continue;
+		const XrPath profile = xr_path(xr, xraction_profiles[p]);
+		if (profile == XR_NULL_PATH)
+			continue;
+		const XrInteractionProfileSuggestedBinding suggestedBindings = {
+			.type = XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING,
+			.next = NULL,
+			.interactionProfile = profile,
+			.countSuggestedBindings = self->binding_count[p],
+			.suggestedBindings = self->bindings[p]
+		};
+		XrResult result = xrSuggestInteractionProfileBindings(xr->instance,
+		                                                      &suggestedBindings);
+		xr_result(xr->instance, result, "failed to suggest bindings for %s",
+		          xraction_profiles[p]);
+	}
+}
+
+void xraction_destroy(struct openxr_internal *xr)
+{
+	struct xr_actions *self = &xr->actions;
+	for (uint32_t i = 0; i < self->path_capacity; i++)
+		free(self->paths[i].string);
+	free(self->paths);
+	for (uint32_t p = 0; p < XR_PROFILE_COUNT; p++)
+		free(self->bindings[p]);
+	memset(self, 0, sizeof(*self));
+}
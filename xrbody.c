@@ -2,98 +2,17 @@
 #include "xrbody.h"
 #include "../candle/components/camera.h"
 #include "../candle/components/node.h"
+#include "../candle/components/model.h"
 
 #include "internals.h"
 
-int xrbody_internal_init(struct xrbody_internal *self, entity_t entity, const char *path)
+int xrbody_internal_init(struct xrbody_internal *self, const char *path)
 {
 	XrResult result;
 	struct openxr_internal *xr = c_openxr(&SYS)->internal;
-	char *end;
-	char buffer[256];
-#ifdef _WIN32
-	sprintf(buffer, "ent_%I64u", entity);
-#elif __EMSCRIPTEN__
-	sprintf(buffer, "ent_%lld", entity);
-#else
-	sprintf(buffer, "ent_%ld", entity);
-#endif
-	end = &buffer[strlen(buffer)];
-	result = xrStringToPath(xr->instance, path, &self->path);
-	if (!xr_result(xr->instance, result, "failed to create path"))
-		return 1;
-
-	{
-		XrActionCreateInfo actionInfo = {
-			.type = XR_TYPE_ACTION_CREATE_INFO,
-			.next = NULL,
-			.actionType = XR_ACTION_TYPE_FLOAT_INPUT,
-			.countSubactionPaths = 1,
-			.subactionPaths = &self->path
-		};
-		strcpy(end, "_trigger");
-		strcpy(actionInfo.actionName, buffer);
-		strcpy(end, "_trigger local");
-		strcpy(actionInfo.localizedActionName, buffer);
-
-		result = xrCreateAction(xr->main_set, &actionInfo, &self->grabAction);
-		if (!xr_result(xr->instance, result, "failed to create grab action"))
-			return 1;
-	}
-
-	// just an example that could sensibly use one axis of e.g. a thumbstick
-	{
-		XrActionCreateInfo actionInfo = {
-			.type = XR_TYPE_ACTION_CREATE_INFO,
-			.next = NULL,
-			.actionType = XR_ACTION_TYPE_FLOAT_INPUT,
-			.countSubactionPaths = 1,
-			.subactionPaths = &self->path
-		};
-		strcpy(end, "_lever");
-		strcpy(actionInfo.actionName, buffer);
-		strcpy(end, "_lever local");
-		strcpy(actionInfo.localizedActionName, buffer);
-
-		result = xrCreateAction(xr->main_set, &actionInfo, &self->leverAction);
-		if (!xr_result(xr->instance, result, "failed to create lever action"))
-			return 1;
-	}
-
-	{
-		XrActionCreateInfo actionInfo = {
-			.type = XR_TYPE_ACTION_CREATE_INFO,
-			.next = NULL,
-			.actionType = XR_ACTION_TYPE_POSE_INPUT,
-			.countSubactionPaths = 1,
-			.subactionPaths = &self->path
-		};
-		strcpy(end, "_handpose");
-		strcpy(actionInfo.actionName, buffer);
-		strcpy(end, "_handpose local");
-		strcpy(actionInfo.localizedActionName, buffer);
-
-		result = xrCreateAction(xr->main_set, &actionInfo, &self->poseAction);
-		if (!xr_result(xr->instance, result, "failed to create pose action"))
-			return 1;
-	}
 
-	{
-		XrActionCreateInfo actionInfo = {
-			.type = XR_TYPE_ACTION_CREATE_INFO,
-			.next = NULL,
-			.actionType = XR_ACTION_TYPE_VIBRATION_OUTPUT,
-			.countSubactionPaths = 1,
-			.subactionPaths = &self->path
-		};
-		strcpy(end, "_haptic");
-		strcpy(actionInfo.actionName, buffer);
-		strcpy(end, "_haptic local");
-		strcpy(actionInfo.localizedActionName, buffer);
-		result = xrCreateAction(xr->main_set, &actionInfo, &self->hapticAction);
-		if (!xr_result(xr->instance, result, "failed to create haptic action"))
-			return 1;
-	}
+	if (!xraction_body(xr, self, path))
+		return 1;
 
 	XrActionSpaceCreateInfo actionSpaceInfo = {
 		.type = XR_TYPE_ACTION_SPACE_CREATE_INFO,
@@ -103,43 +22,15 @@ int xrbody_internal_init(struct xrbody_internal *self, entity_t entity, const ch
 		.subactionPath = self->path
 	};
 
-	XrPath selectClickPath;
-	XrPath triggerValuePath;
-	XrPath thumbstickYPath;
-	XrPath posePath;
-	XrPath hapticPath;
-
-	strcpy(buffer, path);
-	end = &buffer[strlen(buffer)];
-	strcpy(end, "/input/select/click");
-	printf("%s\n", buffer);
-	xrStringToPath(xr->instance, buffer, &selectClickPath);
-	strcpy(end, "/input/trigger/value");
-	printf("%s\n", buffer);
-	xrStringToPath(xr->instance, buffer, &triggerValuePath);
-	strcpy(end, "/input/thumbstick/y");
-	printf("%s\n", buffer);
-	xrStringToPath(xr->instance, buffer, &thumbstickYPath);
-	strcpy(end, "/input/grip/pose");
-	printf("%s\n", buffer);
-	xrStringToPath(xr->instance, buffer, &posePath);
-	strcpy(end, "/output/haptic");
-	printf("%s\n", buffer);
-	xrStringToPath(xr->instance, buffer, &hapticPath);
-
-	xr->bindings[xr->bindings_num  ].action = self->poseAction;
-	xr->bindings[xr->bindings_num++].binding = posePath;
-	xr->bindings[xr->bindings_num  ].action = self->grabAction;
-	xr->bindings[xr->bindings_num++].binding = triggerValuePath;
-	xr->bindings[xr->bindings_num  ].action = self->leverAction;
-	xr->bindings[xr->bindings_num++].binding = thumbstickYPath;
-	xr->bindings[xr->bindings_num  ].action = self->hapticAction;
-	xr->bindings[xr->bindings_num++].binding = hapticPath;
-
 	result = xrCreateActionSpace(xr->session, &actionSpaceInfo, &self->space);
 	if (!xr_result(xr->instance, result, "failed to create left hand pose space"))
 		return 1;
 
+	self->input_slot = xrinput_register(&xr->input, self->space, self->path,
+	                                    self->grabAction, self->leverAction);
+	self->haptic_slot = xrhaptic_register(&xr->haptics, self->hapticAction,
+	                                      self->path);
+
 	self->initiated = true;
 	return 0;
 }
@@ -149,124 +40,126 @@ void c_xrbody_init(c_xrbody_t *self)
 	self->internal = calloc(sizeof(*self->internal), 1);
 }
 
+/* The model's mesh is shared by every view and pass candle draws it in, it
+ * gets the level the most demanding view needs. Shadows always come from
+ * the coarsest level through the proxy, which never shows in the views. */
+static void c_xrbody_update_lod(c_xrbody_t *self, mat4_t world)
+{
+	struct xrbody_internal *internal = self->internal;
+	struct openxr_internal *xr = c_openxr(&SYS)->internal;
+	const vec3_t center = vec4_xyz(mat4_mul_vec4(world, vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+	const uint32_t level = xrlod_select(xr, center, internal->radius,
+	                                    internal->level_count, internal->level);
+	if (level != internal->level)
+	{
+		internal->level = level;
+		c_model_set_mesh(c_model(self), internal->levels[level]);
+	}
+	c_spatial_set_model(c_spatial(&internal->shadow), world);
+}
+
 int c_xrbody_pre_draw(c_xrbody_t *self)
 {
 	if (!self->internal->initiated)
 		return CONTINUE;
-	XrResult result;
 	struct openxr_internal *xr = c_openxr(&SYS)->internal;
+	/* actions are only valid while the session is focused */
+	if (!xr->actions_synced)
+		return CONTINUE;
 
-	XrActionStateFloat grabValue;
-	XrActionStateFloat leverValue;
-	XrSpaceLocation spaceLocation;
-	bool_t spaceLocationValid;
-
-	XrActionStatePose poseState = {
-		.type = XR_TYPE_ACTION_STATE_POSE,
-		.next = NULL
-	};
-	{
-		XrActionStateGetInfo getInfo = {
-			.type = XR_TYPE_ACTION_STATE_GET_INFO,
-			.next = NULL,
-			.action = self->internal->poseAction,
-			.subactionPath = self->internal->path
-		};
-		result = xrGetActionStatePose(xr->session, &getInfo, &poseState);
-		xr_result(xr->instance, result, "failed to get pose value!");
-	}
-
-	spaceLocation.type = XR_TYPE_SPACE_LOCATION;
-	spaceLocation.next = NULL;
+	const uint32_t slot = self->internal->input_slot;
+	const uint8_t active = xr->input.active[slot];
 
-	result = xrLocateSpace(self->internal->space, xr->local_space, xr->frame_state.predictedDisplayTime, &spaceLocation);
-	xr_result(xr->instance, result, "failed to locate space %s!", self->path);
-	spaceLocationValid =
-		//(spaceLocation.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-		(spaceLocation.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0;
+	self->linear_velocity = vec3(_vec3(xr->input.linear_velocity[slot]));
+	self->angular_velocity = vec3(_vec3(xr->input.angular_velocity[slot]));
 
+	/* placed with every other body in c_openxr_pre_draw */
 	if (c_openxr(&SYS)->renderer) {
-                vec3_t grip_rot = vec3(15.392f, 2.071f, 0.303f);
-		mat4_t model_matrix = mat4();
-
-		mat4_t start = c_openxr(&SYS)->renderer->glvars[0].model;
-
-		vec3_t translation = vec3(_vec3(spaceLocation.pose.position));
-		vec4_t rot_quat = vec4(_vec4(spaceLocation.pose.orientation));
-		mat4_t rot_matrix = quat_to_mat4(rot_quat);
-
-		model_matrix = mat4_mul(model_matrix, mat4_translate(translation));
-		model_matrix = mat4_mul(model_matrix, rot_matrix);
-
-		model_matrix = mat4_rotate_X(model_matrix,  -grip_rot.x * (M_PI / 180.0f));
-		model_matrix = mat4_rotate_Y(model_matrix,  -grip_rot.y * (M_PI / 180.0f));
-		model_matrix = mat4_rotate_Z(model_matrix,  -grip_rot.z * (M_PI / 180.0f));
-
-                vec3_t grip_origin = vec3(0.0f, -0.015f, 0.13f);
-		model_matrix = mat4_mul(model_matrix, mat4_translate(vec3_inv(grip_origin)));
-
-		c_spatial_set_model(c_spatial(self), mat4_mul(start, model_matrix));
+		const mat4_t world = xr->input.worlds[slot];
+		c_spatial_set_model(c_spatial(self), world);
+		if (self->internal->level_count > 1)
+			c_xrbody_update_lod(self, world);
 	}
 
-	grabValue.type = XR_TYPE_ACTION_STATE_FLOAT;
-	grabValue.next = NULL;
+	/* buzz for as long as the trigger is held */
+	const bool_t grabbing = (active & XR_INPUT_GRAB) && xr->input.grab[slot] > 0.75;
+	if (grabbing && !self->internal->grab_haptic)
+	{
+		const struct openxr_haptic_step hold = {1.0f, 0.5f, 0.0f};
+		self->internal->grab_haptic = xrhaptic_play(xr, self->internal->haptic_slot,
+		                                            &hold, 1, OPENXR_HAPTIC_FOREVER);
+	}
+	else if (!grabbing && self->internal->grab_haptic)
 	{
-		XrActionStateGetInfo getInfo = {
-			.type = XR_TYPE_ACTION_STATE_GET_INFO,
-			.next = NULL,
-			.action = self->internal->grabAction,
-			.subactionPath = self->internal->path
-		};
+		xrhaptic_cancel(xr, self->internal->haptic_slot, self->internal->grab_haptic);
+		self->internal->grab_haptic = 0;
+	}
+	return CONTINUE;
+}
 
-		result = xrGetActionStateFloat(xr->session, &getInfo, &grabValue);
-		xr_result(xr->instance, result, "failed to get grab value!");
+void c_xrbody_set_lod(c_xrbody_t *self, mesh_t **levels, uint32_t count,
+                      float radius, mat_t *mat)
+{
+	struct xrbody_internal *internal = self->internal;
+	if (count > XR_LOD_LEVELS)
+		count = XR_LOD_LEVELS;
+	for (uint32_t i = 0; i < count; i++)
+		internal->levels[i] = levels[i];
+	internal->level_count = count;
+	internal->level = 0;
+	internal->radius = radius;
+	if (count > 1 && !internal->shadow)
+	{
+		internal->shadow = entity_new({
+			c_model_new(levels[count - 1], mat, true, false);
+		});
 	}
+}
 
-	if (grabValue.isActive && grabValue.currentState > 0.75) {
-		XrHapticVibration vibration =  {
-			.type = XR_TYPE_HAPTIC_VIBRATION,
-			.next = NULL,
-			.amplitude = 0.5,
-			.duration = XR_MIN_HAPTIC_DURATION,
-			.frequency = XR_FREQUENCY_UNSPECIFIED
-		};
+uint32_t c_xrbody_late_latch_slot(c_xrbody_t *self)
+{
+	return self->internal->input_slot;
+}
 
-		XrHapticActionInfo hapticActionInfo = {
-			.type = XR_TYPE_HAPTIC_ACTION_INFO,
-			.next = NULL,
-			.action = self->internal->hapticAction,
-			.subactionPath = self->internal->path
-		};
-		result = xrApplyHapticFeedback(xr->session, &hapticActionInfo, (const XrHapticBaseHeader*)&vibration);
-		xr_result(xr->instance, result, "failed to apply haptic feedback!");
-	}
+void c_xrbody_predict(c_xrbody_t *self, int64_t time, vec3_t *position,
+                      vec4_t *orientation)
+{
+	struct openxr_internal *xr = c_openxr(&SYS)->internal;
+	XrPosef pose;
+	xrinput_predict(&xr->input, self->internal->input_slot, (XrTime)time, &pose);
+	*position = vec3(_vec3(pose.position));
+	*orientation = vec4(_vec4(pose.orientation));
+}
 
+uint32_t c_xrbody_haptic_pulse(c_xrbody_t *self, float amplitude,
+                               float frequency, float duration)
+{
+	const struct openxr_haptic_step step = {duration, amplitude, frequency};
+	return c_xrbody_haptic_pattern(self, &step, 1, 0);
+}
 
-	leverValue.type = XR_TYPE_ACTION_STATE_FLOAT;
-	leverValue.next = NULL;
-	{
-		XrActionStateGetInfo getInfo = {
-			.type = XR_TYPE_ACTION_STATE_GET_INFO,
-			.next = NULL,
-			.action = self->internal->leverAction,
-			.subactionPath = self->internal->path
-		};
+uint32_t c_xrbody_haptic_pattern(c_xrbody_t *self,
+                                 const struct openxr_haptic_step *steps,
+                                 uint32_t count, uint32_t repeat)
+{
+	if (!self->internal->initiated)
+		return 0;
+	return xrhaptic_play(c_openxr(&SYS)->internal, self->internal->haptic_slot,
+	                     steps, count, repeat);
+}
 
-		result = xrGetActionStateFloat(xr->session, &getInfo, &leverValue);
-		xr_result(xr->instance, result, "failed to get lever value!");
-	}
-	if (leverValue.isActive && leverValue.currentState != 0) {
-		/* printf("Lever value %s: changed %d: %f\n", self->path, */
-				/* leverValue.changedSinceLastSync, leverValue.currentState); */
-	}
-	return CONTINUE;
+void c_xrbody_haptic_cancel(c_xrbody_t *self, uint32_t id)
+{
+	if (!self->internal->initiated)
+		return;
+	xrhaptic_cancel(c_openxr(&SYS)->internal, self->internal->haptic_slot, id);
 }
 
 c_xrbody_t *c_xrbody_new(const char *path)
 {
 	c_xrbody_t *self = component_new(ct_xrbody);
 	strcpy(self->path, path);
-	xrbody_internal_init(self->internal, c_entity(self), self->path);
+	xrbody_internal_init(self->internal, self->path);
 	return self;
 }
 
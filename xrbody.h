@@ -4,15 +4,46 @@
 #include "../candle/ecs/ecm.h"
 #include "../candle/utils/renderer.h"
 
+struct openxr_haptic_step;
+
 typedef struct c_xrbody
 {
 	c_t super;
 	char path[64];
 	struct xrbody_internal *internal;
+	/* filled when c_openxr_track_velocity is enabled, in tracking space */
+	vec3_t linear_velocity;
+	vec3_t angular_velocity;
 } c_xrbody_t;
 
 DEF_CASTER(ct_xrbody, c_xrbody, c_xrbody_t)
 
 c_xrbody_t *c_xrbody_new(const char *path);
+/* Index of the body's correction in the late latch uniform block, see
+ * c_openxr_set_late_latch. */
+uint32_t c_xrbody_late_latch_slot(c_xrbody_t *self);
+/* Extrapolates the last tracked pose to time, in nanoseconds of the runtime
+ * clock, without querying the runtime again. */
+void c_xrbody_predict(c_xrbody_t *self, int64_t time, vec3_t *position,
+                      vec4_t *orientation);
+/* Switches the body's model between levels, finest first, from its
+ * projected size and the GPU budget. The coarsest level also casts the
+ * shadows of the body through a proxy drawn with mat, the model itself
+ * should be created without shadows. */
+void c_xrbody_set_lod(c_xrbody_t *self, mesh_t **levels, uint32_t count,
+                      float radius, mat_t *mat);
+
+/* Vibrates the body's controller for duration seconds, frequency 0 lets
+ * the runtime pick. Overlapping pulses and patterns of a body play the
+ * strongest one at each moment. Returns an id for c_xrbody_haptic_cancel,
+ * 0 if nothing was queued. */
+uint32_t c_xrbody_haptic_pulse(c_xrbody_t *self, float amplitude,
+                               float frequency, float duration);
+/* Plays count steps, of at most 16, repeat + 1 times or until cancelled
+ * with OPENXR_HAPTIC_FOREVER. Steps of no duration are skipped. */
+uint32_t c_xrbody_haptic_pattern(c_xrbody_t *self,
+                                 const struct openxr_haptic_step *steps,
+                                 uint32_t count, uint32_t repeat);
+void c_xrbody_haptic_cancel(c_xrbody_t *self, uint32_t id);
 
 #endif /* !XRBODY_H */
@@ -0,0 +1,141 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <string.h>
+
+/* Runtime capabilities the plugin cares about. Enumerating every extension
+ * and api layer is only needed the first time a runtime is seen, the flags
+ * are cached with the runtime's name and version and trusted on later
+ * launches until the instance reports a different runtime. */
+
+#define XRCAPS_VERSION 3
+
+static const struct
+{
+	const char *name;
+	uint32_t flag;
+} xrcaps_extensions[] = {
+	{XR_KHR_OPENGL_ENABLE_EXTENSION_NAME, XR_CAP_OPENGL},
+	{XR_KHR_VISIBILITY_MASK_EXTENSION_NAME, XR_CAP_VISIBILITY_MASK},
+#ifdef XR_KHR_locate_spaces
+	{XR_KHR_LOCATE_SPACES_EXTENSION_NAME, XR_CAP_LOCATE_SPACES},
+#endif
+#ifdef XR_MNDX_egl_enable
+	{XR_MNDX_EGL_ENABLE_EXTENSION_NAME, XR_CAP_EGL},
+#endif
+};
+
+#define XRCAPS_EXTENSION_COUNT \
+	(sizeof(xrcaps_extensions) / sizeof(*xrcaps_extensions))
+
+/* Enumerates the extensions and api layers of the active runtime. */
+bool_t xrcaps_probe(struct xr_caps *self)
+{
+	XrResult result;
+	uint32_t count = 0;
+
+	self->flags = 0;
+	self->runtime_name[0] = '\0';
+	self->runtime_version = 0;
+
+	result = xrEnumerateInstanceExtensionProperties(NULL, 0, &count, NULL);
+	if (!xr_result(NULL, result, "failed to enumerate number of extension properties"))
+		return false;
+
+	XrExtensionProperties *extensions = calloc(count ? count : 1, sizeof(*extensions));
+	for (uint32_t i = 0; i < count; i++)
+		extensions[i].type = XR_TYPE_EXTENSION_PROPERTIES;
+	result = xrEnumerateInstanceExtensionProperties(NULL, count, &count, extensions);
+	if (!xr_result(NULL, result, "failed to enumerate extension properties"))
+	{
+		free(extensions);
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		for (uint32_t e = 0; e < XRCAPS_EXTENSION_COUNT; e++)
+		{
+			if (!strcmp(extensions[i].extensionName, xrcaps_extensions[e].name))
+				self->flags |= xrcaps_extensions[e].flag;
+		}
+	}
+	free(extensions);
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME, "runtime supports %u extensions", count);
+
+	count = 0;
+	result = xrEnumerateApiLayerProperties(0, &count, NULL);
+	if (XR_SUCCEEDED(result) && count)
+	{
+		XrApiLayerProperties *layers = calloc(count, sizeof(*layers));
+		for (uint32_t i = 0; i < count; i++)
+			layers[i].type = XR_TYPE_API_LAYER_PROPERTIES;
+		result = xrEnumerateApiLayerProperties(count, &count, layers);
+		for (uint32_t i = 0; XR_SUCCEEDED(result) && i < count; i++)
+		{
+			if (!strcmp(layers[i].layerName, "XR_APILAYER_LUNARG_core_validation"))
+				self->flags |= XR_CAP_CORE_VALIDATION;
+		}
+		free(layers);
+	}
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_RUNTIME, "loader found %u api layers", count);
+	return true;
+}
+
+bool_t xrcaps_load(struct xr_caps *self)
+{
+	char line[XR_MAX_RUNTIME_NAME_SIZE + 16];
+	unsigned version = 0, flags = 0;
+	unsigned long long runtime_version = 0;
+	char path[512];
+	if (!xr_cache_file(XR_CAPS_CACHE, path, sizeof(path)))
+		return false;
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return false;
+
+	bool_t ok = fgets(line, sizeof(line), fp)
+	         && sscanf(line, "xrcaps %u", &version) == 1
+	         && version == XRCAPS_VERSION
+	         && fgets(line, sizeof(line), fp)
+	         && sscanf(line, "version %llx flags %x", &runtime_version, &flags) == 2
+	         && fgets(line, sizeof(line), fp)
+	         && !strncmp(line, "runtime ", 8);
+	fclose(fp);
+	if (!ok)
+		return false;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	snprintf(self->runtime_name, sizeof(self->runtime_name), "%s", line + 8);
+	self->runtime_version = (XrVersion)runtime_version;
+	self->flags = flags;
+	return (self->flags & XR_CAP_OPENGL) != 0;
+}
+
+void xrcaps_save(const struct xr_caps *self)
+{
+	char path[512];
+	if (!xr_cache_file(XR_CAPS_CACHE, path, sizeof(path)))
+		return;
+	FILE *fp = fopen(path, "w");
+	if (!fp)
+		return;
+	fprintf(fp, "xrcaps %u\n", XRCAPS_VERSION);
+	/* XrVersion packs major, minor and patch in 64 bits */
+	fprintf(fp, "version %llx flags %x\n",
+	        (unsigned long long)self->runtime_version, (unsigned)self->flags);
+	fprintf(fp, "runtime %s\n", self->runtime_name);
+	fclose(fp);
+}
+
+/* Fills the instance extensions to enable, returns their count. */
+uint32_t xrcaps_extensions_enabled(const struct xr_caps *self,
+                                   const char **names, uint32_t capacity)
+{
+	uint32_t count = 0;
+	for (uint32_t e = 0; e < XRCAPS_EXTENSION_COUNT && count < capacity; e++)
+	{
+		if (self->flags & xrcaps_extensions[e].flag)
+			names[count++] = xrcaps_extensions[e].name;
+	}
+	return count;
+}
@@ -0,0 +1,779 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <math.h>
+#include <string.h>
+
+/* Animated controllers built from the SteamVR component layout. Every part
+ * with a mesh is merged into one vertex buffer per hand, the vertex shader
+ * moves each vertex with the motion of its part evaluated from the frame's
+ * control values, so a hand costs a single draw. */
+
+static const char *xrctrl_vs =
+	"uniform mat4 view_projection;\n"
+	"layout(std140) uniform xr_controller_parts { vec4 parts[24 * 7]; };\n"
+	"uniform mat4 model;\n"
+	"#ifdef XR_LATE_LATCH\n"
+	"layout(std140) uniform xr_late_latch { mat4 correction[64]; };\n"
+	"uniform int latch_slot;\n"
+	"#define MODEL (latch_slot < 0 ? model : correction[latch_slot] * model)\n"
+	"#else\n"
+	"#define MODEL model\n"
+	"#endif\n"
+	"uniform float controls[11];\n"
+	"layout(location = 0) in vec3 pos;\n"
+	"layout(location = 1) in vec3 normal;\n"
+	"layout(location = 2) in vec2 uv;\n"
+	"layout(location = 3) in float part;\n"
+	"out vec3 f_normal;\n"
+	"out vec2 f_uv;\n"
+	"float control(float i) { return i < 0.0 ? 0.0 : controls[int(i)]; }\n"
+	"mat3 rotation(vec3 u, float degrees)\n"
+	"{\n"
+	"	float a = radians(degrees), s = sin(a), c = cos(a), t = 1.0 - c;\n"
+	"	return mat3(t * u.x * u.x + c, t * u.x * u.y + s * u.z, t * u.x * u.z - s * u.y,\n"
+	"	            t * u.x * u.y - s * u.z, t * u.y * u.y + c, t * u.y * u.z + s * u.x,\n"
+	"	            t * u.x * u.z + s * u.y, t * u.y * u.z - s * u.x, t * u.z * u.z + c);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"	int b = int(part) * 7;\n"
+	"	vec4 pivot = parts[b];\n"
+	"	if (pivot.w == -2.0 || (pivot.w >= 0.0 && control(pivot.w) < 0.5)) {\n"
+	"		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+	"		return;\n"
+	"	}\n"
+	"	vec4 rotations = parts[b + 5];\n"
+	"	vec4 translations = parts[b + 6];\n"
+	"	mat3 r = rotation(parts[b + 1].xyz, rotations.x + rotations.y * control(parts[b + 1].w))\n"
+	"	       * rotation(parts[b + 2].xyz, rotations.z + rotations.w * control(parts[b + 2].w));\n"
+	"	vec3 p = r * (pos - pivot.xyz) + pivot.xyz\n"
+	"	       + parts[b + 3].xyz * (translations.x + translations.y * control(parts[b + 3].w))\n"
+	"	       + parts[b + 4].xyz * (translations.z + translations.w * control(parts[b + 4].w));\n"
+	"	mat4 m = MODEL;\n"
+	"	f_normal = mat3(m) * (r * normal);\n"
+	"	f_uv = uv;\n"
+	"	gl_Position = view_projection * m * vec4(p, 1.0);\n"
+	"}\n";
+
+static const char *xrctrl_fs =
+	"uniform sampler2D albedo;\n"
+	"in vec3 f_normal;\n"
+	"in vec2 f_uv;\n"
+	"out vec4 color;\n"
+	"void main()\n"
+	"{\n"
+	"	float light = 0.35 + 0.65 * max(dot(normalize(f_normal),\n"
+	"	                                    normalize(vec3(0.3, 1.0, 0.5))), 0.0);\n"
+	"	color = vec4(texture(albedo, f_uv).rgb * light, 1.0);\n"
+	"}\n";
+
+/* Copies the depth of the scene candle drew into the swapchain framebuffer
+ * with a fullscreen triangle, so the controllers are hidden by walls
+ * instead of drawing over them. */
+static const char *xrctrl_depth_vs =
+	"void main()\n"
+	"{\n"
+	"	vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *xrctrl_depth_fs =
+	"uniform sampler2D scene_depth;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragDepth = texelFetch(scene_depth, ivec2(gl_FragCoord.xy), 0).r;\n"
+	"}\n";
+
+/* one action per animated input, with both hands as subaction paths */
+static const struct
+{
+	const char *name;
+	XrActionType type;
+	const char *input;
+	uint32_t control;
+} xrctrl_inputs[XR_CONTROLLER_ACTIONS] = {
+	{"controller_trigger", XR_ACTION_TYPE_FLOAT_INPUT, "/input/trigger/value", XR_CONTROL_TRIGGER},
+	{"controller_squeeze", XR_ACTION_TYPE_FLOAT_INPUT, "/input/squeeze/value", XR_CONTROL_SQUEEZE},
+	{"controller_thumbstick", XR_ACTION_TYPE_VECTOR2F_INPUT, "/input/thumbstick", XR_CONTROL_STICK_X},
+	{"controller_thumbstick_click", XR_ACTION_TYPE_BOOLEAN_INPUT, "/input/thumbstick/click", XR_CONTROL_STICK_CLICK},
+	{"controller_trackpad", XR_ACTION_TYPE_VECTOR2F_INPUT, "/input/trackpad", XR_CONTROL_PAD_X},
+	{"controller_trackpad_touch", XR_ACTION_TYPE_BOOLEAN_INPUT, "/input/trackpad/touch", XR_CONTROL_PAD_TOUCH},
+	{"controller_a", XR_ACTION_TYPE_BOOLEAN_INPUT, "/input/a/click", XR_CONTROL_A},
+	{"controller_b", XR_ACTION_TYPE_BOOLEAN_INPUT, "/input/b/click", XR_CONTROL_B},
+	{"controller_system", XR_ACTION_TYPE_BOOLEAN_INPUT, "/input/system/click", XR_CONTROL_SYSTEM}
+};
+
+static const char *xrctrl_hand_paths[2] = {"/user/hand/right", "/user/hand/left"};
+static const char *xrctrl_sides[2] = {"right", "left"};
+
+/* ------------------------------------------------------------------------ */
+/* minimal JSON reader for the component layout */
+
+enum
+{
+	XRJSON_NULL,
+	XRJSON_BOOL,
+	XRJSON_NUMBER,
+	XRJSON_STRING,
+	XRJSON_ARRAY,
+	XRJSON_OBJECT
+};
+
+struct xrjson
+{
+	int type;
+	const char *key;
+	uint32_t key_len;
+	const char *string;
+	uint32_t string_len;
+	double number;
+	struct xrjson *child;
+	struct xrjson *next;
+};
+
+static const char *xrjson_skip(const char *c)
+{
+	while (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') c++;
+	return c;
+}
+
+static const char *xrjson_string(const char *c, const char **out, uint32_t *len)
+{
+	const char *start = ++c;
+	while (*c && *c != '"')
+	{
+		if (*c == '\\' && c[1]) c++;
+		c++;
+	}
+	if (*c != '"')
+		return NULL;
+	*out = start;
+	*len = (uint32_t)(c - start);
+	return c + 1;
+}
+
+static const char *xrjson_parse(const char *c, struct xrjson *self)
+{
+	c = xrjson_skip(c);
+	if (*c == '{' || *c == '[')
+	{
+		const char close = *c == '{' ? '}' : ']';
+		struct xrjson **tail = &self->child;
+		self->type = *c == '{' ? XRJSON_OBJECT : XRJSON_ARRAY;
+		c = xrjson_skip(c + 1);
+		while (*c && *c != close)
+		{
+			struct xrjson *child = calloc(1, sizeof(*child));
+			*tail = child;
+			tail = &child->next;
+			if (self->type == XRJSON_OBJECT)
+			{
+				if (*c != '"' || !(c = xrjson_string(c, &child->key, &child->key_len)))
+					return NULL;
+				c = xrjson_skip(c);
+				if (*c++ != ':')
+					return NULL;
+			}
+			if (!(c = xrjson_parse(c, child)))
+				return NULL;
+			c = xrjson_skip(c);
+			if (*c == ',')
+				c = xrjson_skip(c + 1);
+		}
+		return *c ? c + 1 : NULL;
+	}
+	if (*c == '"')
+	{
+		self->type = XRJSON_STRING;
+		return xrjson_string(c, &self->string, &self->string_len);
+	}
+	if (!strncmp(c, "true", 4) || !strncmp(c, "null", 4))
+	{
+		self->type = *c == 't' ? XRJSON_BOOL : XRJSON_NULL;
+		self->number = *c == 't';
+		return c + 4;
+	}
+	if (!strncmp(c, "false", 5))
+	{
+		self->type = XRJSON_BOOL;
+		return c + 5;
+	}
+	char *end;
+	self->number = strtod(c, &end);
+	if (end == c)
+		return NULL;
+	self->type = XRJSON_NUMBER;
+	return end;
+}
+
+static void xrjson_free(struct xrjson *self)
+{
+	while (self)
+	{
+		struct xrjson *next = self->next;
+		xrjson_free(self->child);
+		free(self);
+		self = next;
+	}
+}
+
+static const struct xrjson *xrjson_get(const struct xrjson *self, const char *key)
+{
+	const uint32_t len = (uint32_t)strlen(key);
+	if (!self || self->type != XRJSON_OBJECT)
+		return NULL;
+	for (const struct xrjson *child = self->child; child; child = child->next)
+	{
+		if (child->key_len == len && !strncmp(child->key, key, len))
+			return child;
+	}
+	return NULL;
+}
+
+static bool_t xrjson_is(const struct xrjson *self, const char *string)
+{
+	return self && self->type == XRJSON_STRING
+	    && self->string_len == strlen(string)
+	    && !strncmp(self->string, string, self->string_len);
+}
+
+static bool_t xrjson_floats(const struct xrjson *self, float *out, uint32_t n)
+{
+	const struct xrjson *child;
+	uint32_t i = 0;
+	if (!self || self->type != XRJSON_ARRAY)
+		return false;
+	for (child = self->child; child && i < n; child = child->next)
+		out[i++] = (float)child->number;
+	return i == n;
+}
+
+/* ------------------------------------------------------------------------ */
+/* part motion */
+
+/* The record of each part, in vec4s: pivot and visibility control, two
+ * rotation axes and two translation directions each with their control in
+ * w, then the base and slope of the rotations in degrees and of the
+ * translations in meters. A control of -1 is always 0, a visibility of -1
+ * is always shown and of -2 never. */
+enum
+{
+	XR_PART_PIVOT = 0,
+	XR_PART_ROTATION0 = 4,
+	XR_PART_ROTATION1 = 8,
+	XR_PART_TRANSLATION0 = 12,
+	XR_PART_TRANSLATION1 = 16,
+	XR_PART_ROTATION_MAP = 20,
+	XR_PART_TRANSLATION_MAP = 24
+};
+
+static void xrctrl_slot(float *part, int slot, int map, vec3_t dir,
+                        int control, const float *range, bool_t centered)
+{
+	part[slot + 0] = dir.x;
+	part[slot + 1] = dir.y;
+	part[slot + 2] = dir.z;
+	part[slot + 3] = (float)control;
+	/* sticks and pads span [-1, 1], triggers and buttons [0, 1] */
+	part[map + 0] = centered ? (range[0] + range[1]) * 0.5f : range[0];
+	part[map + 1] = centered ? (range[1] - range[0]) * 0.5f : range[1] - range[0];
+}
+
+static int xrctrl_source(const struct xrjson *motion)
+{
+	const struct xrjson *pressed = xrjson_get(motion, "pressed_path");
+	if (xrjson_get(motion, "trigger_path")) return XR_CONTROL_TRIGGER;
+	if (xrjson_is(pressed, "/input/a/click")) return XR_CONTROL_A;
+	if (xrjson_is(pressed, "/input/b/click")) return XR_CONTROL_B;
+	if (xrjson_is(pressed, "/input/system/click")) return XR_CONTROL_SYSTEM;
+	if (xrjson_is(xrjson_get(motion, "x_path"), "/input/trackpad/y")) return XR_CONTROL_PAD_Y;
+	if (xrjson_is(xrjson_get(motion, "component_path"), "/input/grip")) return XR_CONTROL_SQUEEZE;
+	return -1;
+}
+
+static mat4_t xrctrl_frame(const struct xrjson *motion)
+{
+	float rotate[3] = {0.0f, 0.0f, 0.0f};
+	mat4_t frame = mat4();
+	xrjson_floats(xrjson_get(motion, "rotate_xyz"), rotate, 3);
+	frame = mat4_rotate_X(frame, rotate[0] * (M_PI / 180.0f));
+	frame = mat4_rotate_Y(frame, rotate[1] * (M_PI / 180.0f));
+	frame = mat4_rotate_Z(frame, rotate[2] * (M_PI / 180.0f));
+	return frame;
+}
+
+static vec3_t xrctrl_axis(mat4_t frame, float x, float y, float z)
+{
+	return vec4_xyz(mat4_mul_vec4(frame, vec4(x, y, z, 0.0f)));
+}
+
+static void xrctrl_motion(const struct xrjson *component, float *part)
+{
+	const struct xrjson *motion = xrjson_get(component, "motion");
+	const struct xrjson *visibility = xrjson_get(component, "visibility");
+	const struct xrjson *type = xrjson_get(motion, "type");
+	const int source = xrctrl_source(motion);
+	float pivot[3] = {0.0f, 0.0f, 0.0f};
+	float axis[3] = {0.0f, 0.0f, 0.0f};
+	float range[2] = {0.0f, 0.0f};
+	float range_y[2];
+
+	memset(part, 0, sizeof(float) * 4 * XR_CONTROLLER_PART_VEC4S);
+	part[XR_PART_ROTATION0 + 3] = part[XR_PART_ROTATION1 + 3] = -1.0f;
+	part[XR_PART_TRANSLATION0 + 3] = part[XR_PART_TRANSLATION1 + 3] = -1.0f;
+
+	part[XR_PART_PIVOT + 3] = -1.0f;
+	if (visibility)
+	{
+		const struct xrjson *shown = xrjson_get(visibility, "default");
+		const struct xrjson *touch = xrjson_get(visibility, "touch");
+		if (!shown || !shown->number)
+			part[XR_PART_PIVOT + 3] = touch && touch->number ? XR_CONTROL_PAD_TOUCH
+			                                                 : -2.0f;
+	}
+
+	xrjson_floats(xrjson_get(motion, "axis"), axis, 3);
+	xrjson_floats(xrjson_get(motion, "value_mapping"), range, 2);
+	const vec3_t dir = vec3_norm(vec3(axis[0], axis[1], axis[2]));
+
+	if (xrjson_is(type, "rotate") && source >= 0)
+	{
+		xrjson_floats(xrjson_get(motion, "pivot"), pivot, 3);
+		xrctrl_slot(part, XR_PART_ROTATION0, XR_PART_ROTATION_MAP, dir, source,
+		            range, source == XR_CONTROL_PAD_Y);
+	}
+	else if (xrjson_is(type, "translate") && source >= 0)
+	{
+		/* the squeeze entry carries the trigger's degrees, ranges that can't
+		 * be meters are left static */
+		if (fabsf(range[0]) < 0.05f && fabsf(range[1]) < 0.05f)
+			xrctrl_slot(part, XR_PART_TRANSLATION0, XR_PART_TRANSLATION_MAP,
+			            dir, source, range, false);
+	}
+	else if (xrjson_is(type, "trackpad")
+	         && xrjson_floats(xrjson_get(motion, "touch_translate_x"), range, 2)
+	         && xrjson_floats(xrjson_get(motion, "touch_translate_y"), range_y, 2))
+	{
+		const mat4_t frame = xrctrl_frame(motion);
+		xrctrl_slot(part, XR_PART_TRANSLATION0, XR_PART_TRANSLATION_MAP,
+		            xrctrl_axis(frame, 1.0f, 0.0f, 0.0f), XR_CONTROL_PAD_X,
+		            range, true);
+		xrctrl_slot(part, XR_PART_TRANSLATION1, XR_PART_TRANSLATION_MAP + 2,
+		            xrctrl_axis(frame, 0.0f, 0.0f, 1.0f), XR_CONTROL_PAD_Y,
+		            range_y, true);
+	}
+	else if (xrjson_is(type, "joystick"))
+	{
+		const mat4_t frame = xrctrl_frame(motion);
+		float press[3] = {0.0f, 0.0f, 0.0f};
+		const float click[2] = {0.0f, 1.0f};
+		xrjson_floats(xrjson_get(motion, "center"), pivot, 3);
+		if (xrjson_floats(xrjson_get(motion, "joystick_rotation_x"), range, 2))
+			xrctrl_slot(part, XR_PART_ROTATION0, XR_PART_ROTATION_MAP,
+			            xrctrl_axis(frame, 1.0f, 0.0f, 0.0f), XR_CONTROL_STICK_Y,
+			            range, true);
+		if (xrjson_floats(xrjson_get(motion, "joystick_rotation_y"), range_y, 2))
+			xrctrl_slot(part, XR_PART_ROTATION1, XR_PART_ROTATION_MAP + 2,
+			            xrctrl_axis(frame, 0.0f, 0.0f, 1.0f), XR_CONTROL_STICK_X,
+			            range_y, true);
+		if (xrjson_floats(xrjson_get(motion, "press_translate"), press, 3))
+			xrctrl_slot(part, XR_PART_TRANSLATION0, XR_PART_TRANSLATION_MAP,
+			            vec3(press[0], press[1], press[2]),
+			            XR_CONTROL_STICK_CLICK, click, false);
+	}
+
+	part[XR_PART_PIVOT + 0] = pivot[0];
+	part[XR_PART_PIVOT + 1] = pivot[1];
+	part[XR_PART_PIVOT + 2] = pivot[2];
+}
+
+/* ------------------------------------------------------------------------ */
+/* loading */
+
+static char *xrctrl_read(const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	char *text;
+	long size;
+	if (!fp)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	text = malloc(size + 1);
+	size = (long)fread(text, 1, size, fp);
+	text[size] = '\0';
+	fclose(fp);
+	return text;
+}
+
+/* The layout names parts without their side, the files mostly carry it. */
+static bool_t xrctrl_open_part(const char *dir, const char *side,
+                               const struct xrjson *filename,
+                               struct xrmesh_data *data)
+{
+	char path[512];
+	const int len = (int)filename->string_len;
+	const int stem = len > 4 ? len - 4 : len;
+	snprintf(path, sizeof(path), "%s%.*s_%s.obj", dir, stem, filename->string, side);
+	if (xrmesh_open(path, data))
+		return true;
+	snprintf(path, sizeof(path), "%s%.*s", dir, len, filename->string);
+	return xrmesh_open(path, data);
+}
+
+static void xrctrl_load_hand(struct xr_controller_hand *self, const char *side)
+{
+	char dir[256];
+	char path[512];
+	float parts[XR_CONTROLLER_MAX_PARTS * XR_CONTROLLER_PART_VEC4S * 4];
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	struct xrjson root = {0};
+
+	/* the parts sit next to the layout */
+	snprintf(path, sizeof(path), "valve_controller_knu_1_0_%s.json", side);
+	if (!xr_resource_path(path, dir, sizeof(dir)))
+		return;
+	snprintf(path, sizeof(path), "%s", dir);
+	char *slash = strrchr(dir, '/');
+	if (!slash)
+		slash = strrchr(dir, '\\');
+	if (slash)
+		slash[1] = '\0';
+	else
+		dir[0] = '\0';
+	char *text = xrctrl_read(path);
+	if (!text)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "controller layout %s not found", path);
+		return;
+	}
+	if (!xrjson_parse(text, &root))
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "controller layout %s is not valid", path);
+		goto end;
+	}
+
+	const struct xrjson *components = xrjson_get(&root, "components");
+	self->part_count = 0;
+	self->index_count = 0;
+	for (const struct xrjson *c = components ? components->child : NULL; c; c = c->next)
+	{
+		const struct xrjson *filename = xrjson_get(c, "filename");
+		struct xrmesh_data data;
+		if (!filename || filename->type != XRJSON_STRING)
+			continue;
+		if (self->part_count == XR_CONTROLLER_MAX_PARTS)
+		{
+			xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+			       "controller %s has too many parts", side);
+			break;
+		}
+		if (!xrctrl_open_part(dir, side, filename, &data))
+		{
+			xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+			       "controller part %.*s not found", (int)filename->string_len,
+			       filename->string);
+			continue;
+		}
+
+		const uint32_t part = self->part_count++;
+		xrctrl_motion(c, &parts[part * XR_CONTROLLER_PART_VEC4S * 4]);
+
+		/* the part index is appended to each vertex */
+		vertices = realloc(vertices, sizeof(*vertices) * (XRMESH_VERTEX_FLOATS + 1)
+		                   * (vertex_count + data.vertex_count));
+		for (uint32_t v = 0; v < data.vertex_count; v++)
+		{
+			float *dst = &vertices[(vertex_count + v) * (XRMESH_VERTEX_FLOATS + 1)];
+			memcpy(dst, &data.vertices[v * XRMESH_VERTEX_FLOATS],
+			       sizeof(float) * XRMESH_VERTEX_FLOATS);
+			dst[XRMESH_VERTEX_FLOATS] = (float)part;
+		}
+		indices = realloc(indices, sizeof(*indices)
+		                  * (self->index_count + data.index_count));
+		for (uint32_t i = 0; i < data.index_count; i++)
+			indices[self->index_count + i] = vertex_count + data.indices[i];
+		vertex_count += data.vertex_count;
+		self->index_count += data.index_count;
+		xrmesh_close(&data);
+	}
+	if (!self->index_count)
+		goto end;
+
+	const GLsizei stride = sizeof(float) * (XRMESH_VERTEX_FLOATS + 1);
+	glGenVertexArrays(1, &self->vao);
+	glGenBuffers(1, &self->vbo);
+	glGenBuffers(1, &self->ibo);
+	glBindVertexArray(self->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+	glBufferData(GL_ARRAY_BUFFER, stride * vertex_count, vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 3));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 6));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 8));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(*indices) * self->index_count,
+	             indices, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &self->parts_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, self->parts_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(parts), NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(float) * 4 * XR_CONTROLLER_PART_VEC4S
+	                * self->part_count, parts);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	uint32_t width, height;
+	snprintf(path, sizeof(path), "%svalve_controller_knu_1_0_%s_diff.png",
+	         dir, side);
+	self->texture = xrtex_load(path, true, &width, &height);
+	self->loaded = true;
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN, "controller %s: %u parts in one draw",
+	       side, self->part_count);
+
+end:
+	xrjson_free(root.child);
+	free(text);
+	free(vertices);
+	free(indices);
+}
+
+/* Creates the actions animating the parts and suggests their bindings,
+ * must run before the interaction profile bindings are suggested. */
+void xrctrl_actions(struct openxr_internal *xr)
+{
+	struct xr_controllers *self = &xr->controllers;
+	XrPath paths[2];
+	XrResult result;
+
+	for (uint32_t h = 0; h < 2; h++)
+	{
+		paths[h] = xr_path(xr, xrctrl_hand_paths[h]);
+		if (paths[h] == XR_NULL_PATH)
+			return;
+		self->hands[h].path = paths[h];
+	}
+
+	for (uint32_t i = 0; i < XR_CONTROLLER_ACTIONS; i++)
+	{
+		XrActionCreateInfo actionInfo = {
+			.type = XR_TYPE_ACTION_CREATE_INFO,
+			.next = NULL,
+			.actionType = xrctrl_inputs[i].type,
+			.countSubactionPaths = 2,
+			.subactionPaths = paths
+		};
+		strcpy(actionInfo.actionName, xrctrl_inputs[i].name);
+		strcpy(actionInfo.localizedActionName, xrctrl_inputs[i].name);
+		result = xrCreateAction(xr->main_set, &actionInfo, &self->actions[i]);
+		if (!xr_result(xr->instance, result, "failed to create %s action",
+		               xrctrl_inputs[i].name))
+			continue;
+
+		/* the part layout is the Index controller's */
+		for (uint32_t h = 0; h < 2; h++)
+		{
+			xraction_bind(xr, XR_PROFILE_INDEX, self->actions[i],
+			              xr_path_join(xr, xrctrl_hand_paths[h],
+			                           xrctrl_inputs[i].input));
+		}
+	}
+}
+
+void xrctrl_init(struct openxr_internal *xr, uint32_t right_slot,
+                 uint32_t left_slot)
+{
+	struct xr_controllers *self = &xr->controllers;
+
+	/* late latched hands move with the corrections uploaded before the
+	 * views are drawn */
+	self->program = xr_program(xr->late_latch ? "#define XR_LATE_LATCH\n" : "",
+	                           xrctrl_vs, xrctrl_fs);
+	if (!self->program)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "failed to link controller program");
+		return;
+	}
+	self->view_projection_loc = glGetUniformLocation(self->program,
+	                                                 "view_projection");
+	self->model_loc = glGetUniformLocation(self->program, "model");
+	self->controls_loc = glGetUniformLocation(self->program, "controls");
+	self->latch_slot_loc = glGetUniformLocation(self->program, "latch_slot");
+	glUniformBlockBinding(self->program,
+	                      glGetUniformBlockIndex(self->program, "xr_controller_parts"),
+	                      XR_CONTROLLER_PARTS_BINDING);
+	if (xr->late_latch)
+		glUniformBlockBinding(self->program,
+		                      glGetUniformBlockIndex(self->program, "xr_late_latch"),
+		                      OPENXR_LATE_LATCH_BINDING);
+	glUseProgram(self->program);
+	glUniform1i(glGetUniformLocation(self->program, "albedo"), 0);
+	glUseProgram(0);
+
+	self->depth_program = xr_program("", xrctrl_depth_vs, xrctrl_depth_fs);
+	if (self->depth_program)
+	{
+		glUseProgram(self->depth_program);
+		glUniform1i(glGetUniformLocation(self->depth_program, "scene_depth"), 0);
+		glUseProgram(0);
+		glGenVertexArrays(1, &self->depth_vao);
+	}
+	else
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "failed to link controller depth program");
+	}
+
+	self->hands[0].input_slot = right_slot;
+	self->hands[1].input_slot = left_slot;
+	for (uint32_t h = 0; h < 2; h++)
+		xrctrl_load_hand(&self->hands[h], xrctrl_sides[h]);
+}
+
+void xrctrl_destroy(struct openxr_internal *xr)
+{
+	struct xr_controllers *self = &xr->controllers;
+	for (uint32_t h = 0; h < 2; h++)
+	{
+		struct xr_controller_hand *hand = &self->hands[h];
+		glDeleteVertexArrays(1, &hand->vao);
+		glDeleteBuffers(1, &hand->vbo);
+		glDeleteBuffers(1, &hand->ibo);
+		glDeleteBuffers(1, &hand->parts_ubo);
+		/* the fallback texture is shared by every missing texture */
+		if (hand->texture && hand->texture != xrtex_fallback())
+			glDeleteTextures(1, &hand->texture);
+		*hand = (struct xr_controller_hand){0};
+	}
+	glDeleteProgram(self->program);
+	glDeleteProgram(self->depth_program);
+	glDeleteVertexArrays(1, &self->depth_vao);
+	self->program = 0;
+	self->depth_program = 0;
+	self->depth_vao = 0;
+}
+
+/* Reads the control values of both hands, right after xrSyncActions. */
+void xrctrl_sample(struct openxr_internal *xr)
+{
+	struct xr_controllers *self = &xr->controllers;
+	XrResult result;
+	if (!self->animated || !xr->actions_synced)
+		return;
+
+	for (uint32_t h = 0; h < 2; h++)
+	{
+		struct xr_controller_hand *hand = &self->hands[h];
+		if (!hand->loaded)
+			continue;
+		memset(hand->controls, 0, sizeof(hand->controls));
+		for (uint32_t i = 0; i < XR_CONTROLLER_ACTIONS; i++)
+		{
+			float *value = &hand->controls[xrctrl_inputs[i].control];
+			XrActionStateGetInfo getInfo = {
+				.type = XR_TYPE_ACTION_STATE_GET_INFO,
+				.next = NULL,
+				.action = self->actions[i],
+				.subactionPath = hand->path
+			};
+			if (xrctrl_inputs[i].type == XR_ACTION_TYPE_FLOAT_INPUT)
+			{
+				XrActionStateFloat state = {.type = XR_TYPE_ACTION_STATE_FLOAT};
+				result = xrGetActionStateFloat(xr->session, &getInfo, &state);
+				if (XR_SUCCEEDED(result) && state.isActive)
+					value[0] = state.currentState;
+			}
+			else if (xrctrl_inputs[i].type == XR_ACTION_TYPE_VECTOR2F_INPUT)
+			{
+				XrActionStateVector2f state = {.type = XR_TYPE_ACTION_STATE_VECTOR2F};
+				result = xrGetActionStateVector2f(xr->session, &getInfo, &state);
+				if (XR_SUCCEEDED(result) && state.isActive)
+				{
+					value[0] = state.currentState.x;
+					value[1] = state.currentState.y;
+				}
+			}
+			else
+			{
+				XrActionStateBoolean state = {.type = XR_TYPE_ACTION_STATE_BOOLEAN};
+				result = xrGetActionStateBoolean(xr->session, &getInfo, &state);
+				if (XR_SUCCEEDED(result) && state.isActive)
+					value[0] = state.currentState ? 1.0f : 0.0f;
+			}
+		}
+	}
+}
+
+/* Draws both controllers over the view already in framebuffer. The
+ * controllers are depth tested against scene_depth, candle's depth texture
+ * of the same view; without one they only occlude themselves. */
+void xrctrl_draw(struct openxr_internal *xr, GLuint framebuffer, uint32_t view,
+                 const mat4_t *view_projection, GLuint scene_depth)
+{
+	struct xr_controllers *self = &xr->controllers;
+	if (!self->enabled || !self->program)
+		return;
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, xr->views[view].width, xr->views[view].height);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glDisable(GL_CULL_FACE);
+	if (scene_depth && self->depth_program)
+	{
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthFunc(GL_ALWAYS);
+		glUseProgram(self->depth_program);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, scene_depth);
+		glBindVertexArray(self->depth_vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+	else
+	{
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	glUseProgram(self->program);
+	glUniformMatrix4fv(self->view_projection_loc, 1, GL_FALSE,
+	                   (const GLfloat*)view_projection);
+	glActiveTexture(GL_TEXTURE0);
+	for (uint32_t h = 0; h < 2; h++)
+	{
+		const struct xr_controller_hand *hand = &self->hands[h];
+		if (!hand->loaded || !(xr->input.active[hand->input_slot] & XR_INPUT_POSE))
+			continue;
+		const mat4_t model = mat4_mul(xr->input.origin,
+		                              xr->input.models[hand->input_slot]);
+		glUniformMatrix4fv(self->model_loc, 1, GL_FALSE, (const GLfloat*)&model);
+		if (self->latch_slot_loc >= 0)
+			glUniform1i(self->latch_slot_loc,
+			            hand->input_slot < OPENXR_LATE_LATCH_MAX ? (GLint)hand->input_slot : -1);
+		glUniform1fv(self->controls_loc, XR_CONTROL_COUNT, hand->controls);
+		glBindBufferBase(GL_UNIFORM_BUFFER, XR_CONTROLLER_PARTS_BINDING,
+		                 hand->parts_ubo);
+		glBindTexture(GL_TEXTURE_2D, hand->texture);
+		glBindVertexArray(hand->vao);
+		glDrawElements(GL_TRIANGLES, hand->index_count, GL_UNSIGNED_INT, NULL);
+	}
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,236 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <string.h>
+
+/* Window system glue: the graphics binding the session shares the current
+ * GL context through. */
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_CONTEXT_MAJOR_VERSION
+#define EGL_CONTEXT_MAJOR_VERSION 0x3098
+#define EGL_CONTEXT_MINOR_VERSION 0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK 0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT 0x00000001
+#endif
+
+typedef EGLDisplay (*xr_pfn_egl_get_platform_display)(EGLenum platform,
+		void *native_display, const EGLint *attributes);
+
+#ifdef _WIN32
+
+bool_t xrgl_binding(struct openxr_internal *self)
+{
+	if (self->graphics != OPENXR_GRAPHICS_AUTO
+	    && self->graphics != OPENXR_GRAPHICS_WIN32)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "only the Win32 graphics binding is available on Windows");
+		return false;
+	}
+	self->graphics_binding.win32.type = XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR;
+	self->graphics_binding.win32.next = NULL;
+	self->graphics_binding.win32.hGLRC = wglGetCurrentContext();
+	self->graphics_binding.win32.hDC = wglGetCurrentDC();
+	if (!self->graphics_binding.win32.hGLRC)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "no GL context is current");
+		return false;
+	}
+	return true;
+}
+
+bool_t openxr_surfaceless_context(void)
+{
+	const bool_t log_started = xrlog_start();
+	xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+	       "surfaceless contexts are not available on Windows");
+	if (log_started)
+		xrlog_stop();
+	return false;
+}
+
+#else
+
+static bool_t xrgl_binding_xlib(struct openxr_internal *self)
+{
+	XrGraphicsBindingOpenGLXlibKHR *binding = &self->graphics_binding.xlib;
+	Display *display = glXGetCurrentDisplay();
+	GLXContext context = glXGetCurrentContext();
+	int config_id = 0, screen = 0, count = 0;
+
+	if (!display || !context)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "no GLX context is current");
+		return false;
+	}
+	/* the runtime wants the framebuffer config the context was made with */
+	glXQueryContext(display, context, GLX_FBCONFIG_ID, &config_id);
+	glXQueryContext(display, context, GLX_SCREEN, &screen);
+	const int attributes[] = {GLX_FBCONFIG_ID, config_id, None};
+	GLXFBConfig *configs = glXChooseFBConfig(display, screen, attributes, &count);
+	if (!configs || !count)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "failed to find the GLX framebuffer config of the context");
+		return false;
+	}
+
+	binding->type = XR_TYPE_GRAPHICS_BINDING_OPENGL_XLIB_KHR;
+	binding->next = NULL;
+	binding->xDisplay = display;
+	binding->glxFBConfig = configs[0];
+	binding->glxDrawable = glXGetCurrentDrawable();
+	binding->glxContext = context;
+	binding->visualid = 0;
+	XVisualInfo *visual = glXGetVisualFromFBConfig(display, configs[0]);
+	if (visual)
+	{
+		binding->visualid = (uint32_t)visual->visualid;
+		XFree(visual);
+	}
+	XFree(configs);
+	return true;
+}
+
+static bool_t xrgl_binding_egl(struct openxr_internal *self)
+{
+#ifdef XR_MNDX_egl_enable
+	XrGraphicsBindingEGLMNDX *binding = &self->graphics_binding.egl;
+	EGLDisplay display = eglGetCurrentDisplay();
+	EGLContext context = eglGetCurrentContext();
+	EGLConfig config = NULL;
+	EGLint config_id = 0, count = 0;
+
+	if (context == EGL_NO_CONTEXT)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "no EGL context is current");
+		return false;
+	}
+	if (!(self->caps.flags & XR_CAP_EGL))
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_RUNTIME,
+		       "the runtime does not support " XR_MNDX_EGL_ENABLE_EXTENSION_NAME);
+		return false;
+	}
+	/* contexts made without a config (EGL_KHR_no_config_context) report 0 */
+	eglQueryContext(display, context, EGL_CONFIG_ID, &config_id);
+	if (config_id)
+	{
+		const EGLint attributes[] = {EGL_CONFIG_ID, config_id, EGL_NONE};
+		if (!eglChooseConfig(display, attributes, &config, 1, &count) || !count)
+		{
+			xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+			       "failed to find the EGL config of the context");
+			return false;
+		}
+	}
+
+	binding->type = XR_TYPE_GRAPHICS_BINDING_EGL_MNDX;
+	binding->next = NULL;
+	binding->getProcAddress = (PFN_xrEglGetProcAddressMNDX)eglGetProcAddress;
+	binding->display = display;
+	binding->config = config;
+	binding->context = context;
+	return true;
+#else
+	(void)self;
+	xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "the OpenXR headers lack XR_MNDX_egl_enable");
+	return false;
+#endif
+}
+
+/* Fills the binding of the session, from the context current on the calling
+ * thread. */
+bool_t xrgl_binding(struct openxr_internal *self)
+{
+	switch (self->graphics)
+	{
+	case OPENXR_GRAPHICS_XLIB:
+		return xrgl_binding_xlib(self);
+	case OPENXR_GRAPHICS_EGL:
+		return xrgl_binding_egl(self);
+	case OPENXR_GRAPHICS_AUTO:
+		if (eglGetCurrentContext() != EGL_NO_CONTEXT)
+			return xrgl_binding_egl(self);
+		return xrgl_binding_xlib(self);
+	default:
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "graphics binding %u is not available on this platform",
+		       self->graphics);
+		return false;
+	}
+}
+
+/* The context is usually made before any c_openxr, so the log thread is
+ * started here and stopped again on failure, to write the reason before
+ * the caller exits. */
+static bool_t xrgl_surfaceless_failed(EGLDisplay display, bool_t log_started)
+{
+	if (display != EGL_NO_DISPLAY)
+		eglTerminate(display);
+	if (log_started)
+		xrlog_stop();
+	return false;
+}
+
+bool_t openxr_surfaceless_context(void)
+{
+	const bool_t log_started = xrlog_start();
+	const char *client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	xr_pfn_egl_get_platform_display get_platform_display =
+		(xr_pfn_egl_get_platform_display)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLConfig config;
+	EGLint count = 0;
+
+	if (client && strstr(client, "EGL_MESA_platform_surfaceless") && get_platform_display)
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+		                               EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "failed to initialize the surfaceless EGL platform");
+		return xrgl_surfaceless_failed(EGL_NO_DISPLAY, log_started);
+	}
+	const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context"))
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "EGL_KHR_surfaceless_context is not supported");
+		return xrgl_surfaceless_failed(display, log_started);
+	}
+
+	const EGLint config_attributes[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	if (!eglBindAPI(EGL_OPENGL_API)
+	    || !eglChooseConfig(display, config_attributes, &config, 1, &count) || !count)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "no EGL config supports desktop GL");
+		return xrgl_surfaceless_failed(display, log_started);
+	}
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+	                                      context_attributes);
+	if (context == EGL_NO_CONTEXT
+	    || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "failed to create a surfaceless GL context, 0x%x", eglGetError());
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		return xrgl_surfaceless_failed(display, log_started);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <string.h>
+
+/* Haptics scheduler. Gameplay queues patterns of constant steps per body,
+ * overlapping ones are merged by keeping the strongest, and the runtime is
+ * only called when the merged output changes: each vibration is applied
+ * with the real duration of the segment it covers, instead of a minimal
+ * pulse every frame, so the traffic no longer depends on the frame rate. */
+
+/* longest single vibration handed to the runtime, endless patterns are
+ * re-applied at this interval */
+#define XRHAPTIC_MAX_CALL 2000000000ull
+
+static uint64_t xrhaptic_ns(float seconds)
+{
+	return seconds > 0.0f ? (uint64_t)((double)seconds * 1e9) : 0;
+}
+
+uint32_t xrhaptic_register(struct xr_haptics *self, XrAction action, XrPath path)
+{
+	const uint32_t slot = self->count++;
+	if (self->count > self->capacity)
+	{
+		self->capacity = self->capacity ? self->capacity * 2 : 8;
+		self->channels = realloc(self->channels,
+		                         sizeof(*self->channels) * self->capacity);
+	}
+	memset(&self->channels[slot], 0, sizeof(self->channels[slot]));
+	self->channels[slot].action = action;
+	self->channels[slot].path = path;
+	return slot;
+}
+
+static void xrhaptic_apply(struct openxr_internal *xr, struct xr_haptic_channel *channel,
+                           float amplitude, float frequency, XrDuration duration)
+{
+	XrHapticVibration vibration = {
+		.type = XR_TYPE_HAPTIC_VIBRATION,
+		.next = NULL,
+		.amplitude = amplitude,
+		.duration = duration,
+		.frequency = frequency > 0.0f ? frequency : XR_FREQUENCY_UNSPECIFIED
+	};
+	XrHapticActionInfo hapticActionInfo = {
+		.type = XR_TYPE_HAPTIC_ACTION_INFO,
+		.next = NULL,
+		.action = channel->action,
+		.subactionPath = channel->path
+	};
+	XrResult result = xrApplyHapticFeedback(xr->session, &hapticActionInfo,
+	                                        (const XrHapticBaseHeader*)&vibration);
+	xr_result(xr->instance, result, "failed to apply haptic feedback!");
+}
+
+static void xrhaptic_stop(struct openxr_internal *xr, struct xr_haptic_channel *channel)
+{
+	XrHapticActionInfo hapticActionInfo = {
+		.type = XR_TYPE_HAPTIC_ACTION_INFO,
+		.next = NULL,
+		.action = channel->action,
+		.subactionPath = channel->path
+	};
+	XrResult result = xrStopHapticFeedback(xr->session, &hapticActionInfo);
+	xr_result(xr->instance, result, "failed to stop haptic feedback!");
+}
+
+/* Queues steps on a channel starting now, played repeat + 1 times or until
+ * cancelled with OPENXR_HAPTIC_FOREVER. Returns the request's id, 0 if the
+ * channel is full. */
+uint32_t xrhaptic_play(struct openxr_internal *xr, uint32_t slot,
+                       const struct openxr_haptic_step *steps, uint32_t count,
+                       uint32_t repeat)
+{
+	struct xr_haptics *self = &xr->haptics;
+	if (slot >= self->count)
+		return 0;
+	struct xr_haptic_channel *channel = &self->channels[slot];
+	struct xr_haptic_request *request = NULL;
+	for (uint32_t i = 0; i < XR_HAPTIC_REQUESTS && !request; i++)
+	{
+		if (!channel->requests[i].id)
+			request = &channel->requests[i];
+	}
+	if (!request)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "too many overlapping haptic requests, dropped one");
+		return 0;
+	}
+
+	request->step_count = 0;
+	request->length = 0;
+	for (uint32_t i = 0; i < count && request->step_count < XR_HAPTIC_STEPS; i++)
+	{
+		/* zero length steps can't be played */
+		const uint64_t duration = xrhaptic_ns(steps[i].duration);
+		if (!duration)
+			continue;
+		request->steps[request->step_count].end = request->length + duration;
+		request->steps[request->step_count].amplitude = steps[i].amplitude;
+		request->steps[request->step_count].frequency = steps[i].frequency;
+		request->step_count++;
+		request->length += duration;
+	}
+	if (!request->step_count)
+		return 0;
+	request->start = xr_time_ns();
+	request->repeat = repeat;
+	if (!++self->next_id)
+		++self->next_id;
+	request->id = self->next_id;
+	return request->id;
+}
+
+void xrhaptic_cancel(struct openxr_internal *xr, uint32_t slot, uint32_t id)
+{
+	struct xr_haptics *self = &xr->haptics;
+	if (slot >= self->count || !id)
+		return;
+	struct xr_haptic_channel *channel = &self->channels[slot];
+	for (uint32_t i = 0; i < XR_HAPTIC_REQUESTS; i++)
+	{
+		if (channel->requests[i].id == id)
+			channel->requests[i].id = 0;
+	}
+}
+
+static bool_t xrhaptic_finished(const struct xr_haptic_request *request,
+                                uint64_t time)
+{
+	return request->repeat != OPENXR_HAPTIC_FOREVER
+	    && time >= request->start
+	    && (time - request->start) / request->length > request->repeat;
+}
+
+/* Merged output of a channel at time, and when it may change next. Returns
+ * false when no request plays at that time. */
+static bool_t xrhaptic_evaluate(const struct xr_haptic_channel *channel, uint64_t time,
+                                float *amplitude, float *frequency, uint64_t *end)
+{
+	bool_t playing = false;
+	*amplitude = 0.0f;
+	*frequency = 0.0f;
+	*end = UINT64_MAX;
+
+	for (uint32_t i = 0; i < XR_HAPTIC_REQUESTS; i++)
+	{
+		const struct xr_haptic_request *request = &channel->requests[i];
+		if (!request->id || time < request->start
+		    || xrhaptic_finished(request, time))
+			continue;
+		const uint64_t elapsed = time - request->start;
+		const uint64_t loop = elapsed / request->length;
+		const uint64_t local = elapsed % request->length;
+		uint32_t s = 0;
+		while (request->steps[s].end <= local)
+			s++;
+		const uint64_t step_end = request->start + loop * request->length
+		                        + request->steps[s].end;
+		if (step_end < *end)
+			*end = step_end;
+		if (!playing || request->steps[s].amplitude > *amplitude)
+		{
+			*amplitude = request->steps[s].amplitude;
+			*frequency = request->steps[s].frequency;
+		}
+		playing = true;
+	}
+	return playing;
+}
+
+/* Brings every channel's vibration in line with its requests, called once
+ * per frame while actions are synced. */
+void xrhaptic_update(struct openxr_internal *xr)
+{
+	struct xr_haptics *self = &xr->haptics;
+	const uint64_t now = xr_time_ns();
+	/* segments ending within a frame are extended rather than re-applied
+	 * late */
+	const uint64_t lead = xr->frame_state.predictedDisplayPeriod > 0
+	                    ? (uint64_t)xr->frame_state.predictedDisplayPeriod
+	                    : 11111111ull;
+
+	for (uint32_t c = 0; c < self->count; c++)
+	{
+		struct xr_haptic_channel *channel = &self->channels[c];
+		float amplitude, frequency;
+		uint64_t end;
+
+		for (uint32_t i = 0; i < XR_HAPTIC_REQUESTS; i++)
+		{
+			if (xrhaptic_finished(&channel->requests[i], now))
+				channel->requests[i].id = 0;
+		}
+		if (!xrhaptic_evaluate(channel, now, &amplitude, &frequency, &end)
+		    || amplitude <= 0.0f)
+		{
+			/* vibrations ending on their own need no stop */
+			if (channel->applied_until > now)
+				xrhaptic_stop(xr, channel);
+			channel->applied_until = 0;
+			continue;
+		}
+
+		if (channel->applied_until > now
+		    && amplitude == channel->amplitude
+		    && frequency == channel->frequency)
+		{
+			if (channel->applied_until >= now + lead)
+				continue;
+			/* about to run out, continue it through the next segment when
+			 * that one plays the same */
+			if (channel->applied_until >= end)
+			{
+				float next_amplitude, next_frequency;
+				if (!xrhaptic_evaluate(channel, end, &next_amplitude,
+				                       &next_frequency, &end)
+				    || next_amplitude != amplitude || next_frequency != frequency)
+					continue;
+			}
+		}
+
+		if (end - now > XRHAPTIC_MAX_CALL)
+			end = now + XRHAPTIC_MAX_CALL;
+		xrhaptic_apply(xr, channel, amplitude, frequency, (XrDuration)(end - now));
+		channel->amplitude = amplitude;
+		channel->frequency = frequency;
+		channel->applied_until = end;
+	}
+}
+
+void xrhaptic_destroy(struct xr_haptics *self)
+{
+	free(self->channels);
+	memset(self, 0, sizeof(*self));
+}
@@ -0,0 +1,281 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <math.h>
+
+static void xrinput_chain_velocities(struct xr_input *self)
+{
+	for (uint32_t i = 0; i < self->count; i++)
+		self->locations[i].next = self->track_velocity ? &self->velocities[i] : NULL;
+}
+
+void xrinput_track_velocity(struct xr_input *self, bool_t track,
+                            float smoothing)
+{
+	self->track_velocity = track;
+	self->velocity_smoothing = smoothing;
+	xrinput_chain_velocities(self);
+}
+
+static void xrinput_grow(struct xr_input *self)
+{
+	self->capacity = self->capacity ? self->capacity * 2 : 8;
+	self->spaces = realloc(self->spaces, sizeof(*self->spaces) * self->capacity);
+	self->paths = realloc(self->paths, sizeof(*self->paths) * self->capacity);
+	self->grab_actions = realloc(self->grab_actions,
+	                             sizeof(*self->grab_actions) * self->capacity);
+	self->lever_actions = realloc(self->lever_actions,
+	                              sizeof(*self->lever_actions) * self->capacity);
+	self->locations = realloc(self->locations,
+	                          sizeof(*self->locations) * self->capacity);
+	self->grab = realloc(self->grab, sizeof(*self->grab) * self->capacity);
+	self->lever = realloc(self->lever, sizeof(*self->lever) * self->capacity);
+	self->active = realloc(self->active, sizeof(*self->active) * self->capacity);
+	self->changed = realloc(self->changed, sizeof(*self->changed) * self->capacity);
+	self->models = realloc(self->models, sizeof(*self->models) * self->capacity);
+	self->worlds = realloc(self->worlds, sizeof(*self->worlds) * self->capacity);
+	self->velocities = realloc(self->velocities,
+	                           sizeof(*self->velocities) * self->capacity);
+	self->linear_velocity = realloc(self->linear_velocity,
+	                                sizeof(*self->linear_velocity) * self->capacity);
+	self->angular_velocity = realloc(self->angular_velocity,
+	                                 sizeof(*self->angular_velocity) * self->capacity);
+	/* the chain points into the reallocated arrays */
+	xrinput_chain_velocities(self);
+}
+
+uint32_t xrinput_register(struct xr_input *self, XrSpace space, XrPath path,
+                          XrAction grab, XrAction lever)
+{
+	uint32_t slot = self->count++;
+	if (self->count > self->capacity)
+		xrinput_grow(self);
+
+	self->spaces[slot] = space;
+	self->paths[slot] = path;
+	self->grab_actions[slot] = grab;
+	self->lever_actions[slot] = lever;
+	self->locations[slot].type = XR_TYPE_SPACE_LOCATION;
+	self->locations[slot].next = self->track_velocity ? &self->velocities[slot] : NULL;
+	self->locations[slot].locationFlags = 0;
+	self->velocities[slot].type = XR_TYPE_SPACE_VELOCITY;
+	self->velocities[slot].next = NULL;
+	self->velocities[slot].velocityFlags = 0;
+	self->linear_velocity[slot] = (XrVector3f){0.0f, 0.0f, 0.0f};
+	self->angular_velocity[slot] = (XrVector3f){0.0f, 0.0f, 0.0f};
+	self->grab[slot] = 0.0f;
+	self->lever[slot] = 0.0f;
+	self->active[slot] = 0;
+	self->changed[slot] = 0;
+	self->models[slot] = mat4();
+	self->worlds[slot] = mat4();
+	return slot;
+}
+
+void xrinput_locate(struct openxr_internal *xr)
+{
+	struct xr_input *self = &xr->input;
+	XrResult result;
+
+#ifdef XR_KHR_locate_spaces
+	if (xr->locate_spaces)
+	{
+		XrSpaceLocationDataKHR data[64];
+		XrSpaceVelocityDataKHR velocity_data[64];
+		uint32_t done = 0;
+		while (done < self->count)
+		{
+			uint32_t batch = self->count - done;
+			if (batch > 64) batch = 64;
+
+			XrSpacesLocateInfoKHR info = {
+				.type = XR_TYPE_SPACES_LOCATE_INFO_KHR,
+				.next = NULL,
+				.baseSpace = xr->local_space,
+				.time = self->time,
+				.spaceCount = batch,
+				.spaces = &self->spaces[done]
+			};
+			XrSpaceVelocitiesKHR velocities = {
+				.type = XR_TYPE_SPACE_VELOCITIES_KHR,
+				.next = NULL,
+				.velocityCount = batch,
+				.velocities = velocity_data
+			};
+			XrSpaceLocationsKHR locations = {
+				.type = XR_TYPE_SPACE_LOCATIONS_KHR,
+				.next = self->track_velocity ? &velocities : NULL,
+				.locationCount = batch,
+				.locations = data
+			};
+			result = xr->locate_spaces(xr->session, &info, &locations);
+			if (!xr_result(xr->instance, result, "failed to locate spaces!"))
+				return;
+			for (uint32_t i = 0; i < batch; i++)
+			{
+				self->locations[done + i].locationFlags = data[i].locationFlags;
+				self->locations[done + i].pose = data[i].pose;
+				if (!self->track_velocity)
+					continue;
+				self->velocities[done + i].velocityFlags = velocity_data[i].velocityFlags;
+				self->velocities[done + i].linearVelocity = velocity_data[i].linearVelocity;
+				self->velocities[done + i].angularVelocity = velocity_data[i].angularVelocity;
+			}
+			done += batch;
+		}
+		return;
+	}
+#endif
+
+	for (uint32_t i = 0; i < self->count; i++)
+	{
+		result = xrLocateSpace(self->spaces[i], xr->local_space, self->time,
+		                       &self->locations[i]);
+		if (!xr_result(xr->instance, result, "failed to locate space %d!", i))
+			self->locations[i].locationFlags = 0;
+	}
+}
+
+static void xrinput_filter(XrVector3f *filtered, const XrVector3f *sample,
+                           bool_t valid, float smoothing)
+{
+	if (!valid)
+	{
+		*filtered = (XrVector3f){0.0f, 0.0f, 0.0f};
+		return;
+	}
+	filtered->x = filtered->x * smoothing + sample->x * (1.0f - smoothing);
+	filtered->y = filtered->y * smoothing + sample->y * (1.0f - smoothing);
+	filtered->z = filtered->z * smoothing + sample->z * (1.0f - smoothing);
+}
+
+static void xrinput_sample_velocities(struct xr_input *self)
+{
+	for (uint32_t i = 0; i < self->count; i++)
+	{
+		const XrSpaceVelocity *velocity = &self->velocities[i];
+		xrinput_filter(&self->linear_velocity[i], &velocity->linearVelocity,
+		               velocity->velocityFlags & XR_SPACE_VELOCITY_LINEAR_VALID_BIT,
+		               self->velocity_smoothing);
+		xrinput_filter(&self->angular_velocity[i], &velocity->angularVelocity,
+		               velocity->velocityFlags & XR_SPACE_VELOCITY_ANGULAR_VALID_BIT,
+		               self->velocity_smoothing);
+	}
+}
+
+/* Extrapolates the last sampled pose of slot to time using its filtered
+ * velocities. The angular velocity is expressed in the base space, so the
+ * rotation it integrates to is applied on the left. */
+void xrinput_predict(struct xr_input *self, uint32_t slot, XrTime time,
+                     XrPosef *pose)
+{
+	const XrVector3f v = self->linear_velocity[slot];
+	const XrVector3f w = self->angular_velocity[slot];
+	const XrQuaternionf q = self->locations[slot].pose.orientation;
+	const float dt = (float)(time - self->time) * 1e-9f;
+
+	*pose = self->locations[slot].pose;
+	if (!self->track_velocity || dt == 0.0f)
+		return;
+
+	pose->position.x += v.x * dt;
+	pose->position.y += v.y * dt;
+	pose->position.z += v.z * dt;
+
+	const float speed = sqrtf(w.x * w.x + w.y * w.y + w.z * w.z);
+	if (speed < 1e-6f)
+		return;
+
+	const float half = speed * dt * 0.5f;
+	const float s = sinf(half) / speed;
+	const XrQuaternionf r = {w.x * s, w.y * s, w.z * s, cosf(half)};
+
+	pose->orientation.x = r.w * q.x + r.x * q.w + r.y * q.z - r.z * q.y;
+	pose->orientation.y = r.w * q.y - r.x * q.z + r.y * q.w + r.z * q.x;
+	pose->orientation.z = r.w * q.z + r.x * q.y - r.y * q.x + r.z * q.w;
+	pose->orientation.w = r.w * q.w - r.x * q.x - r.y * q.y - r.z * q.z;
+}
+
+/* Model matrices of every body for the poses just located, placed under
+ * origin, in one batch. */
+void xrinput_models(struct openxr_internal *xr, const mat4_t *origin)
+{
+	struct xr_input *self = &xr->input;
+	self->origin = *origin;
+	if (!self->count)
+		return;
+	xrpose_models(&self->locations[0].pose, sizeof(*self->locations), self->count,
+	              &xr->actions.grip, origin,
+	              self->models, self->worlds);
+}
+
+static void xrinput_sample_float(struct openxr_internal *xr, XrAction action,
+                                 XrPath path, float *value, uint8_t *active,
+                                 uint8_t *changed, uint8_t bit)
+{
+	XrActionStateGetInfo getInfo = {
+		.type = XR_TYPE_ACTION_STATE_GET_INFO,
+		.next = NULL,
+		.action = action,
+		.subactionPath = path
+	};
+	XrActionStateFloat state = {
+		.type = XR_TYPE_ACTION_STATE_FLOAT,
+		.next = NULL
+	};
+	XrResult result = xrGetActionStateFloat(xr->session, &getInfo, &state);
+	if (!xr_result(xr->instance, result, "failed to get float value!"))
+		return;
+	*value = state.currentState;
+	if (state.isActive) *active |= bit;
+	if (state.changedSinceLastSync) *changed |= bit;
+}
+
+/* Queries every registered body once, the pose action's activity is implied
+ * by the validity of its space so it is not queried separately. */
+void xrinput_sample(struct openxr_internal *xr)
+{
+	struct xr_input *self = &xr->input;
+	self->time = xr->frame_state.predictedDisplayTime;
+	if (!self->count)
+		return;
+
+	memset(self->active, 0, self->count);
+	memset(self->changed, 0, self->count);
+
+	xrinput_locate(xr);
+	if (self->track_velocity)
+		xrinput_sample_velocities(self);
+
+	for (uint32_t i = 0; i < self->count; i++)
+	{
+		if (self->locations[i].locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT)
+			self->active[i] |= XR_INPUT_POSE;
+
+		xrinput_sample_float(xr, self->grab_actions[i], self->paths[i],
+		                     &self->grab[i], &self->active[i],
+		                     &self->changed[i], XR_INPUT_GRAB);
+		xrinput_sample_float(xr, self->lever_actions[i], self->paths[i],
+		                     &self->lever[i], &self->active[i],
+		                     &self->changed[i], XR_INPUT_LEVER);
+	}
+}
+
+void xrinput_destroy(struct xr_input *self)
+{
+	free(self->spaces);
+	free(self->paths);
+	free(self->grab_actions);
+	free(self->lever_actions);
+	free(self->locations);
+	free(self->velocities);
+	free(self->linear_velocity);
+	free(self->angular_velocity);
+	free(self->grab);
+	free(self->lever);
+	free(self->active);
+	free(self->changed);
+	free(self->models);
+	free(self->worlds);
+	*self = (struct xr_input){0};
+}
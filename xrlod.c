@@ -0,0 +1,46 @@
+#include "openxr.h"
+
+#include "internals.h"
+
+/* projected diameter in pixels above which a level is preferred over the
+ * next coarser one */
+static const float xrlod_pixels[XR_LOD_LEVELS - 1] = {320.0f, 96.0f};
+/* a finer level is only taken back once the size clears its threshold by
+ * this factor, so models resting near a threshold don't flicker */
+#define XR_LOD_HYSTERESIS 1.15f
+
+/* Picks the level of a model from its largest projected size over the last
+ * frame's views. Sizes are measured in rendered pixels, so a lowered
+ * dynamic resolution already favors coarser levels, and they are halved
+ * further while the GPU is over budget. */
+uint32_t xrlod_select(const struct openxr_internal *xr, vec3_t center,
+                      float radius, uint32_t level_count, uint32_t current)
+{
+	const struct xr_lod *self = &xr->lod;
+	float size = 0.0f;
+	uint32_t level = 0;
+
+	if (level_count < 2)
+		return 0;
+	for (uint32_t i = 0; i < self->view_count; i++)
+	{
+		const float distance = vec3_len(vec3_sub(center, self->positions[i]));
+		const float view_size = distance > radius
+		                      ? 2.0f * radius * self->pixels_per_meter[i] / distance
+		                      : 1e9f;
+		if (view_size > size) size = view_size;
+	}
+	if (xr->resolution.enabled && xr->resolution.over_budget)
+		size *= 0.5f;
+
+	while (level < level_count - 1)
+	{
+		float threshold = xrlod_pixels[level];
+		if (level < current)
+			threshold *= XR_LOD_HYSTERESIS;
+		if (size > threshold)
+			break;
+		level++;
+	}
+	return level;
+}
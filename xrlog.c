@@ -0,0 +1,738 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <stdarg.h>
+#include <string.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+/* Deferred logging. Every thread writes its records into its own ring,
+ * read by the log thread which does the formatting and the console I/O.
+ * Producers only scan the format to copy its arguments, strings included,
+ * so they can be formatted later. Rings go back to a pool when their thread
+ * exits, records of threads finding none left are counted as dropped. Each
+ * call site, keyed by its format, is limited to XRLOG_BURST records per
+ * window, the others are only counted and reported with the next record or
+ * once the window is over. */
+
+#define XRLOG_RING_SIZE 128
+#define XRLOG_MAX_THREADS 16
+#define XRLOG_MAX_ARGS 8
+#define XRLOG_TEXT 192
+#define XRLOG_SITES 256
+#define XRLOG_LABEL 96
+#define XRLOG_WINDOW_MS 1000
+#define XRLOG_BURST 4
+
+#ifdef _WIN32
+#define XR_THREAD_LOCAL __declspec(thread)
+#else
+#define XR_THREAD_LOCAL __thread
+#endif
+
+enum
+{
+	XRLOG_INT,
+	XRLOG_UINT,
+	XRLOG_DOUBLE,
+	XRLOG_STRING,
+	XRLOG_POINTER
+};
+
+struct xrlog_arg
+{
+	uint32_t kind;
+	union
+	{
+		int64_t i;
+		uint64_t u;
+		double d;
+		uint32_t text;
+		const void *p;
+	} value;
+};
+
+struct xrlog_record
+{
+	const char *format;
+	struct xrlog_site *site;
+	uint32_t repeated;
+	uint8_t severity;
+	uint8_t category;
+	uint8_t arg_count;
+	/* offset of the XrResult string in text, or -1 */
+	int16_t detail;
+	uint32_t text_used;
+	struct xrlog_arg args[XRLOG_MAX_ARGS];
+	char text[XRLOG_TEXT];
+};
+
+/* single producer, the owning thread, and single consumer, the log thread */
+struct xrlog_ring
+{
+	/* set while a thread writes into the ring */
+	xr_atomic_t owned;
+	xr_atomic_t head;
+	xr_atomic_t tail;
+	struct xrlog_record records[XRLOG_RING_SIZE];
+};
+
+struct xrlog_site
+{
+	uint64_t key;
+	xr_atomic_t claimed;
+	/* what suppression reports name the site by */
+	char label[XRLOG_LABEL];
+	xr_atomic_t window;
+	xr_atomic_t emitted;
+	xr_atomic_t suppressed;
+	xr_atomic_t total_suppressed;
+};
+
+static struct
+{
+	struct xrlog_ring *volatile rings[XRLOG_MAX_THREADS];
+	xr_atomic_t min_severity;
+	xr_atomic_t categories;
+	xr_atomic_t running;
+	xr_atomic_t dropped;
+	/* records of threads that found no free ring */
+	xr_atomic_t ringless;
+	/* 1 while the thread exit hook is created, 2 once it is */
+	xr_atomic_t hook_state;
+#ifdef _WIN32
+	DWORD hook;
+#else
+	pthread_key_t hook;
+#endif
+	xr_thread_t thread;
+	struct xrlog_site sites[XRLOG_SITES];
+} xrlog = {
+	.min_severity = OPENXR_LOG_INFO,
+	.categories = OPENXR_LOG_ALL
+};
+
+static XR_THREAD_LOCAL struct xrlog_ring *xrlog_local;
+
+static const char xrlog_severities[] = "VIWE";
+static const char *xrlog_category(uint32_t category)
+{
+	switch (category)
+	{
+	case OPENXR_LOG_CALLS: return "xr";
+	case OPENXR_LOG_RUNTIME: return "runtime";
+	default: return "plugin";
+	}
+}
+
+static uint64_t xrlog_now(void)
+{
+#ifdef _WIN32
+	return GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+static void xrlog_sleep(void)
+{
+#ifdef _WIN32
+	Sleep(2);
+#else
+	const struct timespec ts = {0, 2000000};
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/* ------------------------------------------------------------------------ */
+/* producer side */
+
+static struct xrlog_site *xrlog_site(uint64_t key, const char *label)
+{
+	const uint32_t start = (uint32_t)((key * 0x9e3779b97f4a7c15ull) >> 56);
+	for (uint32_t i = 0; i < XRLOG_SITES; i++)
+	{
+		struct xrlog_site *site = &xrlog.sites[(start + i) % XRLOG_SITES];
+		long claimed = xr_atomic_load(&site->claimed);
+		if (claimed == 0)
+		{
+			/* 1 while the key is written, 2 once it can be compared */
+			if (xr_atomic_cas(&site->claimed, 0, 1))
+			{
+				site->key = key;
+				snprintf(site->label, sizeof(site->label), "%s", label);
+				xr_atomic_store(&site->claimed, 2);
+				return site;
+			}
+			claimed = xr_atomic_load(&site->claimed);
+		}
+		while (claimed == 1)
+		{
+			xr_thread_yield();
+			claimed = xr_atomic_load(&site->claimed);
+		}
+		if (site->key == key)
+			return site;
+	}
+	/* full table, the site is not limited */
+	return NULL;
+}
+
+static bool_t xrlog_admit(struct xrlog_site *site, uint32_t *repeated)
+{
+	const long window = (long)(xrlog_now() / XRLOG_WINDOW_MS);
+	if (xr_atomic_load(&site->window) != window)
+	{
+		xr_atomic_store(&site->window, window);
+		xr_atomic_store(&site->emitted, 0);
+	}
+	if (xr_atomic_add(&site->emitted, 1) >= XRLOG_BURST)
+	{
+		xr_atomic_add(&site->suppressed, 1);
+		xr_atomic_add(&site->total_suppressed, 1);
+		return false;
+	}
+	*repeated = (uint32_t)xr_atomic_swap(&site->suppressed, 0);
+	return true;
+}
+
+/* Gives the ring of an exiting thread back to the pool, records it left
+ * are still drained. */
+#ifdef _WIN32
+static VOID WINAPI xrlog_release(PVOID data)
+#else
+static void xrlog_release(void *data)
+#endif
+{
+	struct xrlog_ring *ring = data;
+	if (ring)
+		xr_atomic_store(&ring->owned, 0);
+}
+
+static bool_t xrlog_hook(void)
+{
+	long state = xr_atomic_load(&xrlog.hook_state);
+	if (state == 0 && xr_atomic_cas(&xrlog.hook_state, 0, 1))
+	{
+#ifdef _WIN32
+		xrlog.hook = FlsAlloc(xrlog_release);
+		const bool_t created = xrlog.hook != FLS_OUT_OF_INDEXES;
+#else
+		const bool_t created = !pthread_key_create(&xrlog.hook, xrlog_release);
+#endif
+		/* without it rings are never recycled, but still work */
+		xr_atomic_store(&xrlog.hook_state, created ? 2 : 3);
+	}
+	while ((state = xr_atomic_load(&xrlog.hook_state)) == 1)
+		xr_thread_yield();
+	return state == 2;
+}
+
+static struct xrlog_ring *xrlog_ring(void)
+{
+	if (xrlog_local)
+		return xrlog_local;
+	struct xrlog_ring *ring = NULL;
+	for (uint32_t i = 0; i < XRLOG_MAX_THREADS && !ring; i++)
+	{
+		struct xrlog_ring *slot = xr_atomic_load_ptr(&xrlog.rings[i]);
+		if (!slot)
+		{
+			struct xrlog_ring *created = calloc(1, sizeof(*created));
+			created->owned = 1;
+			if (xr_atomic_cas_ptr(&xrlog.rings[i], NULL, created))
+			{
+				ring = created;
+				break;
+			}
+			free(created);
+			slot = xr_atomic_load_ptr(&xrlog.rings[i]);
+		}
+		if (xr_atomic_cas(&slot->owned, 0, 1))
+			ring = slot;
+	}
+	if (!ring)
+	{
+		xr_atomic_add(&xrlog.ringless, 1);
+		return NULL;
+	}
+	if (xrlog_hook())
+	{
+#ifdef _WIN32
+		FlsSetValue(xrlog.hook, ring);
+#else
+		pthread_setspecific(xrlog.hook, ring);
+#endif
+	}
+	xrlog_local = ring;
+	return ring;
+}
+
+/* Reserves the next record of the calling thread's ring, NULL when the
+ * record is filtered, rate limited or the ring is full. */
+static struct xrlog_record *xrlog_begin(uint32_t severity, uint32_t category,
+                                        uint64_t key, const char *format,
+                                        const char *label)
+{
+	struct xrlog_site *site;
+	struct xrlog_ring *ring;
+	uint32_t repeated = 0;
+
+	if ((long)severity < xr_atomic_load(&xrlog.min_severity)
+	    || !(xr_atomic_load(&xrlog.categories) & category))
+		return NULL;
+	site = xrlog_site(key, label);
+	if (site && !xrlog_admit(site, &repeated))
+		return NULL;
+	ring = xrlog_ring();
+	if (!ring)
+		return NULL;
+
+	const unsigned long head = (unsigned long)ring->head;
+	if (head - (unsigned long)xr_atomic_load(&ring->tail) >= XRLOG_RING_SIZE)
+	{
+		xr_atomic_add(&xrlog.dropped, 1);
+		return NULL;
+	}
+	struct xrlog_record *record = &ring->records[head % XRLOG_RING_SIZE];
+	record->format = format;
+	record->site = site;
+	record->repeated = repeated;
+	record->severity = severity;
+	record->category = category;
+	record->arg_count = 0;
+	record->detail = -1;
+	record->text_used = 0;
+	return record;
+}
+
+static void xrlog_commit(void)
+{
+	xr_atomic_store(&xrlog_local->head, xrlog_local->head + 1);
+}
+
+static int16_t xrlog_copy(struct xrlog_record *record, const char *string)
+{
+	const uint32_t offset = record->text_used;
+	if (offset >= XRLOG_TEXT)
+		return -1;
+	if (!string)
+		string = "(null)";
+	size_t length = strlen(string);
+	if (length > XRLOG_TEXT - offset - 1)
+		length = XRLOG_TEXT - offset - 1;
+	memcpy(&record->text[offset], string, length);
+	record->text[offset + length] = '\0';
+	record->text_used = offset + (uint32_t)length + 1;
+	return (int16_t)offset;
+}
+
+/* Walks the format like printf would and copies the arguments. */
+static void xrlog_capture(struct xrlog_record *record, const char *format,
+                          va_list args)
+{
+	for (const char *c = format; *c; c++)
+	{
+		if (*c != '%')
+			continue;
+		if (*++c == '%')
+			continue;
+		while (*c && strchr("-+ #0", *c))
+			c++;
+		for (uint32_t field = 0; field < 2; field++)
+		{
+			/* width, then precision */
+			if (field == 1)
+			{
+				if (*c != '.')
+					break;
+				c++;
+			}
+			if (*c == '*')
+			{
+				const int value = va_arg(args, int);
+				if (record->arg_count < XRLOG_MAX_ARGS)
+				{
+					struct xrlog_arg *arg = &record->args[record->arg_count++];
+					arg->kind = XRLOG_INT;
+					arg->value.i = value;
+				}
+				c++;
+			}
+			while (*c >= '0' && *c <= '9')
+				c++;
+		}
+
+		uint32_t longs = 0;
+		char size = 0;
+		while (*c && strchr("hljztL", *c))
+		{
+			if (*c == 'l') longs++;
+			else size = *c;
+			c++;
+		}
+
+		struct xrlog_arg arg;
+		switch (*c)
+		{
+		case 'd': case 'i':
+			arg.kind = XRLOG_INT;
+			if (longs >= 2 || size == 'j') arg.value.i = va_arg(args, long long);
+			else if (longs == 1 || size == 't') arg.value.i = va_arg(args, long);
+			else if (size == 'z') arg.value.i = (int64_t)va_arg(args, size_t);
+			else arg.value.i = va_arg(args, int);
+			break;
+		case 'u': case 'o': case 'x': case 'X':
+			arg.kind = XRLOG_UINT;
+			if (longs >= 2 || size == 'j') arg.value.u = va_arg(args, unsigned long long);
+			else if (longs == 1 || size == 't') arg.value.u = va_arg(args, unsigned long);
+			else if (size == 'z') arg.value.u = va_arg(args, size_t);
+			else arg.value.u = va_arg(args, unsigned);
+			break;
+		case 'c':
+			arg.kind = XRLOG_INT;
+			arg.value.i = va_arg(args, int);
+			break;
+		case 'f': case 'F': case 'e': case 'E':
+		case 'g': case 'G': case 'a': case 'A':
+			arg.kind = XRLOG_DOUBLE;
+			arg.value.d = size == 'L' ? (double)va_arg(args, long double)
+			                          : va_arg(args, double);
+			break;
+		case 's':
+			arg.kind = XRLOG_STRING;
+			arg.value.text = (uint32_t)xrlog_copy(record, va_arg(args, const char*));
+			break;
+		case 'p':
+			arg.kind = XRLOG_POINTER;
+			arg.value.p = va_arg(args, void*);
+			break;
+		default:
+			/* %n or a malformed conversion, stop there */
+			return;
+		}
+		if (record->arg_count < XRLOG_MAX_ARGS)
+			record->args[record->arg_count++] = arg;
+	}
+}
+
+void xr_log(uint32_t severity, uint32_t category, const char *format, ...)
+{
+	struct xrlog_record *record = xrlog_begin(severity, category,
+	                                          (uint64_t)(uintptr_t)format,
+	                                          format, format);
+	if (!record)
+		return;
+	va_list args;
+	va_start(args, format);
+	xrlog_capture(record, format, args);
+	va_end(args);
+	xrlog_commit();
+}
+
+/* Returns whether the call succeeded, failures are logged with the name of
+ * the result, rate limited per format. */
+bool_t xr_result(XrInstance instance, XrResult result, const char *format, ...)
+{
+	if (XR_SUCCEEDED(result))
+		return true;
+
+	struct xrlog_record *record = xrlog_begin(OPENXR_LOG_ERROR, OPENXR_LOG_CALLS,
+	                                          (uint64_t)(uintptr_t)format,
+	                                          format, format);
+	if (!record)
+		return false;
+
+	char resultString[XR_MAX_RESULT_STRING_SIZE];
+	if (XR_FAILED(xrResultToString(instance, result, resultString)))
+		snprintf(resultString, sizeof(resultString), "%d", (int)result);
+
+	va_list args;
+	va_start(args, format);
+	xrlog_capture(record, format, args);
+	va_end(args);
+	record->detail = xrlog_copy(record, resultString);
+	xrlog_commit();
+	return false;
+}
+
+/* Runtime messages have no format of their own, their sites are keyed and
+ * labelled by message id instead. */
+void xrlog_messenger(XrDebugUtilsMessageSeverityFlagsEXT severity,
+                     const XrDebugUtilsMessengerCallbackDataEXT *msg)
+{
+	const char *id = msg->messageId ? msg->messageId : msg->functionName;
+	uint64_t key = xr_hash((const uint8_t*)(id ? id : ""), id ? strlen(id) : 0);
+	uint32_t level = OPENXR_LOG_VERBOSE;
+
+	if (severity & XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+		level = OPENXR_LOG_ERROR;
+	else if (severity & XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+		level = OPENXR_LOG_WARNING;
+	else if (severity & XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+		level = OPENXR_LOG_INFO;
+
+	struct xrlog_record *record = xrlog_begin(level, OPENXR_LOG_RUNTIME,
+	                                          key, "%s: %s", id ? id : "runtime");
+	if (!record)
+		return;
+	record->args[0].kind = XRLOG_STRING;
+	record->args[0].value.text = (uint32_t)xrlog_copy(record, msg->functionName);
+	record->args[1].kind = XRLOG_STRING;
+	record->args[1].value.text = (uint32_t)xrlog_copy(record, msg->message);
+	record->arg_count = 2;
+	xrlog_commit();
+}
+
+/* Severities worth asking the debug messenger for. */
+XrDebugUtilsMessageSeverityFlagsEXT xrlog_messenger_severities(void)
+{
+	const long min = xr_atomic_load(&xrlog.min_severity);
+	XrDebugUtilsMessageSeverityFlagsEXT flags = XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	if (min <= OPENXR_LOG_WARNING)
+		flags |= XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+	if (min <= OPENXR_LOG_INFO)
+		flags |= XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+	if (min <= OPENXR_LOG_VERBOSE)
+		flags |= XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+	return flags;
+}
+
+void xrlog_filter(uint32_t min_severity, uint32_t categories)
+{
+	xr_atomic_store(&xrlog.min_severity, (long)min_severity);
+	xr_atomic_store(&xrlog.categories, (long)categories);
+}
+
+/* ------------------------------------------------------------------------ */
+/* log thread */
+
+/* Formats one record, conversions are rebuilt with the widest length
+ * modifier matching the captured argument. */
+static void xrlog_render(const struct xrlog_record *record, char *out, size_t size)
+{
+	size_t n = 0;
+	uint32_t a = 0;
+	const char *c = record->format;
+
+#define XRLOG_PUT(...) do { \
+		const int written = snprintf(out + n, size - n, __VA_ARGS__); \
+		if (written > 0) n += (size_t)written < size - n ? (size_t)written : size - n - 1; \
+	} while (0)
+
+	XRLOG_PUT("[%c] %s: ", xrlog_severities[record->severity & 3],
+	          xrlog_category(record->category));
+	while (*c && n + 1 < size)
+	{
+		if (c[0] == '%' && c[1] == '%')
+		{
+			out[n++] = '%';
+			c += 2;
+			continue;
+		}
+		if (*c != '%' || a >= record->arg_count)
+		{
+			if (*c != '\n')
+				out[n++] = *c;
+			c++;
+			continue;
+		}
+
+		char spec[48];
+		size_t s = 0;
+		spec[s++] = *c++;
+		while (*c && strchr("-+ #0", *c) && s < 8)
+			spec[s++] = *c++;
+		for (uint32_t field = 0; field < 2; field++)
+		{
+			if (field == 1)
+			{
+				if (*c != '.')
+					break;
+				spec[s++] = *c++;
+			}
+			if (*c == '*')
+			{
+				const int value = a < record->arg_count ? (int)record->args[a++].value.i : 0;
+				s += snprintf(spec + s, sizeof(spec) - s - 4, "%d", value);
+				c++;
+			}
+			while (*c >= '0' && *c <= '9' && s < sizeof(spec) - 8)
+				spec[s++] = *c++;
+		}
+		while (*c && strchr("hljztL", *c))
+			c++;
+		if (!*c || a >= record->arg_count)
+			break;
+
+		const struct xrlog_arg *arg = &record->args[a++];
+		const char conversion = *c++;
+		switch (arg->kind)
+		{
+		case XRLOG_INT:
+			if (conversion == 'c')
+			{
+				spec[s++] = 'c';
+				spec[s] = '\0';
+				XRLOG_PUT(spec, (int)arg->value.i);
+				break;
+			}
+			spec[s++] = 'l';
+			spec[s++] = 'l';
+			spec[s++] = conversion;
+			spec[s] = '\0';
+			XRLOG_PUT(spec, (long long)arg->value.i);
+			break;
+		case XRLOG_UINT:
+			spec[s++] = 'l';
+			spec[s++] = 'l';
+			spec[s++] = conversion;
+			spec[s] = '\0';
+			XRLOG_PUT(spec, (unsigned long long)arg->value.u);
+			break;
+		case XRLOG_DOUBLE:
+			spec[s++] = conversion;
+			spec[s] = '\0';
+			XRLOG_PUT(spec, arg->value.d);
+			break;
+		case XRLOG_STRING:
+			spec[s++] = 's';
+			spec[s] = '\0';
+			XRLOG_PUT(spec, arg->value.text < XRLOG_TEXT
+			          ? &record->text[arg->value.text] : "");
+			break;
+		case XRLOG_POINTER:
+			spec[s++] = 'p';
+			spec[s] = '\0';
+			XRLOG_PUT(spec, arg->value.p);
+			break;
+		}
+	}
+	if (record->detail >= 0)
+		XRLOG_PUT(" [%s]", &record->text[record->detail]);
+	if (record->repeated)
+		XRLOG_PUT(" (%u more suppressed)", record->repeated);
+	XRLOG_PUT("\n");
+#undef XRLOG_PUT
+	out[n] = '\0';
+}
+
+/* Writes the pending records of every ring, returns how many. */
+static uint32_t xrlog_drain(void)
+{
+	char line[512];
+	uint32_t count = 0;
+
+	for (uint32_t r = 0; r < XRLOG_MAX_THREADS; r++)
+	{
+		struct xrlog_ring *ring = xr_atomic_load_ptr(&xrlog.rings[r]);
+		if (!ring)
+			continue;
+		unsigned long tail = (unsigned long)ring->tail;
+		const unsigned long head = (unsigned long)xr_atomic_load(&ring->head);
+		for (; tail != head; tail++)
+		{
+			xrlog_render(&ring->records[tail % XRLOG_RING_SIZE], line, sizeof(line));
+			fputs(line, stdout);
+			count++;
+		}
+		xr_atomic_store(&ring->tail, (long)tail);
+	}
+	const long dropped = xr_atomic_swap(&xrlog.dropped, 0);
+	if (dropped)
+		printf("[W] log: %ld records dropped, rings full\n", dropped);
+	const long ringless = xr_atomic_swap(&xrlog.ringless, 0);
+	if (ringless)
+		printf("[W] log: %ld records dropped, more than %d threads logging\n",
+		       ringless, XRLOG_MAX_THREADS);
+	if (count || dropped || ringless)
+		fflush(stdout);
+	return count;
+}
+
+/* Reports the sites that went quiet while being suppressed, their count
+ * would otherwise wait for their next record. */
+static void xrlog_flush_sites(bool_t all)
+{
+	const long window = (long)(xrlog_now() / XRLOG_WINDOW_MS);
+	for (uint32_t i = 0; i < XRLOG_SITES; i++)
+	{
+		struct xrlog_site *site = &xrlog.sites[i];
+		if (xr_atomic_load(&site->claimed) != 2 || !xr_atomic_load(&site->suppressed))
+			continue;
+		if (!all && xr_atomic_load(&site->window) == window)
+			continue;
+		const long suppressed = xr_atomic_swap(&site->suppressed, 0);
+		if (suppressed)
+			printf("[I] log: \"%s\" suppressed %ld times\n", site->label, suppressed);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI xrlog_loop(void *data)
+#else
+static void *xrlog_loop(void *data)
+#endif
+{
+	uint64_t last_flush = xrlog_now();
+	(void)data;
+	while (xr_atomic_load(&xrlog.running))
+	{
+		if (!xrlog_drain())
+			xrlog_sleep();
+		if (xrlog_now() - last_flush >= XRLOG_WINDOW_MS)
+		{
+			xrlog_flush_sites(false);
+			last_flush = xrlog_now();
+		}
+	}
+	return 0;
+}
+
+/* Returns whether this call started the log thread. */
+bool_t xrlog_start(void)
+{
+	if (xr_atomic_swap(&xrlog.running, 1))
+		return false;
+#ifdef _WIN32
+	xrlog.thread = CreateThread(NULL, 0, xrlog_loop, NULL, 0, NULL);
+	if (!xrlog.thread)
+#else
+	if (pthread_create(&xrlog.thread, NULL, xrlog_loop, NULL))
+#endif
+	{
+		printf("failed to start log thread, records are written on exit\n");
+		xr_atomic_store(&xrlog.running, 0);
+		return false;
+	}
+	return true;
+}
+
+/* Joins the log thread, writes what is left and the totals of every rate
+ * limited site. */
+void xrlog_stop(void)
+{
+	if (xr_atomic_swap(&xrlog.running, 0))
+	{
+#ifdef _WIN32
+		WaitForSingleObject(xrlog.thread, INFINITE);
+		CloseHandle(xrlog.thread);
+#else
+		pthread_join(xrlog.thread, NULL);
+#endif
+	}
+	xrlog_drain();
+	xrlog_flush_sites(true);
+	for (uint32_t i = 0; i < XRLOG_SITES; i++)
+	{
+		struct xrlog_site *site = &xrlog.sites[i];
+		const long total = xr_atomic_load(&site->total_suppressed);
+		if (xr_atomic_load(&site->claimed) == 2 && total)
+			printf("[I] log: \"%s\" suppressed %ld times in total\n",
+			       site->label, total);
+	}
+	fflush(stdout);
+}
@@ -0,0 +1,233 @@
+#include "openxr.h"
+
+#include "internals.h"
+
+/* Hidden area priming. The mesh of every view goes in one buffer, each
+ * view draws its own range of it. Triangles are placed on the near plane,
+ * leaving depth test failing for everything behind them. */
+
+static const char *xrmask_vs =
+	"uniform mat4 projection;\n"
+	"layout(location = 0) in vec2 pos;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = projection * vec4(pos, -1.0, 1.0);\n"
+	"	gl_Position.z = -gl_Position.w;\n"
+	"}\n";
+
+static const char *xrmask_fs =
+	"void main() { }\n";
+
+static GLuint xr_shader(GLenum type, const char *prefix, const char *src)
+{
+	const char *sources[] = {"#version 330\n", prefix, src};
+	GLint status;
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 3, sources, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "shader: %s", log);
+	}
+	return shader;
+}
+
+/* Builds the plugin's own GL programs, the prefix goes right after the
+ * version line of both stages. Returns 0 on failure. */
+GLuint xr_program(const char *prefix, const char *vs_source,
+                  const char *fs_source)
+{
+	GLuint vs = xr_shader(GL_VERTEX_SHADER, prefix, vs_source);
+	GLuint fs = xr_shader(GL_FRAGMENT_SHADER, prefix, fs_source);
+	GLuint program = glCreateProgram();
+	GLint status;
+
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+static void xrmask_program(struct openxr_internal *xr)
+{
+	struct xr_visibility_mask *self = &xr->mask;
+	self->program = xr_program("", xrmask_vs, xrmask_fs);
+	if (!self->program)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN,
+		       "failed to link visibility mask program");
+		return;
+	}
+	self->projection_loc = glGetUniformLocation(self->program, "projection");
+}
+
+/* Fetches the hidden triangle mesh of every view, called at init and after
+ * each XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR. */
+static void xrmask_build(struct openxr_internal *xr)
+{
+	struct xr_visibility_mask *self = &xr->mask;
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_total = 0;
+	uint32_t index_total = 0;
+	XrResult result;
+
+	/* stays dirty until every view was fetched, a failure is retried on the
+	 * next frame instead of leaving the mask empty for the session */
+	self->index_count = 0;
+
+	for (uint32_t i = 0; i < xr->view_count && i < XR_MAX_VIEWS; i++)
+	{
+		XrVisibilityMaskKHR mask = {
+			.type = XR_TYPE_VISIBILITY_MASK_KHR,
+			.next = NULL
+		};
+		result = self->get(xr->session, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+		                   i, XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR,
+		                   &mask);
+		if (!xr_result(xr->instance, result, "failed to get visibility mask size"))
+			goto end;
+
+		XrVector2f *view_vertices = malloc(sizeof(*view_vertices) * mask.vertexCountOutput);
+		mask.vertexCapacityInput = mask.vertexCountOutput;
+		mask.vertices = view_vertices;
+		indices = realloc(indices, sizeof(*indices) * (index_total + mask.indexCountOutput));
+		mask.indexCapacityInput = mask.indexCountOutput;
+		mask.indices = &indices[index_total];
+
+		result = self->get(xr->session, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+		                   i, XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR,
+		                   &mask);
+		if (!xr_result(xr->instance, result, "failed to get visibility mask"))
+		{
+			free(view_vertices);
+			goto end;
+		}
+
+		vertices = realloc(vertices, sizeof(*vertices) * 2
+		                   * (vertex_total + mask.vertexCountOutput));
+		for (uint32_t v = 0; v < mask.vertexCountOutput; v++)
+		{
+			vertices[(vertex_total + v) * 2 + 0] = view_vertices[v].x;
+			vertices[(vertex_total + v) * 2 + 1] = view_vertices[v].y;
+		}
+		free(view_vertices);
+		for (uint32_t n = 0; n < mask.indexCountOutput; n++)
+			indices[index_total + n] += vertex_total;
+
+		self->first[i] = index_total;
+		self->count[i] = mask.indexCountOutput;
+		vertex_total += mask.vertexCountOutput;
+		index_total += mask.indexCountOutput;
+	}
+
+	if (!self->vao)
+	{
+		glGenVertexArrays(1, &self->vao);
+		glGenBuffers(1, &self->vbo);
+		glGenBuffers(1, &self->ibo);
+	}
+	glBindVertexArray(self->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(*vertices) * 2 * vertex_total,
+	             vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(*indices) * index_total,
+	             indices, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	self->index_count = index_total;
+	self->dirty = false;
+	xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN, "visibility mask hides %u triangles",
+	       index_total / 3);
+
+end:
+	free(vertices);
+	free(indices);
+}
+
+void xrmask_init(struct openxr_internal *xr)
+{
+	struct xr_visibility_mask *self = &xr->mask;
+	if (!self->get)
+		return;
+	xrmask_program(xr);
+	self->dirty = self->program != 0;
+}
+
+void xrmask_invalidate(struct openxr_internal *xr)
+{
+	if (xr->mask.program)
+		xr->mask.dirty = true;
+}
+
+void xrmask_destroy(struct openxr_internal *xr)
+{
+	struct xr_visibility_mask *self = &xr->mask;
+	glDeleteProgram(self->program);
+	glDeleteVertexArrays(1, &self->vao);
+	glDeleteBuffers(1, &self->vbo);
+	glDeleteBuffers(1, &self->ibo);
+	*self = (struct xr_visibility_mask){0};
+}
+
+/* Clears the framebuffer's depth and stencil and marks the hidden area of
+ * the view as already occluded in them. Returns false, leaving the
+ * framebuffer untouched, when there is no mask. */
+bool_t xrmask_prime(struct openxr_internal *xr, GLuint framebuffer,
+                    uint32_t view, const mat4_t *projections)
+{
+	struct xr_visibility_mask *self = &xr->mask;
+	if (!self->program)
+		return false;
+	if (self->dirty)
+		xrmask_build(xr);
+	if (!self->index_count)
+		return false;
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, xr->views[view].width, xr->views[view].height);
+	/* the pass drawn next keeps these instead of clearing them */
+	glDisable(GL_SCISSOR_TEST);
+	glDepthMask(GL_TRUE);
+	glStencilMask(0xFF);
+	glClearDepth(1.0);
+	glClearStencil(0);
+	glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_ALWAYS);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(GL_ALWAYS, 1, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	glDisable(GL_CULL_FACE);
+
+	glUseProgram(self->program);
+	glBindVertexArray(self->vao);
+	glUniformMatrix4fv(self->projection_loc, 1, GL_FALSE,
+	                   (const GLfloat*)&projections[view]);
+	glDrawElements(GL_TRIANGLES, self->count[view], GL_UNSIGNED_INT,
+	               (void*)(sizeof(uint32_t) * self->first[view]));
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	glDisable(GL_STENCIL_TEST);
+	glDepthFunc(GL_LESS);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	return true;
+}
@@ -0,0 +1,682 @@
+#include "openxr.h"
+
+#include "../candle/utils/mesh.h"
+
+#include "internals.h"
+#include <string.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* Binary cache of the controller OBJs. The first load parses the text and
+ * writes an .xrmesh entry to the user's cache directory: a header followed by interleaved,
+ * deduplicated vertices and a triangle index list. Later loads map the file
+ * and hand it to candle without parsing. Entries are keyed by the FNV-1a
+ * hash of the source, which is only recomputed when its size or
+ * modification time changed. */
+
+#define XRMESH_MAGIC 0x534d5258 /* "XRMS" */
+#define XRMESH_VERSION 1
+
+struct xrmesh_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t source_hash;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint32_t vertex_count;
+	uint32_t index_count;
+};
+
+/* XRMESH_VERTEX_FLOATS floats */
+struct xrmesh_vertex
+{
+	float pos[3];
+	float normal[3];
+	float uv[2];
+};
+
+struct xrmesh_map
+{
+	void *data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+/* FNV-1a, the source key of the asset caches */
+uint64_t xr_hash(const uint8_t *data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static bool_t xrmesh_map(struct xrmesh_map *self, const char *path)
+{
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	self->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+	                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (self->file == INVALID_HANDLE_VALUE)
+		return false;
+	if (!GetFileSizeEx(self->file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(self->file);
+		return false;
+	}
+	self->size = (size_t)size.QuadPart;
+	self->mapping = CreateFileMappingA(self->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	self->data = self->mapping ? MapViewOfFile(self->mapping, FILE_MAP_READ, 0, 0, 0)
+	                           : NULL;
+	if (!self->data)
+	{
+		if (self->mapping) CloseHandle(self->mapping);
+		CloseHandle(self->file);
+		return false;
+	}
+	return true;
+#else
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	self->size = (size_t)st.st_size;
+	self->data = mmap(NULL, self->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (self->data == MAP_FAILED)
+	{
+		self->data = NULL;
+		return false;
+	}
+	return true;
+#endif
+}
+
+static void xrmesh_unmap(struct xrmesh_map *self)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(self->data);
+	CloseHandle(self->mapping);
+	CloseHandle(self->file);
+#else
+	munmap(self->data, self->size);
+#endif
+	self->data = NULL;
+}
+
+/* ------------------------------------------------------------------------ */
+/* OBJ conversion */
+
+struct xrmesh_builder
+{
+	float *positions;
+	float *normals;
+	float *uvs;
+	uint32_t position_count;
+	uint32_t normal_count;
+	uint32_t uv_count;
+	uint32_t position_capacity;
+	uint32_t normal_capacity;
+	uint32_t uv_capacity;
+
+	struct xrmesh_vertex *vertices;
+	uint32_t vertex_count;
+	uint32_t vertex_capacity;
+	uint32_t *indices;
+	uint32_t index_count;
+	uint32_t index_capacity;
+
+	/* open addressing table from position/uv/normal triplets to vertices */
+	uint32_t *keys;
+	uint32_t *slots;
+	uint32_t table_size;
+};
+
+static void *xrmesh_reserve(void *array, uint32_t *capacity, uint32_t count,
+                            size_t element)
+{
+	if (count < *capacity)
+		return array;
+	*capacity = *capacity ? *capacity * 2 : 1024;
+	return realloc(array, element * *capacity);
+}
+
+static void xrmesh_push(float **array, uint32_t *count, uint32_t *capacity,
+                        const float *values, uint32_t n)
+{
+	*array = xrmesh_reserve(*array, capacity, *count * n + n, sizeof(float));
+	memcpy(&(*array)[*count * n], values, sizeof(float) * n);
+	(*count)++;
+}
+
+static uint32_t xrmesh_triplet_hash(const uint32_t *key)
+{
+	return (key[0] * 73856093u) ^ (key[1] * 19349663u) ^ (key[2] * 83492791u);
+}
+
+static void xrmesh_rehash(struct xrmesh_builder *self)
+{
+	const uint32_t size = self->table_size ? self->table_size * 2 : 4096;
+	uint32_t *slots = malloc(sizeof(*slots) * size);
+	memset(slots, 0xff, sizeof(*slots) * size);
+	for (uint32_t v = 0; v < self->vertex_count; v++)
+	{
+		uint32_t h = xrmesh_triplet_hash(&self->keys[v * 3]) & (size - 1);
+		while (slots[h] != ~0u)
+			h = (h + 1) & (size - 1);
+		slots[h] = v;
+	}
+	free(self->slots);
+	self->slots = slots;
+	self->table_size = size;
+}
+
+static uint32_t xrmesh_vertex(struct xrmesh_builder *self, const uint32_t *key)
+{
+	if (self->vertex_count * 2 >= self->table_size)
+		xrmesh_rehash(self);
+
+	uint32_t h = xrmesh_triplet_hash(key) & (self->table_size - 1);
+	while (self->slots[h] != ~0u)
+	{
+		const uint32_t v = self->slots[h];
+		if (!memcmp(&self->keys[v * 3], key, sizeof(*key) * 3))
+			return v;
+		h = (h + 1) & (self->table_size - 1);
+	}
+
+	const uint32_t capacity = self->vertex_capacity;
+	self->vertices = xrmesh_reserve(self->vertices, &self->vertex_capacity,
+	                                self->vertex_count, sizeof(*self->vertices));
+	if (capacity != self->vertex_capacity)
+		self->keys = realloc(self->keys, sizeof(*self->keys) * 3 * self->vertex_capacity);
+
+	const uint32_t v = self->vertex_count++;
+	struct xrmesh_vertex *vertex = &self->vertices[v];
+	memset(vertex, 0, sizeof(*vertex));
+	if (key[0] < self->position_count)
+		memcpy(vertex->pos, &self->positions[key[0] * 3], sizeof(vertex->pos));
+	if (key[1] < self->uv_count)
+		memcpy(vertex->uv, &self->uvs[key[1] * 2], sizeof(vertex->uv));
+	if (key[2] < self->normal_count)
+		memcpy(vertex->normal, &self->normals[key[2] * 3], sizeof(vertex->normal));
+	memcpy(&self->keys[v * 3], key, sizeof(*key) * 3);
+	self->slots[h] = v;
+	return v;
+}
+
+/* OBJ indices are 1 based and negative ones count back from the end,
+ * missing ones map to ~0 */
+static uint32_t xrmesh_index(long index, uint32_t count)
+{
+	if (index > 0) return (uint32_t)(index - 1);
+	if (index < 0) return (uint32_t)((long)count + index);
+	return ~0u;
+}
+
+static const char *xrmesh_corner(struct xrmesh_builder *self, const char *c,
+                                 uint32_t *key)
+{
+	char *end;
+	key[0] = xrmesh_index(strtol(c, &end, 10), self->position_count);
+	key[1] = key[2] = ~0u;
+	c = end;
+	if (*c == '/')
+	{
+		c++;
+		if (*c != '/')
+		{
+			key[1] = xrmesh_index(strtol(c, &end, 10), self->uv_count);
+			c = end;
+		}
+		if (*c == '/')
+		{
+			key[2] = xrmesh_index(strtol(c + 1, &end, 10), self->normal_count);
+			c = end;
+		}
+	}
+	return c;
+}
+
+static void xrmesh_face(struct xrmesh_builder *self, const char *c)
+{
+	uint32_t first = ~0u, previous = ~0u;
+	while (true)
+	{
+		uint32_t key[3];
+		while (*c == ' ' || *c == '\t') c++;
+		if (!(*c == '-' || (*c >= '0' && *c <= '9')))
+			break;
+		c = xrmesh_corner(self, c, key);
+		const uint32_t v = xrmesh_vertex(self, key);
+		/* polygons are fanned out from their first corner */
+		if (first == ~0u)
+		{
+			first = v;
+		}
+		else if (previous != ~0u)
+		{
+			self->indices = xrmesh_reserve(self->indices, &self->index_capacity,
+			                               self->index_count + 3,
+			                               sizeof(*self->indices));
+			self->indices[self->index_count++] = first;
+			self->indices[self->index_count++] = previous;
+			self->indices[self->index_count++] = v;
+		}
+		if (first != v)
+			previous = v;
+	}
+}
+
+static void xrmesh_floats(const char *c, float *out, uint32_t n)
+{
+	char *end;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		out[i] = strtof(c, &end);
+		c = end;
+	}
+}
+
+static void xrmesh_parse(struct xrmesh_builder *self, const char *text,
+                         size_t size)
+{
+	const char *c = text;
+	const char *end = text + size;
+	while (c < end)
+	{
+		const char *line = c;
+		float values[3];
+		while (c < end && *c != '\n') c++;
+		c++;
+		if (c - line < 3)
+			continue;
+
+		if (line[0] == 'v' && line[1] == ' ')
+		{
+			xrmesh_floats(line + 2, values, 3);
+			xrmesh_push(&self->positions, &self->position_count,
+			            &self->position_capacity, values, 3);
+		}
+		else if (line[0] == 'v' && line[1] == 'n')
+		{
+			xrmesh_floats(line + 2, values, 3);
+			xrmesh_push(&self->normals, &self->normal_count,
+			            &self->normal_capacity, values, 3);
+		}
+		else if (line[0] == 'v' && line[1] == 't')
+		{
+			xrmesh_floats(line + 2, values, 2);
+			xrmesh_push(&self->uvs, &self->uv_count, &self->uv_capacity,
+			            values, 2);
+		}
+		else if (line[0] == 'f' && line[1] == ' ')
+		{
+			xrmesh_face(self, line + 2);
+		}
+	}
+}
+
+static void xrmesh_builder_free(struct xrmesh_builder *self)
+{
+	free(self->positions);
+	free(self->normals);
+	free(self->uvs);
+	free(self->vertices);
+	free(self->indices);
+	free(self->keys);
+	free(self->slots);
+}
+
+static bool_t xrmesh_write(const char *path, const struct xrmesh_header *header,
+                           const struct xrmesh_builder *builder)
+{
+	FILE *fp = fopen(path, "wb");
+	bool_t written;
+	if (!fp)
+		return false;
+	written = fwrite(header, sizeof(*header), 1, fp) == 1
+	       && fwrite(builder->vertices, sizeof(*builder->vertices),
+	                 builder->vertex_count, fp) == builder->vertex_count
+	       && fwrite(builder->indices, sizeof(*builder->indices),
+	                 builder->index_count, fp) == builder->index_count;
+	fclose(fp);
+	if (!written)
+		remove(path);
+	return written;
+}
+
+/* ------------------------------------------------------------------------ */
+/* loading */
+
+static mesh_t *xrmesh_build(const struct xrmesh_vertex *vertices,
+                            uint32_t vertex_count,
+                            const uint32_t *indices, uint32_t index_count)
+{
+	mesh_t *mesh = mesh_new();
+	mesh_lock(mesh);
+	for (uint32_t v = 0; v < vertex_count; v++)
+	{
+		const float *p = vertices[v].pos;
+		mesh_add_vert(mesh, VEC3(p[0], p[1], p[2]));
+	}
+	for (uint32_t i = 0; i + 2 < index_count; i += 3)
+	{
+		const struct xrmesh_vertex *a = &vertices[indices[i + 0]];
+		const struct xrmesh_vertex *b = &vertices[indices[i + 1]];
+		const struct xrmesh_vertex *c = &vertices[indices[i + 2]];
+		mesh_add_triangle(mesh,
+			indices[i + 0], vec3(a->normal[0], a->normal[1], a->normal[2]),
+			vec2(a->uv[0], a->uv[1]),
+			indices[i + 1], vec3(b->normal[0], b->normal[1], b->normal[2]),
+			vec2(b->uv[0], b->uv[1]),
+			indices[i + 2], vec3(c->normal[0], c->normal[1], c->normal[2]),
+			vec2(c->uv[0], c->uv[1]));
+	}
+	mesh_unlock(mesh);
+	return mesh;
+}
+
+/* Checks the layout of a mapped entry and that every index points at one of
+ * its vertices, a truncated or corrupted entry is rebuilt rather than handed
+ * to candle. */
+static bool_t xrmesh_valid(const struct xrmesh_map *map)
+{
+	const struct xrmesh_header *header = map->data;
+	if (map->size < sizeof(*header)
+	    || header->magic != XRMESH_MAGIC
+	    || header->version != XRMESH_VERSION
+	    || header->index_count % 3)
+		return false;
+	if (map->size != sizeof(*header)
+	    + sizeof(struct xrmesh_vertex) * (size_t)header->vertex_count
+	    + sizeof(uint32_t) * (size_t)header->index_count)
+		return false;
+
+	const uint32_t *indices = (const uint32_t*)((const char*)map->data
+		+ sizeof(*header) + sizeof(struct xrmesh_vertex) * (size_t)header->vertex_count);
+	for (uint32_t i = 0; i < header->index_count; i++)
+		if (indices[i] >= header->vertex_count)
+			return false;
+	return true;
+}
+
+/* Rewrites the source stamp of a cache entry whose content was found to be
+ * up to date, so the next load skips hashing again. */
+static void xrmesh_restamp(const char *path, const struct xrmesh_header *header)
+{
+	FILE *fp = fopen(path, "r+b");
+	if (!fp)
+		return;
+	fwrite(header, sizeof(*header), 1, fp);
+	fclose(fp);
+}
+
+/* Keeps whichever of the mapping or the freshly built arrays the data of an
+ * opened mesh points into. */
+struct xrmesh_handle
+{
+	struct xrmesh_map map;
+	struct xrmesh_builder builder;
+	struct xrmesh_header header;
+};
+
+/* ------------------------------------------------------------------------ */
+/* decimation */
+
+/* Vertex clustering: vertices sharing a cell of a grid over the bounding box
+ * collapse into the first of them, which keeps its attributes, triangles
+ * that lose a corner are dropped. The grid is refined down until the
+ * triangle count fits the target. Crude, but robust on any input and good
+ * enough for far away and shadow levels. */
+static void xrmesh_cluster(const struct xrmesh_data *src, uint32_t grid,
+                           const float *min, float extent,
+                           struct xrmesh_builder *out, uint32_t *remap,
+                           uint32_t *cells, uint32_t table_size)
+{
+	const struct xrmesh_vertex *vertices = (const struct xrmesh_vertex*)src->vertices;
+	out->vertex_count = 0;
+	out->index_count = 0;
+	memset(cells, 0xff, sizeof(*cells) * table_size * 2);
+
+	for (uint32_t v = 0; v < src->vertex_count; v++)
+	{
+		uint32_t c[3];
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			float f = (vertices[v].pos[i] - min[i]) / extent * (float)grid;
+			c[i] = f < 0.0f ? 0 : (uint32_t)f >= grid ? grid - 1 : (uint32_t)f;
+		}
+		const uint32_t key = c[0] + grid * (c[1] + grid * c[2]);
+		uint32_t h = xrmesh_triplet_hash(c) & (table_size - 1);
+		while (cells[h * 2] != ~0u && cells[h * 2] != key)
+			h = (h + 1) & (table_size - 1);
+		if (cells[h * 2] == ~0u)
+		{
+			out->vertices = xrmesh_reserve(out->vertices, &out->vertex_capacity,
+			                               out->vertex_count,
+			                               sizeof(*out->vertices));
+			out->vertices[out->vertex_count] = vertices[v];
+			cells[h * 2] = key;
+			cells[h * 2 + 1] = out->vertex_count++;
+		}
+		remap[v] = cells[h * 2 + 1];
+	}
+
+	for (uint32_t i = 0; i + 2 < src->index_count; i += 3)
+	{
+		const uint32_t a = remap[src->indices[i + 0]];
+		const uint32_t b = remap[src->indices[i + 1]];
+		const uint32_t c = remap[src->indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+		out->indices = xrmesh_reserve(out->indices, &out->index_capacity,
+		                              out->index_count + 3, sizeof(*out->indices));
+		out->indices[out->index_count++] = a;
+		out->indices[out->index_count++] = b;
+		out->indices[out->index_count++] = c;
+	}
+}
+
+static void xrmesh_decimate(const struct xrmesh_data *src, uint32_t target,
+                            struct xrmesh_builder *out)
+{
+	const struct xrmesh_vertex *vertices = (const struct xrmesh_vertex*)src->vertices;
+	float min[3] = {0.0f, 0.0f, 0.0f};
+	float max[3] = {0.0f, 0.0f, 0.0f};
+	float extent = 0.0f;
+	uint32_t table_size = 1;
+
+	for (uint32_t v = 0; v < src->vertex_count; v++)
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const float p = vertices[v].pos[i];
+			if (v == 0 || p < min[i]) min[i] = p;
+			if (v == 0 || p > max[i]) max[i] = p;
+		}
+	}
+	for (uint32_t i = 0; i < 3; i++)
+		if (max[i] - min[i] > extent) extent = max[i] - min[i];
+	if (extent <= 0.0f)
+		extent = 1.0f;
+	while (table_size < src->vertex_count * 2)
+		table_size *= 2;
+
+	uint32_t *remap = malloc(sizeof(*remap) * src->vertex_count);
+	uint32_t *cells = malloc(sizeof(*cells) * table_size * 2);
+	for (uint32_t grid = 128; ; grid = grid * 4 / 5)
+	{
+		xrmesh_cluster(src, grid, min, extent, out, remap, cells, table_size);
+		if (out->index_count / 3 <= target || grid <= 4)
+			break;
+	}
+	free(remap);
+	free(cells);
+}
+
+/* ------------------------------------------------------------------------ */
+/* loading */
+
+static bool_t xrmesh_open_text(const char *path, const struct stat *st,
+                               struct xrmesh_handle *handle)
+{
+	/* read rather than mapped, the parser relies on the text being
+	 * terminated */
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	char *text = malloc((size_t)st->st_size + 1);
+	const size_t size = fread(text, 1, (size_t)st->st_size, fp);
+	fclose(fp);
+	text[size] = '\0';
+
+	xrmesh_parse(&handle->builder, text, size);
+	handle->header.source_hash = xr_hash((const uint8_t*)text, size);
+	handle->header.source_size = size;
+	free(text);
+	return true;
+}
+
+/* Opens level 0, the OBJ at path itself, or one of its decimated levels
+ * with about a quarter of the triangles of the previous one, through their
+ * binary cache entries. Missing or stale entries are built and written on
+ * first use. Returns false when the source can't be read. */
+bool_t xrmesh_open_level(const char *path, uint32_t level,
+                         struct xrmesh_data *data)
+{
+	char cache_path[512];
+	struct xrmesh_map source = {0};
+	struct xrmesh_handle *handle;
+	struct stat st;
+
+	if (stat(path, &st))
+		return false;
+	char suffix[32];
+	if (level)
+		snprintf(suffix, sizeof(suffix), ".lod%u.xrmesh", level);
+	else
+		snprintf(suffix, sizeof(suffix), ".xrmesh");
+	const bool_t cacheable = xr_cache_entry(path, suffix, cache_path,
+	                                        sizeof(cache_path));
+
+	handle = calloc(1, sizeof(*handle));
+	if (cacheable && xrmesh_map(&handle->map, cache_path))
+	{
+		bool_t fresh = false;
+		if (xrmesh_valid(&handle->map))
+		{
+			struct xrmesh_header header = *(struct xrmesh_header*)handle->map.data;
+			fresh = header.source_size == (uint64_t)st.st_size
+			     && header.source_mtime == (int64_t)st.st_mtime;
+			if (!fresh && header.source_size == (uint64_t)st.st_size
+			    && xrmesh_map(&source, path))
+			{
+				fresh = xr_hash(source.data, source.size) == header.source_hash;
+				xrmesh_unmap(&source);
+				if (fresh)
+				{
+					header.source_mtime = (int64_t)st.st_mtime;
+					xrmesh_restamp(cache_path, &header);
+				}
+			}
+			if (fresh)
+			{
+				const struct xrmesh_vertex *vertices = (const struct xrmesh_vertex*)
+					((char*)handle->map.data + sizeof(header));
+				handle->header = header;
+				data->vertices = (const float*)vertices;
+				data->vertex_count = header.vertex_count;
+				data->indices = (const uint32_t*)(vertices + header.vertex_count);
+				data->index_count = header.index_count;
+				data->handle = handle;
+				return true;
+			}
+		}
+		xrmesh_unmap(&handle->map);
+	}
+
+	struct xrmesh_builder *builder = &handle->builder;
+	if (level)
+	{
+		struct xrmesh_data finer;
+		if (!xrmesh_open_level(path, level - 1, &finer))
+		{
+			free(handle);
+			return false;
+		}
+		xrmesh_decimate(&finer, finer.index_count / 12, builder);
+		handle->header = ((struct xrmesh_handle*)finer.handle)->header;
+		xrmesh_close(&finer);
+	}
+	else if (!xrmesh_open_text(path, &st, handle))
+	{
+		free(handle);
+		return false;
+	}
+
+	handle->header.magic = XRMESH_MAGIC;
+	handle->header.version = XRMESH_VERSION;
+	handle->header.source_mtime = (int64_t)st.st_mtime;
+	handle->header.vertex_count = builder->vertex_count;
+	handle->header.index_count = builder->index_count;
+
+	/* an unwritable cache only costs the conversion each run */
+	if (cacheable && !xrmesh_write(cache_path, &handle->header, builder))
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "could not write mesh cache %s", cache_path);
+
+	data->vertices = (const float*)builder->vertices;
+	data->vertex_count = builder->vertex_count;
+	data->indices = builder->indices;
+	data->index_count = builder->index_count;
+	data->handle = handle;
+	return true;
+}
+
+bool_t xrmesh_open(const char *path, struct xrmesh_data *data)
+{
+	return xrmesh_open_level(path, 0, data);
+}
+
+void xrmesh_close(struct xrmesh_data *data)
+{
+	struct xrmesh_handle *handle = data->handle;
+	if (handle->map.data)
+		xrmesh_unmap(&handle->map);
+	xrmesh_builder_free(&handle->builder);
+	free(handle);
+	data->handle = NULL;
+}
+
+mesh_t *xrmesh_load_level(const char *path, uint32_t level)
+{
+	struct xrmesh_data data;
+	if (!xrmesh_open_level(path, level, &data))
+		return NULL;
+	mesh_t *mesh = xrmesh_build((const struct xrmesh_vertex*)data.vertices,
+	                            data.vertex_count, data.indices, data.index_count);
+	xrmesh_close(&data);
+	return mesh;
+}
+
+mesh_t *xrmesh_load(const char *path)
+{
+	return xrmesh_load_level(path, 0);
+}
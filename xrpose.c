@@ -0,0 +1,190 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <string.h>
+
+/* Batched pose to matrix kernel. Poses are converted a vector of lanes at a
+ * time, each lane holding a different pose, so the cost per pose is the
+ * same for two hands as for a full body. Fixed offsets are folded into one
+ * matrix per pose instead of being rebuilt from angles. */
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define XRPOSE_LANES 8
+typedef __m256 xrpose_v;
+#define xrpose_load(p)     _mm256_loadu_ps(p)
+#define xrpose_store(p, v) _mm256_storeu_ps(p, v)
+#define xrpose_set1(f)     _mm256_set1_ps(f)
+#define xrpose_add(a, b)   _mm256_add_ps(a, b)
+#define xrpose_sub(a, b)   _mm256_sub_ps(a, b)
+#define xrpose_mul(a, b)   _mm256_mul_ps(a, b)
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define XRPOSE_LANES 4
+typedef __m128 xrpose_v;
+#define xrpose_load(p)     _mm_loadu_ps(p)
+#define xrpose_store(p, v) _mm_storeu_ps(p, v)
+#define xrpose_set1(f)     _mm_set1_ps(f)
+#define xrpose_add(a, b)   _mm_add_ps(a, b)
+#define xrpose_sub(a, b)   _mm_sub_ps(a, b)
+#define xrpose_mul(a, b)   _mm_mul_ps(a, b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define XRPOSE_LANES 4
+typedef float32x4_t xrpose_v;
+#define xrpose_load(p)     vld1q_f32(p)
+#define xrpose_store(p, v) vst1q_f32(p, v)
+#define xrpose_set1(f)     vdupq_n_f32(f)
+#define xrpose_add(a, b)   vaddq_f32(a, b)
+#define xrpose_sub(a, b)   vsubq_f32(a, b)
+#define xrpose_mul(a, b)   vmulq_f32(a, b)
+#else
+#define XRPOSE_LANES 1
+typedef float xrpose_v;
+#define xrpose_load(p)     (*(p))
+#define xrpose_store(p, v) (*(p) = (v))
+#define xrpose_set1(f)     (f)
+#define xrpose_add(a, b)   ((a) + (b))
+#define xrpose_sub(a, b)   ((a) - (b))
+#define xrpose_mul(a, b)   ((a) * (b))
+#endif
+
+#define xrpose_madd(a, b, c) xrpose_add(xrpose_mul(a, b), c)
+
+/* inputs of a batch, one row per component and one column per lane */
+enum
+{
+	XRPOSE_QX, XRPOSE_QY, XRPOSE_QZ, XRPOSE_QW,
+	XRPOSE_PX, XRPOSE_PY, XRPOSE_PZ,
+	/* upper three rows of each column of the fixed offset */
+	XRPOSE_OFFSET,
+	XRPOSE_INPUTS = XRPOSE_OFFSET + 12
+};
+
+/* Rigid transform of the grip, rotated by -rot degrees around X, Y then Z
+ * and moved by -origin, as the controller meshes are modeled. */
+mat4_t xrpose_offset(vec3_t rot, vec3_t origin)
+{
+	mat4_t offset = mat4();
+	offset = mat4_rotate_X(offset, -rot.x * (M_PI / 180.0f));
+	offset = mat4_rotate_Y(offset, -rot.y * (M_PI / 180.0f));
+	offset = mat4_rotate_Z(offset, -rot.z * (M_PI / 180.0f));
+	return mat4_mul(offset, mat4_translate(vec3_inv(origin)));
+}
+
+static void xrpose_gather(float in[XRPOSE_INPUTS][XRPOSE_LANES], uint32_t lane,
+                          const XrPosef *pose, const mat4_t *offset)
+{
+	in[XRPOSE_QX][lane] = pose->orientation.x;
+	in[XRPOSE_QY][lane] = pose->orientation.y;
+	in[XRPOSE_QZ][lane] = pose->orientation.z;
+	in[XRPOSE_QW][lane] = pose->orientation.w;
+	in[XRPOSE_PX][lane] = pose->position.x;
+	in[XRPOSE_PY][lane] = pose->position.y;
+	in[XRPOSE_PZ][lane] = pose->position.z;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		for (uint32_t r = 0; r < 3; r++)
+			in[XRPOSE_OFFSET + c * 3 + r][lane] = offset ? offset->_[c][r]
+			                                    : (float)(c == r);
+	}
+}
+
+/* Matrices of count poses, stride bytes apart, as translate(position) *
+ * rotation(orientation) * offset, without an offset when it is NULL. When
+ * worlds is set, origin * model is also written there. */
+void xrpose_models(const XrPosef *poses, size_t stride, uint32_t count,
+                   const mat4_t *offset, const mat4_t *origin,
+                   mat4_t *models, mat4_t *worlds)
+{
+	float in[XRPOSE_INPUTS][XRPOSE_LANES];
+	float out[16][XRPOSE_LANES];
+	float world[16][XRPOSE_LANES];
+	const xrpose_v zero = xrpose_set1(0.0f);
+	const xrpose_v one = xrpose_set1(1.0f);
+
+	for (uint32_t base = 0; base < count; base += XRPOSE_LANES)
+	{
+		const uint32_t lanes = count - base < XRPOSE_LANES ? count - base : XRPOSE_LANES;
+		/* unused lanes compute garbage that is never stored */
+		memset(in, 0, sizeof(in));
+		for (uint32_t l = 0; l < lanes; l++)
+		{
+			const uint32_t i = base + l;
+			const XrPosef *pose = (const XrPosef*)((const char*)poses + stride * i);
+			xrpose_gather(in, l, pose, offset);
+		}
+
+		const xrpose_v x = xrpose_load(in[XRPOSE_QX]);
+		const xrpose_v y = xrpose_load(in[XRPOSE_QY]);
+		const xrpose_v z = xrpose_load(in[XRPOSE_QZ]);
+		const xrpose_v w = xrpose_load(in[XRPOSE_QW]);
+		const xrpose_v x2 = xrpose_add(x, x);
+		const xrpose_v y2 = xrpose_add(y, y);
+		const xrpose_v z2 = xrpose_add(z, z);
+		const xrpose_v xx = xrpose_mul(x, x2);
+		const xrpose_v yy = xrpose_mul(y, y2);
+		const xrpose_v zz = xrpose_mul(z, z2);
+		const xrpose_v xy = xrpose_mul(x, y2);
+		const xrpose_v xz = xrpose_mul(x, z2);
+		const xrpose_v yz = xrpose_mul(y, z2);
+		const xrpose_v wx = xrpose_mul(w, x2);
+		const xrpose_v wy = xrpose_mul(w, y2);
+		const xrpose_v wz = xrpose_mul(w, z2);
+
+		/* rotation of the unit quaternion, rot[column][row] */
+		const xrpose_v rot[3][3] = {
+			{xrpose_sub(one, xrpose_add(yy, zz)), xrpose_add(xy, wz), xrpose_sub(xz, wy)},
+			{xrpose_sub(xy, wz), xrpose_sub(one, xrpose_add(xx, zz)), xrpose_add(yz, wx)},
+			{xrpose_add(xz, wy), xrpose_sub(yz, wx), xrpose_sub(one, xrpose_add(xx, yy))}
+		};
+		const xrpose_v position[3] = {
+			xrpose_load(in[XRPOSE_PX]),
+			xrpose_load(in[XRPOSE_PY]),
+			xrpose_load(in[XRPOSE_PZ])
+		};
+
+		xrpose_v model[4][4];
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			const xrpose_v g0 = xrpose_load(in[XRPOSE_OFFSET + c * 3 + 0]);
+			const xrpose_v g1 = xrpose_load(in[XRPOSE_OFFSET + c * 3 + 1]);
+			const xrpose_v g2 = xrpose_load(in[XRPOSE_OFFSET + c * 3 + 2]);
+			for (uint32_t r = 0; r < 3; r++)
+			{
+				xrpose_v v = xrpose_mul(rot[0][r], g0);
+				v = xrpose_madd(rot[1][r], g1, v);
+				v = xrpose_madd(rot[2][r], g2, v);
+				model[c][r] = c == 3 ? xrpose_add(v, position[r]) : v;
+			}
+			model[c][3] = c == 3 ? one : zero;
+			for (uint32_t r = 0; r < 4; r++)
+				xrpose_store(out[c * 4 + r], model[c][r]);
+		}
+
+		if (worlds)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				for (uint32_t r = 0; r < 4; r++)
+				{
+					xrpose_v v = xrpose_mul(xrpose_set1(origin->_[0][r]), model[c][0]);
+					v = xrpose_madd(xrpose_set1(origin->_[1][r]), model[c][1], v);
+					v = xrpose_madd(xrpose_set1(origin->_[2][r]), model[c][2], v);
+					v = xrpose_madd(xrpose_set1(origin->_[3][r]), model[c][3], v);
+					xrpose_store(world[c * 4 + r], v);
+				}
+			}
+		}
+
+		for (uint32_t l = 0; l < lanes; l++)
+		{
+			for (uint32_t e = 0; e < 16; e++)
+			{
+				models[base + l]._[e / 4][e % 4] = out[e][l];
+				if (worlds)
+					worlds[base + l]._[e / 4][e % 4] = world[e][l];
+			}
+		}
+	}
+}
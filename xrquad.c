@@ -0,0 +1,232 @@
+#include "openxr.h"
+
+#include "internals.h"
+
+/* UI panels submitted as XrCompositionLayerQuad. The compositor samples
+ * them at their own resolution, so text stays sharp and static panels cost
+ * nothing but their composition once drawn. */
+
+static bool_t xrquad_create(struct openxr_internal *xr, struct xr_quad *self)
+{
+	XrResult result;
+	XrSwapchainCreateInfo swapchainCreateInfo = {
+		.type = XR_TYPE_SWAPCHAIN_CREATE_INFO,
+		.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT
+		            | XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT,
+		.createFlags = 0,
+		.format = xr->swapchain_format,
+		.sampleCount = 1,
+		.width = self->width,
+		.height = self->height,
+		.faceCount = 1,
+		.arraySize = 1,
+		.mipCount = 1,
+		.next = NULL,
+	};
+	result = xrCreateSwapchain(xr->session, &swapchainCreateInfo, &self->swapchain);
+	if (!xr_result(xr->instance, result, "failed to create quad swapchain!"))
+		return false;
+
+	result = xrEnumerateSwapchainImages(self->swapchain, 0, &self->image_count,
+	                                    NULL);
+	if (!xr_result(xr->instance, result, "failed to enumerate quad swapchain"))
+		goto fail;
+
+	self->images = malloc(sizeof(*self->images) * self->image_count);
+	for (uint32_t i = 0; i < self->image_count; i++)
+	{
+		self->images[i].type = XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_KHR;
+		self->images[i].next = NULL;
+	}
+	result = xrEnumerateSwapchainImages(self->swapchain, self->image_count,
+	        &self->image_count, (XrSwapchainImageBaseHeader*)self->images);
+	if (!xr_result(xr->instance, result, "failed to enumerate quad swapchain images"))
+		goto fail;
+
+	self->framebuffers = malloc(sizeof(*self->framebuffers) * self->image_count);
+	glGenFramebuffers(self->image_count, self->framebuffers);
+	for (uint32_t i = 0; i < self->image_count; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, self->framebuffers[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, self->images[i].image, 0);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return true;
+
+fail:
+	free(self->images);
+	self->images = NULL;
+	xrDestroySwapchain(self->swapchain);
+	self->swapchain = XR_NULL_HANDLE;
+	return false;
+}
+
+static void xrquad_render(struct openxr_internal *xr, struct xr_quad *self)
+{
+	XrResult result;
+	renderer_t *renderer = self->renderer;
+	bool_t drawn = false;
+	uint32_t index;
+
+	XrSwapchainImageAcquireInfo acquireInfo = {
+		.type = XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO, .next = NULL};
+	result = xrAcquireSwapchainImage(self->swapchain, &acquireInfo, &index);
+	if (!xr_result(xr->instance, result, "failed to acquire quad image!"))
+		return;
+
+	XrSwapchainImageWaitInfo waitInfo = {
+		.type = XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO,
+		.next = NULL,
+		.timeout = XR_INFINITE_DURATION};
+	result = xrWaitSwapchainImage(self->swapchain, &waitInfo);
+	if (xr_result(xr->instance, result, "failed to wait for quad image!"))
+	{
+		if (renderer->width != self->width || renderer->height != self->height)
+			renderer_resize(renderer, self->width, self->height);
+		renderer_draw(renderer);
+
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, self->framebuffers[index]);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->output->frame_buffer[0]);
+		glBlitFramebuffer(0, 0, self->width, self->height,
+		                  0, 0, self->width, self->height,
+		                  GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glFlush();
+		drawn = true;
+	}
+
+	XrSwapchainImageReleaseInfo releaseInfo = {
+		.type = XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO, .next = NULL};
+	result = xrReleaseSwapchainImage(self->swapchain, &releaseInfo);
+	if (xr_result(xr->instance, result, "failed to release quad image!") && drawn)
+	{
+		self->dirty = false;
+		self->ready = true;
+	}
+}
+
+/* Draws the visible quads whose content changed since their last image. */
+void xrquad_draw(struct openxr_internal *xr)
+{
+	for (uint32_t i = 0; i < XR_MAX_QUADS; i++)
+	{
+		struct xr_quad *self = &xr->quads[i];
+		if (!self->used || !self->visible || !self->dirty || !self->renderer)
+			continue;
+		if (!self->swapchain && !xrquad_create(xr, self))
+		{
+			/* don't retry every frame */
+			self->used = false;
+			continue;
+		}
+		xrquad_render(xr, self);
+	}
+}
+
+uint32_t xrquad_layers(struct openxr_internal *xr, XrCompositionLayerQuad *layers)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < XR_MAX_QUADS; i++)
+	{
+		const struct xr_quad *self = &xr->quads[i];
+		if (!self->used || !self->visible || !self->ready)
+			continue;
+		layers[count++] = (XrCompositionLayerQuad){
+			.type = XR_TYPE_COMPOSITION_LAYER_QUAD,
+			.next = NULL,
+			.layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT,
+			.space = xr->local_space,
+			.eyeVisibility = XR_EYE_VISIBILITY_BOTH,
+			.subImage = {
+				.swapchain = self->swapchain,
+				.imageRect = {
+					.offset = {0, 0},
+					.extent = {(int32_t)self->width, (int32_t)self->height}
+				},
+				.imageArrayIndex = 0
+			},
+			.pose = self->pose,
+			.size = self->size
+		};
+	}
+	return count;
+}
+
+void xrquad_destroy(struct openxr_internal *xr, uint32_t quad)
+{
+	struct xr_quad *self = &xr->quads[quad];
+	if (self->swapchain)
+	{
+		glDeleteFramebuffers(self->image_count, self->framebuffers);
+		xrDestroySwapchain(self->swapchain);
+	}
+	free(self->framebuffers);
+	free(self->images);
+	*self = (struct xr_quad){0};
+}
+
+static struct xr_quad *c_openxr_quad(c_openxr_t *self, uint32_t quad)
+{
+	if (quad >= XR_MAX_QUADS || !self->internal->quads[quad].used)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN, "invalid quad %u", quad);
+		return NULL;
+	}
+	return &self->internal->quads[quad];
+}
+
+uint32_t c_openxr_add_quad(c_openxr_t *self, renderer_t *renderer,
+                           uint32_t width, uint32_t height,
+                           float size_x, float size_y)
+{
+	for (uint32_t i = 0; i < XR_MAX_QUADS; i++)
+	{
+		struct xr_quad *quad = &self->internal->quads[i];
+		if (quad->used)
+			continue;
+		quad->used = true;
+		quad->visible = true;
+		quad->dirty = true;
+		quad->renderer = renderer;
+		quad->width = width;
+		quad->height = height;
+		quad->size = (XrExtent2Df){size_x, size_y};
+		quad->pose = (XrPosef){{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+		return i;
+	}
+	xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN, "too many quads, at most %d are supported",
+	       XR_MAX_QUADS);
+	return ~0u;
+}
+
+void c_openxr_quad_set_pose(c_openxr_t *self, uint32_t quad,
+                            vec3_t position, vec4_t orientation)
+{
+	struct xr_quad *q = c_openxr_quad(self, quad);
+	if (!q) return;
+	q->pose.position = (XrVector3f){position.x, position.y, position.z};
+	q->pose.orientation = (XrQuaternionf){orientation.x, orientation.y,
+	                                      orientation.z, orientation.w};
+}
+
+void c_openxr_quad_set_visible(c_openxr_t *self, uint32_t quad, bool_t visible)
+{
+	struct xr_quad *q = c_openxr_quad(self, quad);
+	if (!q) return;
+	q->visible = visible;
+}
+
+void c_openxr_quad_invalidate(c_openxr_t *self, uint32_t quad)
+{
+	struct xr_quad *q = c_openxr_quad(self, quad);
+	if (!q) return;
+	q->dirty = true;
+}
+
+void c_openxr_remove_quad(c_openxr_t *self, uint32_t quad)
+{
+	if (!c_openxr_quad(self, quad)) return;
+	xrquad_destroy(self->internal, quad);
+}
@@ -0,0 +1,227 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <math.h>
+
+/* fraction of the display period the GPU may use before scaling down */
+#define XR_GPU_BUDGET 0.9f
+/* scale up only if the GPU time stays below this fraction of the budget */
+#define XR_GPU_HEADROOM 0.75f
+#define XR_SCALE_STEP 0.05f
+
+static uint32_t xrres_extent(uint32_t recommended, float scale, uint32_t max)
+{
+	uint32_t extent = (uint32_t)(recommended * scale + 0.5f);
+	/* keep extents aligned to avoid odd sized targets */
+	extent = (extent + 7u) & ~7u;
+	if (extent > max) extent = max;
+	if (extent < 8) extent = 8;
+	return extent;
+}
+
+/* Keeps both scales no lower than one step, so the quantized scale never
+ * reaches 0, and in order. NaNs fall back to one step. The upper bound
+ * depends on the views and is applied by xrres_init. */
+void xrres_range(struct xr_resolution *self, float min_scale, float max_scale)
+{
+	if (!(min_scale >= XR_SCALE_STEP)) min_scale = XR_SCALE_STEP;
+	if (!(max_scale >= XR_SCALE_STEP)) max_scale = XR_SCALE_STEP;
+	if (min_scale > max_scale)
+	{
+		const float swap = min_scale;
+		min_scale = max_scale;
+		max_scale = swap;
+	}
+	self->min_scale = min_scale;
+	self->max_scale = max_scale;
+}
+
+/* Largest scale of the recommended size the runtime accepts for a view. */
+static float xrres_view_limit(const XrViewConfigurationView *config)
+{
+	float limit = 1.0f;
+	if (config->recommendedImageRectWidth && config->recommendedImageRectHeight)
+	{
+		const float x = (float)config->maxImageRectWidth
+		              / (float)config->recommendedImageRectWidth;
+		const float y = (float)config->maxImageRectHeight
+		              / (float)config->recommendedImageRectHeight;
+		limit = x < y ? x : y;
+	}
+	return limit > 1.0f ? limit : 1.0f;
+}
+
+void xrres_init(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	float limit = 0.0f;
+
+	for (uint32_t i = 0; i < xr->view_count; i++)
+	{
+		struct xr_view *view = &xr->views[i];
+		const XrViewConfigurationView *config = &xr->configuration_views[i];
+		const float view_limit = xrres_view_limit(config);
+		float max_scale = self->max_scale;
+		if (max_scale > view_limit) max_scale = view_limit;
+		if (view_limit > limit) limit = view_limit;
+
+		view->recommended_width = config->recommendedImageRectWidth;
+		view->recommended_height = config->recommendedImageRectHeight;
+		view->swapchain_width = xrres_extent(view->recommended_width, max_scale,
+		                                     config->maxImageRectWidth);
+		view->swapchain_height = xrres_extent(view->recommended_height, max_scale,
+		                                      config->maxImageRectHeight);
+		if (!self->enabled)
+		{
+			view->swapchain_width = view->recommended_width;
+			view->swapchain_height = view->recommended_height;
+		}
+		view->width = view->recommended_width < view->swapchain_width ?
+		              view->recommended_width : view->swapchain_width;
+		view->height = view->recommended_height < view->swapchain_height ?
+		               view->recommended_height : view->swapchain_height;
+	}
+	/* the controller does not step past what the largest view can use,
+	 * smaller views stop at their swapchain size */
+	self->scale = 1.0f;
+	if (!self->enabled)
+		return;
+	if (self->max_scale > limit) self->max_scale = limit;
+	if (self->min_scale > self->max_scale) self->min_scale = self->max_scale;
+	if (self->scale > self->max_scale) self->scale = self->max_scale;
+
+	glGenQueries(XR_TIMER_FRAMES * XR_MAX_VIEWS, &self->queries[0][0]);
+}
+
+static void xrres_apply(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	for (uint32_t i = 0; i < xr->view_count; i++)
+	{
+		struct xr_view *view = &xr->views[i];
+		view->width = xrres_extent(view->recommended_width, self->scale,
+		                           view->swapchain_width);
+		view->height = xrres_extent(view->recommended_height, self->scale,
+		                            view->swapchain_height);
+	}
+}
+
+/* Reads the GPU time of the oldest frame in the ring and steers the scale.
+ * Overshooting drops the resolution right away, recovering is only done
+ * after a sustained period of headroom to avoid oscillating. */
+static void xrres_control(struct openxr_internal *xr, uint64_t gpu_time)
+{
+	struct xr_resolution *self = &xr->resolution;
+	const float period = (float)xr->frame_state.predictedDisplayPeriod;
+	const float budget = period * XR_GPU_BUDGET;
+	float scale = self->scale;
+
+	self->gpu_time = gpu_time;
+	if (period <= 0.0f)
+		return;
+
+	if (gpu_time > budget)
+	{
+		self->under_budget = 0;
+		if (++self->over_budget >= 2)
+		{
+			/* pixel count scales with the square of the scale */
+			float factor = sqrtf(budget / (float)gpu_time);
+			if (factor < 0.8f) factor = 0.8f;
+			scale *= factor;
+			self->over_budget = 0;
+		}
+	}
+	else if (gpu_time < budget * XR_GPU_HEADROOM)
+	{
+		self->over_budget = 0;
+		if (++self->under_budget >= 30)
+		{
+			scale += XR_SCALE_STEP;
+			self->under_budget = 0;
+		}
+	}
+	else
+	{
+		self->over_budget = 0;
+		self->under_budget = 0;
+	}
+
+	/* quantized so that renderer targets are only resized on real steps */
+	scale = floorf(scale / XR_SCALE_STEP + 0.5f) * XR_SCALE_STEP;
+	if (scale < self->min_scale) scale = self->min_scale;
+	if (scale > self->max_scale) scale = self->max_scale;
+	if (scale != self->scale)
+	{
+		self->scale = scale;
+		xrres_apply(xr);
+	}
+}
+
+void xrres_update(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	if (!self->enabled)
+		return;
+
+	/* the oldest slot is reused by this frame, read it out first */
+	const uint32_t slot = self->frame % XR_TIMER_FRAMES;
+	const uint32_t count = self->query_count[slot];
+	const bool_t pending = self->pending[slot];
+	self->query_count[slot] = 0;
+	self->pending[slot] = false;
+	if (!pending)
+		return;
+
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		GLuint available = 0;
+		glGetQueryObjectuiv(self->queries[slot][i], GL_QUERY_RESULT_AVAILABLE,
+		                    &available);
+		/* drop the sample rather than stall the pipeline */
+		if (!available)
+			return;
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(self->queries[slot][i], GL_QUERY_RESULT, &elapsed);
+		total += elapsed;
+	}
+	xrres_control(xr, total);
+}
+
+void xrres_begin(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	const uint32_t slot = self->frame % XR_TIMER_FRAMES;
+	if (!self->enabled || self->query_count[slot] >= XR_MAX_VIEWS)
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, self->queries[slot][self->query_count[slot]]);
+}
+
+void xrres_end(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	const uint32_t slot = self->frame % XR_TIMER_FRAMES;
+	if (!self->enabled || self->query_count[slot] >= XR_MAX_VIEWS)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	self->query_count[slot]++;
+}
+
+void xrres_submit(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	if (!self->enabled)
+		return;
+	const uint32_t slot = self->frame % XR_TIMER_FRAMES;
+	self->pending[slot] = self->query_count[slot] > 0;
+	self->frame++;
+}
+
+void xrres_destroy(struct openxr_internal *xr)
+{
+	struct xr_resolution *self = &xr->resolution;
+	/* unused names are 0, which glDeleteQueries ignores */
+	glDeleteQueries(XR_TIMER_FRAMES * XR_MAX_VIEWS, &self->queries[0][0]);
+	self->enabled = false;
+}
@@ -0,0 +1,456 @@
+#include "openxr.h"
+
+#include "internals.h"
+#include <string.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+/* Frame telemetry. Every frame gets a record in a ring of XR_STATS_FRAMES
+ * with the CPU time of its phases, stamped from the draw callback, and the
+ * GPU time of each view, read back from GL_TIMESTAMP queries once they are
+ * available a few frames later. Timestamps are used rather than
+ * GL_TIME_ELAPSED, which can't nest inside the dynamic resolution timers. */
+
+#define XRSTATS_MAGIC 0x54535258 /* "XRST" */
+#define XRSTATS_VERSION 1
+/* frames shown by the overlay graph */
+#define XRSTATS_OVERLAY_FRAMES 120
+
+enum
+{
+	XRSTATS_VIEW_BEGIN,
+	XRSTATS_VIEW_DRAWN,
+	XRSTATS_VIEW_END
+};
+
+uint64_t xr_time_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	if (!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull
+	     + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull
+	       / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static uint32_t xrstats_us(uint64_t ns)
+{
+	const uint64_t us = ns / 1000;
+	return us > 0xffffffffu ? 0xffffffffu : (uint32_t)us;
+}
+
+/* Fills the GPU times of the frame that used the oldest query slot, if its
+ * results arrived. Dropped rather than waited for. */
+static void xrstats_read_queries(struct xr_stats *self, uint32_t slot)
+{
+	if (!self->query_pending[slot])
+		return;
+	self->query_pending[slot] = false;
+
+	const uint32_t views = self->query_views[slot];
+	GLuint available = 0;
+	if (!views)
+		return;
+	glGetQueryObjectuiv(self->queries[slot][views - 1][XRSTATS_VIEW_END],
+	                    GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	struct openxr_frame_stats *frame =
+		&self->frames[self->query_frame[slot] % XR_STATS_FRAMES];
+	if (frame->frame != self->query_frame[slot])
+		return;
+	for (uint32_t v = 0; v < views; v++)
+	{
+		GLuint64 stamps[3];
+		for (uint32_t q = 0; q < 3; q++)
+			glGetQueryObjectui64v(self->queries[slot][v][q], GL_QUERY_RESULT,
+			                      &stamps[q]);
+		frame->draw_gpu[v] = xrstats_us(stamps[XRSTATS_VIEW_DRAWN]
+		                                - stamps[XRSTATS_VIEW_BEGIN]);
+		frame->blit_gpu[v] = xrstats_us(stamps[XRSTATS_VIEW_END]
+		                                - stamps[XRSTATS_VIEW_DRAWN]);
+	}
+	frame->gpu_valid = true;
+}
+
+/* Time spent blocked in xrWaitFrame, from either thread, for the next
+ * frame's record. */
+void xrstats_waited(struct openxr_internal *xr, uint64_t wait_ns)
+{
+	if (xr->stats.enabled)
+		xr->stats.wait_frame = wait_ns;
+}
+
+/* Opens the record of the frame about to be drawn, after xrWaitFrame. */
+void xrstats_begin(struct openxr_internal *xr)
+{
+	struct xr_stats *self = &xr->stats;
+	if (!self->enabled)
+	{
+		self->current = NULL;
+		return;
+	}
+	if (!self->queries_ready)
+	{
+		glGenQueries(XR_TIMER_FRAMES * XR_MAX_VIEWS * 3, &self->queries[0][0][0]);
+		self->queries_ready = true;
+	}
+
+	const XrFrameState *state = &xr->frame_state;
+	struct openxr_frame_stats *frame = &self->frames[self->frame % XR_STATS_FRAMES];
+	memset(frame, 0, sizeof(*frame));
+	frame->frame = self->frame;
+	frame->display_time = state->predictedDisplayTime;
+	frame->display_period = xrstats_us((uint64_t)state->predictedDisplayPeriod);
+	frame->wait_frame = xrstats_us(self->wait_frame);
+	self->wait_frame = 0;
+
+	/* a display time further than one period away means the compositor
+	 * showed some frames again */
+	if (self->last_display_time && state->predictedDisplayPeriod > 0)
+	{
+		const XrTime delta = state->predictedDisplayTime - self->last_display_time;
+		const XrTime periods = (delta + state->predictedDisplayPeriod / 2)
+		                     / state->predictedDisplayPeriod;
+		if (periods > 1)
+			frame->missed = (uint32_t)(periods - 1);
+	}
+	self->last_display_time = state->predictedDisplayTime;
+
+	self->slot = (uint32_t)(self->frame % XR_TIMER_FRAMES);
+	xrstats_read_queries(self, self->slot);
+	self->query_views[self->slot] = 0;
+	self->current = frame;
+	self->frame_start = xr_time_ns();
+	self->mark = self->frame_start;
+}
+
+/* Adds the time since the previous mark to a phase of the current frame. */
+void xrstats_mark(struct openxr_internal *xr, enum xr_stats_phase phase,
+                  uint32_t view)
+{
+	struct xr_stats *self = &xr->stats;
+	struct openxr_frame_stats *frame = self->current;
+	if (!frame)
+		return;
+	const uint64_t now = xr_time_ns();
+	const uint32_t elapsed = xrstats_us(now - self->mark);
+	self->mark = now;
+	if (view >= XR_MAX_VIEWS)
+		view = XR_MAX_VIEWS - 1;
+
+	switch (phase)
+	{
+	case XR_STATS_IDLE: break;
+	case XR_STATS_BEGIN_FRAME: frame->begin_frame += elapsed; break;
+	case XR_STATS_SWAPCHAIN_WAIT: frame->swapchain_wait[view] += elapsed; break;
+	case XR_STATS_DRAW: frame->draw_cpu[view] += elapsed; break;
+	case XR_STATS_BLIT: frame->blit_cpu[view] += elapsed; break;
+	case XR_STATS_END_FRAME: frame->end_frame += elapsed; break;
+	}
+}
+
+/* GPU stamps around the draw and the copy of a view, view_begin also marks
+ * the CPU time since the last mark as idle. */
+void xrstats_view_begin(struct openxr_internal *xr, uint32_t view)
+{
+	struct xr_stats *self = &xr->stats;
+	if (!self->current || view >= XR_MAX_VIEWS)
+		return;
+	xrstats_mark(xr, XR_STATS_IDLE, view);
+	glQueryCounter(self->queries[self->slot][view][XRSTATS_VIEW_BEGIN], GL_TIMESTAMP);
+}
+
+void xrstats_view_drawn(struct openxr_internal *xr, uint32_t view)
+{
+	struct xr_stats *self = &xr->stats;
+	if (!self->current || view >= XR_MAX_VIEWS)
+		return;
+	xrstats_mark(xr, XR_STATS_DRAW, view);
+	glQueryCounter(self->queries[self->slot][view][XRSTATS_VIEW_DRAWN], GL_TIMESTAMP);
+}
+
+void xrstats_view_end(struct openxr_internal *xr, uint32_t view)
+{
+	struct xr_stats *self = &xr->stats;
+	if (!self->current || view >= XR_MAX_VIEWS)
+		return;
+	xrstats_mark(xr, XR_STATS_BLIT, view);
+	glQueryCounter(self->queries[self->slot][view][XRSTATS_VIEW_END], GL_TIMESTAMP);
+	if (view + 1 > self->query_views[self->slot])
+		self->query_views[self->slot] = view + 1;
+	if (view + 1 > self->current->view_count)
+		self->current->view_count = view + 1;
+}
+
+/* Closes the current record, rendered is false for frames the runtime
+ * asked not to render. */
+void xrstats_end(struct openxr_internal *xr, bool_t rendered)
+{
+	struct xr_stats *self = &xr->stats;
+	struct openxr_frame_stats *frame = self->current;
+	if (!frame)
+		return;
+	frame->rendered = rendered;
+	frame->cpu_total = xrstats_us(xr_time_ns() - self->frame_start);
+	self->query_pending[self->slot] = self->query_views[self->slot] > 0;
+	self->query_frame[self->slot] = self->frame;
+
+	self->totals.frames++;
+	self->totals.missed += frame->missed;
+	if (!rendered)
+		self->totals.not_rendered++;
+	self->frame++;
+	self->current = NULL;
+}
+
+/* ------------------------------------------------------------------------ */
+/* overlay */
+
+static const char *xrstats_vs =
+	"layout(location = 0) in vec2 pos;\n"
+	"layout(location = 1) in vec4 color;\n"
+	"out vec4 f_color;\n"
+	"void main()\n"
+	"{\n"
+	"	f_color = color;\n"
+	"	gl_Position = vec4(pos, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *xrstats_fs =
+	"in vec4 f_color;\n"
+	"out vec4 color;\n"
+	"void main() { color = f_color; }\n";
+
+struct xrstats_vertex
+{
+	float pos[2];
+	float color[4];
+};
+
+static uint32_t xrstats_rect(struct xrstats_vertex *out, float x0, float y0,
+                             float x1, float y1, const float color[4])
+{
+	const float corners[6][2] = {
+		{x0, y0}, {x1, y0}, {x1, y1}, {x0, y0}, {x1, y1}, {x0, y1}
+	};
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		out[i].pos[0] = corners[i][0];
+		out[i].pos[1] = corners[i][1];
+		memcpy(out[i].color, color, sizeof(out[i].color));
+	}
+	return 6;
+}
+
+static void xrstats_overlay_init(struct openxr_internal *xr)
+{
+	struct xr_stats *self = &xr->stats;
+	self->program = xr_program("", xrstats_vs, xrstats_fs);
+	if (!self->program)
+	{
+		xr_log(OPENXR_LOG_ERROR, OPENXR_LOG_PLUGIN, "failed to link stats overlay program");
+		self->overlay = false;
+		return;
+	}
+	glGenVertexArrays(1, &self->vao);
+	glGenBuffers(1, &self->vbo);
+	glBindVertexArray(self->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(struct xrstats_vertex),
+	                      NULL);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(struct xrstats_vertex),
+	                      (void*)(sizeof(float) * 2));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/* Graph of the last frames below the center of the view, CPU time on the
+ * left of each column and GPU time on the right, against a line at the
+ * display period. Frames that missed their display are drawn red. */
+void xrstats_draw_overlay(struct openxr_internal *xr, GLuint framebuffer,
+                          uint32_t view)
+{
+	static const float background[4] = {0.0f, 0.0f, 0.0f, 0.6f};
+	static const float budget_color[4] = {1.0f, 1.0f, 1.0f, 0.8f};
+	static const float cpu_color[4] = {0.3f, 0.6f, 1.0f, 1.0f};
+	static const float gpu_color[4] = {1.0f, 0.6f, 0.2f, 1.0f};
+	static const float missed_color[4] = {1.0f, 0.2f, 0.2f, 1.0f};
+	struct xrstats_vertex vertices[(2 + XRSTATS_OVERLAY_FRAMES * 2) * 6];
+	struct xr_stats *self = &xr->stats;
+	uint32_t count = 0;
+
+	if (!self->overlay || !self->enabled || self->frame == 0)
+		return;
+	if (!self->program)
+	{
+		xrstats_overlay_init(xr);
+		if (!self->program)
+			return;
+	}
+
+	const float x0 = -0.3f, x1 = 0.3f, y0 = -0.55f, y1 = -0.2f;
+	/* the graph spans two display periods */
+	const float budget_y = y0 + (y1 - y0) * 0.5f;
+	const float column = (x1 - x0) / XRSTATS_OVERLAY_FRAMES;
+	float period = (float)self->frames[(self->frame - 1) % XR_STATS_FRAMES].display_period;
+	if (period <= 0.0f)
+		period = 11111.0f;
+
+	count += xrstats_rect(&vertices[count], x0, y0, x1, y1, background);
+	for (uint32_t i = 0; i < XRSTATS_OVERLAY_FRAMES && i < self->frame
+	     && i < XR_STATS_FRAMES; i++)
+	{
+		const struct openxr_frame_stats *frame =
+			&self->frames[(self->frame - 1 - i) % XR_STATS_FRAMES];
+		uint32_t gpu = 0;
+		for (uint32_t v = 0; v < frame->view_count; v++)
+			gpu += frame->draw_gpu[v] + frame->blit_gpu[v];
+
+		const float right = x1 - column * i;
+		float cpu_h = frame->cpu_total / period * 0.5f;
+		float gpu_h = gpu / period * 0.5f;
+		if (cpu_h > 1.0f) cpu_h = 1.0f;
+		if (gpu_h > 1.0f) gpu_h = 1.0f;
+		count += xrstats_rect(&vertices[count], right - column,
+		                      y0, right - column * 0.5f,
+		                      y0 + (y1 - y0) * cpu_h,
+		                      frame->missed ? missed_color : cpu_color);
+		count += xrstats_rect(&vertices[count], right - column * 0.5f,
+		                      y0, right, y0 + (y1 - y0) * gpu_h,
+		                      frame->gpu_valid ? gpu_color : background);
+	}
+	count += xrstats_rect(&vertices[count], x0, budget_y - 0.002f, x1,
+	                      budget_y + 0.002f, budget_color);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, xr->views[view].width, xr->views[view].height);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(self->program);
+	glBindVertexArray(self->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(*vertices) * count, vertices,
+	             GL_STREAM_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, count);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	glDisable(GL_BLEND);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void xrstats_destroy(struct openxr_internal *xr)
+{
+	struct xr_stats *self = &xr->stats;
+	if (self->queries_ready)
+		glDeleteQueries(XR_TIMER_FRAMES * XR_MAX_VIEWS * 3, &self->queries[0][0][0]);
+	glDeleteProgram(self->program);
+	glDeleteVertexArrays(1, &self->vao);
+	glDeleteBuffers(1, &self->vbo);
+	self->queries_ready = false;
+	self->program = 0;
+	self->vao = 0;
+	self->vbo = 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* public API */
+
+void c_openxr_set_stats(c_openxr_t *self, bool_t enabled, bool_t overlay)
+{
+	self->internal->stats.enabled = enabled;
+	self->internal->stats.overlay = enabled && overlay;
+}
+
+uint32_t c_openxr_stats(c_openxr_t *self, struct openxr_frame_stats *frames,
+                        uint32_t max)
+{
+	const struct xr_stats *stats = &self->internal->stats;
+	uint64_t available = stats->frame < XR_STATS_FRAMES ? stats->frame
+	                                                    : XR_STATS_FRAMES;
+	if (available > max)
+		available = max;
+	const uint64_t first = stats->frame - available;
+	for (uint64_t i = 0; i < available; i++)
+		frames[i] = stats->frames[(first + i) % XR_STATS_FRAMES];
+	return (uint32_t)available;
+}
+
+struct openxr_stats_totals c_openxr_stats_totals(c_openxr_t *self)
+{
+	return self->internal->stats.totals;
+}
+
+static bool_t xrstats_dump_csv(FILE *fp, const struct openxr_frame_stats *frames,
+                               uint32_t count)
+{
+	fprintf(fp, "frame,display_time,display_period_us,missed,rendered,"
+	            "wait_frame_us,begin_frame_us,end_frame_us,cpu_total_us,gpu_valid");
+	for (uint32_t v = 0; v < OPENXR_STATS_VIEWS; v++)
+		fprintf(fp, ",swapchain_wait%u_us,draw_cpu%u_us,blit_cpu%u_us,"
+		            "draw_gpu%u_us,blit_gpu%u_us", v, v, v, v, v);
+	fprintf(fp, "\n");
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const struct openxr_frame_stats *f = &frames[i];
+		fprintf(fp, "%llu,%lld,%u,%u,%u,%u,%u,%u,%u,%u",
+		        (unsigned long long)f->frame, (long long)f->display_time,
+		        f->display_period, f->missed, f->rendered, f->wait_frame,
+		        f->begin_frame, f->end_frame, f->cpu_total, f->gpu_valid);
+		for (uint32_t v = 0; v < OPENXR_STATS_VIEWS; v++)
+			fprintf(fp, ",%u,%u,%u,%u,%u", f->swapchain_wait[v], f->draw_cpu[v],
+			        f->blit_cpu[v], f->draw_gpu[v], f->blit_gpu[v]);
+		fprintf(fp, "\n");
+	}
+	return !ferror(fp);
+}
+
+bool_t c_openxr_stats_dump(c_openxr_t *self, const char *path)
+{
+	struct openxr_frame_stats *frames = malloc(sizeof(*frames) * XR_STATS_FRAMES);
+	const uint32_t count = c_openxr_stats(self, frames, XR_STATS_FRAMES);
+	const size_t length = strlen(path);
+	const bool_t csv = length > 4 && !strcmp(path + length - 4, ".csv");
+	bool_t ok;
+
+	FILE *fp = fopen(path, csv ? "w" : "wb");
+	if (!fp)
+	{
+		free(frames);
+		return false;
+	}
+	if (csv)
+	{
+		ok = xrstats_dump_csv(fp, frames, count);
+	}
+	else
+	{
+		/* magic, version, record size and count, then the raw records */
+		const uint32_t header[4] = {XRSTATS_MAGIC, XRSTATS_VERSION,
+		                            sizeof(*frames), count};
+		fwrite(header, sizeof(header), 1, fp);
+		fwrite(frames, sizeof(*frames), count, fp);
+		ok = !ferror(fp);
+	}
+	fclose(fp);
+	free(frames);
+	return ok;
+}
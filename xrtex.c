@@ -0,0 +1,595 @@
+#include "openxr.h"
+
+#include "../candle/third_party/stb/stb_image.h"
+
+#include "internals.h"
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Block compressed textures. The first load of a PNG decodes it, builds the
+ * full mip chain and writes a .ktx2 entry to the user's cache directory,
+ * every level encoded as BC1. Later loads read the container and hand the
+ * blocks to GL as they are, skipping the decode and storing 4 bits per
+ * texel instead of 32.
+ * Like the mesh cache, entries are keyed by the FNV-1a hash of the source,
+ * only recomputed when its size or modification time changed. */
+
+#define XRTEX_VK_BC1_RGB_UNORM 131
+#define XRTEX_VK_BC1_RGB_SRGB 132
+#define XRTEX_BLOCK_BYTES 8
+#define XRTEX_MAX_LEVELS 16
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+static const uint8_t xrtex_identifier[12] = {
+	0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+/* the source stamp lives in the key/value data, fixed width so it can be
+ * rewritten in place */
+#define XRTEX_STAMP_KEY "xrSource"
+#define XRTEX_STAMP_LENGTH 50
+
+struct xrtex_header
+{
+	uint8_t identifier[12];
+	uint32_t vk_format;
+	uint32_t type_size;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t layer_count;
+	uint32_t face_count;
+	uint32_t level_count;
+	uint32_t supercompression;
+	uint32_t dfd_offset;
+	uint32_t dfd_length;
+	uint32_t kvd_offset;
+	uint32_t kvd_length;
+	uint64_t sgd_offset;
+	uint64_t sgd_length;
+};
+
+struct xrtex_level
+{
+	uint64_t offset;
+	uint64_t length;
+	uint64_t uncompressed_length;
+};
+
+struct xrtex_stamp
+{
+	uint64_t size;
+	int64_t mtime;
+	uint64_t hash;
+};
+
+static uint32_t xrtex_level_size(uint32_t size, uint32_t level)
+{
+	size >>= level;
+	return size ? size : 1;
+}
+
+static uint32_t xrtex_level_bytes(uint32_t width, uint32_t height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * XRTEX_BLOCK_BYTES;
+}
+
+/* ------------------------------------------------------------------------ */
+/* encoding */
+
+static uint16_t xrtex_565(const float c[3])
+{
+	const int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+	const int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+	const int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r < 0 ? 0 : r > 31 ? 31 : r) << 11
+	                | (g < 0 ? 0 : g > 63 ? 63 : g) << 5
+	                | (b < 0 ? 0 : b > 31 ? 31 : b));
+}
+
+static void xrtex_unpack_565(uint16_t c, int out[3])
+{
+	out[0] = ((c >> 11) & 31) * 255 / 31;
+	out[1] = ((c >> 5) & 63) * 255 / 63;
+	out[2] = (c & 31) * 255 / 31;
+}
+
+/* Endpoints are the inset corners of the block's color box along its
+ * dominant diagonal, every texel then picks the nearest of the four
+ * palette entries. */
+static void xrtex_encode_block(const uint8_t *rgba, uint32_t width,
+                               uint32_t height, uint32_t bx, uint32_t by,
+                               uint8_t out[XRTEX_BLOCK_BYTES])
+{
+	uint8_t texels[16][3];
+	float min[3] = {255.0f, 255.0f, 255.0f};
+	float max[3] = {0.0f, 0.0f, 0.0f};
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	float cov[3] = {0.0f, 0.0f, 0.0f};
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		/* blocks hanging over the edge of small levels repeat the border */
+		uint32_t x = bx * 4 + (i & 3);
+		uint32_t y = by * 4 + (i >> 2);
+		if (x >= width) x = width - 1;
+		if (y >= height) y = height - 1;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			texels[i][c] = rgba[(y * width + x) * 4 + c];
+			mean[c] += texels[i][c] / 16.0f;
+			if (texels[i][c] < min[c]) min[c] = texels[i][c];
+			if (texels[i][c] > max[c]) max[c] = texels[i][c];
+		}
+	}
+	/* flip the box diagonal to follow green's correlation with red and blue */
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		cov[0] += (texels[i][0] - mean[0]) * (texels[i][1] - mean[1]);
+		cov[2] += (texels[i][2] - mean[2]) * (texels[i][1] - mean[1]);
+	}
+	for (uint32_t c = 0; c < 3; c += 2)
+	{
+		if (cov[c] < 0.0f)
+		{
+			const float t = min[c];
+			min[c] = max[c];
+			max[c] = t;
+		}
+	}
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		const float inset = (max[c] - min[c]) / 16.0f;
+		max[c] -= inset;
+		min[c] += inset;
+	}
+
+	uint16_t c0 = xrtex_565(max);
+	uint16_t c1 = xrtex_565(min);
+	uint32_t indices = 0;
+	if (c0 < c1)
+	{
+		const uint16_t t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+	if (c0 != c1)
+	{
+		int palette[4][3];
+		xrtex_unpack_565(c0, palette[0]);
+		xrtex_unpack_565(c1, palette[1]);
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			int best_error = 0x7fffffff;
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					const int d = texels[i][c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < best_error)
+				{
+					best_error = error;
+					best = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	out[0] = c0 & 0xff;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xff;
+	out[3] = c1 >> 8;
+	for (uint32_t i = 0; i < 4; i++)
+		out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+static void xrtex_encode_level(const uint8_t *rgba, uint32_t width,
+                               uint32_t height, uint8_t *out)
+{
+	const uint32_t blocks_x = (width + 3) / 4;
+	const uint32_t blocks_y = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocks_y; by++)
+		for (uint32_t bx = 0; bx < blocks_x; bx++)
+			xrtex_encode_block(rgba, width, height, bx, by,
+			                   &out[(by * blocks_x + bx) * XRTEX_BLOCK_BYTES]);
+}
+
+/* 2x2 box filter, averaged in linear space for sRGB data so the small
+ * levels don't darken. */
+static void xrtex_downsample(const uint8_t *src, uint32_t width, uint32_t height,
+                             uint8_t *dst, bool_t srgb)
+{
+	static float to_linear[256];
+	static bool_t table_ready = false;
+	const uint32_t dst_width = width > 1 ? width / 2 : 1;
+	const uint32_t dst_height = height > 1 ? height / 2 : 1;
+
+	if (!table_ready)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			const float c = i / 255.0f;
+			to_linear[i] = c <= 0.04045f ? c / 12.92f
+			                             : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		table_ready = true;
+	}
+
+	for (uint32_t y = 0; y < dst_height; y++)
+	{
+		const uint32_t y0 = y * 2 < height ? y * 2 : height - 1;
+		const uint32_t y1 = y * 2 + 1 < height ? y * 2 + 1 : y0;
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			const uint32_t x0 = x * 2 < width ? x * 2 : width - 1;
+			const uint32_t x1 = x * 2 + 1 < width ? x * 2 + 1 : x0;
+			const uint8_t *t[4] = {
+				&src[(y0 * width + x0) * 4], &src[(y0 * width + x1) * 4],
+				&src[(y1 * width + x0) * 4], &src[(y1 * width + x1) * 4]
+			};
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				float value;
+				if (srgb && c < 3)
+				{
+					const float l = (to_linear[t[0][c]] + to_linear[t[1][c]]
+					               + to_linear[t[2][c]] + to_linear[t[3][c]]) / 4.0f;
+					value = l <= 0.0031308f ? l * 12.92f
+					                        : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+					value *= 255.0f;
+				}
+				else
+				{
+					value = (t[0][c] + t[1][c] + t[2][c] + t[3][c]) / 4.0f;
+				}
+				dst[(y * dst_width + x) * 4 + c] = (uint8_t)(value + 0.5f);
+			}
+		}
+	}
+}
+
+static void xrtex_format_stamp(const struct xrtex_stamp *stamp,
+                               char out[XRTEX_STAMP_LENGTH + 1])
+{
+	snprintf(out, XRTEX_STAMP_LENGTH + 1, "%016llx %016llx %016llx",
+	         (unsigned long long)stamp->size, (unsigned long long)stamp->mtime,
+	         (unsigned long long)stamp->hash);
+}
+
+static uint32_t xrtex_stamp_offset(uint32_t level_count)
+{
+	/* header, level index, dfd, then the key/value length */
+	return sizeof(struct xrtex_header) + sizeof(struct xrtex_level) * level_count
+	     + 44 + 4 + sizeof(XRTEX_STAMP_KEY);
+}
+
+static bool_t xrtex_write(const char *cache_path, uint32_t width, uint32_t height,
+                          uint32_t level_count, bool_t srgb,
+                          uint8_t *const *levels, const struct xrtex_stamp *stamp)
+{
+	struct xrtex_header header = {0};
+	struct xrtex_level index[XRTEX_MAX_LEVELS];
+	char stamp_text[XRTEX_STAMP_LENGTH + 1];
+	const uint8_t zeros[XRTEX_BLOCK_BYTES] = {0};
+	const uint32_t kv_length = sizeof(XRTEX_STAMP_KEY) + XRTEX_STAMP_LENGTH + 1;
+	const uint32_t kv_padded = (4 + kv_length + 3) & ~3u;
+
+	/* basic data format descriptor for BC1 */
+	const uint32_t dfd[11] = {
+		44, 0, 2 | (40 << 16),
+		128 /* BC1A */ | 1 << 8 /* BT709 */ | (srgb ? 2 : 1) << 16,
+		3 | 3 << 8, XRTEX_BLOCK_BYTES, 0,
+		63 << 16, 0, 0, 0xffffffffu
+	};
+
+	memcpy(header.identifier, xrtex_identifier, sizeof(xrtex_identifier));
+	header.vk_format = srgb ? XRTEX_VK_BC1_RGB_SRGB : XRTEX_VK_BC1_RGB_UNORM;
+	header.type_size = 1;
+	header.width = width;
+	header.height = height;
+	header.face_count = 1;
+	header.level_count = level_count;
+	header.dfd_offset = sizeof(header) + sizeof(*index) * level_count;
+	header.dfd_length = sizeof(dfd);
+	header.kvd_offset = header.dfd_offset + header.dfd_length;
+	header.kvd_length = kv_padded;
+
+	/* levels are stored smallest first, each aligned to a block */
+	uint64_t offset = header.kvd_offset + header.kvd_length;
+	for (uint32_t l = level_count; l-- > 0;)
+	{
+		offset = (offset + XRTEX_BLOCK_BYTES - 1) & ~(uint64_t)(XRTEX_BLOCK_BYTES - 1);
+		index[l].offset = offset;
+		index[l].length = xrtex_level_bytes(xrtex_level_size(width, l),
+		                                    xrtex_level_size(height, l));
+		index[l].uncompressed_length = index[l].length;
+		offset += index[l].length;
+	}
+
+	FILE *fp = fopen(cache_path, "wb");
+	if (!fp)
+		return false;
+	xrtex_format_stamp(stamp, stamp_text);
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite(index, sizeof(*index), level_count, fp);
+	fwrite(dfd, sizeof(dfd), 1, fp);
+	fwrite(&kv_length, sizeof(kv_length), 1, fp);
+	fwrite(XRTEX_STAMP_KEY, sizeof(XRTEX_STAMP_KEY), 1, fp);
+	fwrite(stamp_text, XRTEX_STAMP_LENGTH + 1, 1, fp);
+	fwrite(zeros, 1, kv_padded - 4 - kv_length, fp);
+
+	uint64_t written = header.kvd_offset + header.kvd_length;
+	for (uint32_t l = level_count; l-- > 0;)
+	{
+		fwrite(zeros, 1, (size_t)(index[l].offset - written), fp);
+		fwrite(levels[l], 1, (size_t)index[l].length, fp);
+		written = index[l].offset + index[l].length;
+	}
+	const bool_t ok = !ferror(fp);
+	fclose(fp);
+	if (!ok)
+		remove(cache_path);
+	return ok;
+}
+
+/* Decodes the PNG and writes its compressed mip chain. */
+static bool_t xrtex_transcode(const char *path, const char *cache_path,
+                              bool_t srgb, const struct xrtex_stamp *stamp)
+{
+	int width, height, channels;
+	uint8_t *levels[XRTEX_MAX_LEVELS] = {0};
+	uint32_t level_count = 1;
+	bool_t ok;
+
+	uint8_t *rgba = stbi_load(path, &width, &height, &channels, 4);
+	if (!rgba)
+		return false;
+	while (level_count < XRTEX_MAX_LEVELS
+	       && (width >> level_count || height >> level_count))
+		level_count++;
+
+	uint8_t *current = rgba;
+	for (uint32_t l = 0; l < level_count; l++)
+	{
+		const uint32_t w = xrtex_level_size(width, l);
+		const uint32_t h = xrtex_level_size(height, l);
+		levels[l] = malloc(xrtex_level_bytes(w, h));
+		xrtex_encode_level(current, w, h, levels[l]);
+		if (l + 1 < level_count)
+		{
+			uint8_t *next = malloc((size_t)xrtex_level_size(width, l + 1)
+			                       * xrtex_level_size(height, l + 1) * 4);
+			xrtex_downsample(current, w, h, next, srgb);
+			if (current != rgba)
+				free(current);
+			current = next;
+		}
+	}
+	if (current != rgba)
+		free(current);
+	stbi_image_free(rgba);
+
+	ok = xrtex_write(cache_path, width, height, level_count, srgb, levels, stamp);
+	for (uint32_t l = 0; l < level_count; l++)
+		free(levels[l]);
+	if (ok)
+		xr_log(OPENXR_LOG_INFO, OPENXR_LOG_PLUGIN, "transcoded %s: %dx%d, %u levels",
+		       path, width, height, level_count);
+	else
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "could not write texture cache %s", cache_path);
+	return ok;
+}
+
+/* ------------------------------------------------------------------------ */
+/* loading */
+
+static uint8_t *xrtex_read(const char *path, size_t *size)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	const long length = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	uint8_t *data = length > 0 ? malloc((size_t)length) : NULL;
+	if (data && fread(data, 1, (size_t)length, fp) != (size_t)length)
+	{
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+	*size = data ? (size_t)length : 0;
+	return data;
+}
+
+/* Checks the container is one of ours and in bounds, reading back its
+ * source stamp. */
+static bool_t xrtex_valid(const uint8_t *data, size_t size, bool_t srgb,
+                          struct xrtex_stamp *stamp)
+{
+	const struct xrtex_header *header = (const struct xrtex_header*)data;
+	const struct xrtex_level *index = (const struct xrtex_level*)(header + 1);
+	unsigned long long size_field, mtime_field, hash_field;
+	char stamp_text[XRTEX_STAMP_LENGTH + 1];
+
+	if (size < sizeof(*header)
+	    || memcmp(header->identifier, xrtex_identifier, sizeof(xrtex_identifier))
+	    || header->vk_format != (srgb ? XRTEX_VK_BC1_RGB_SRGB : XRTEX_VK_BC1_RGB_UNORM)
+	    || header->supercompression != 0
+	    || header->level_count == 0 || header->level_count > XRTEX_MAX_LEVELS
+	    || xrtex_stamp_offset(header->level_count) + XRTEX_STAMP_LENGTH > size)
+		return false;
+	for (uint32_t l = 0; l < header->level_count; l++)
+	{
+		const uint32_t bytes = xrtex_level_bytes(xrtex_level_size(header->width, l),
+		                                         xrtex_level_size(header->height, l));
+		if (index[l].length != bytes || index[l].offset + bytes > size)
+			return false;
+	}
+
+	memcpy(stamp_text, data + xrtex_stamp_offset(header->level_count),
+	       XRTEX_STAMP_LENGTH);
+	stamp_text[XRTEX_STAMP_LENGTH] = '\0';
+	if (sscanf(stamp_text, "%llx %llx %llx", &size_field, &mtime_field,
+	           &hash_field) != 3)
+		return false;
+	stamp->size = size_field;
+	stamp->mtime = (int64_t)mtime_field;
+	stamp->hash = hash_field;
+	return true;
+}
+
+static void xrtex_restamp(const char *cache_path, uint32_t level_count,
+                          const struct xrtex_stamp *stamp)
+{
+	char stamp_text[XRTEX_STAMP_LENGTH + 1];
+	FILE *fp = fopen(cache_path, "r+b");
+	if (!fp)
+		return;
+	xrtex_format_stamp(stamp, stamp_text);
+	fseek(fp, xrtex_stamp_offset(level_count), SEEK_SET);
+	fwrite(stamp_text, XRTEX_STAMP_LENGTH, 1, fp);
+	fclose(fp);
+}
+
+/* Reads the cache entry of path, building it first when it is missing or
+ * stale. */
+static uint8_t *xrtex_open(const char *path, bool_t srgb, size_t *size)
+{
+	char cache_path[512];
+	struct xrtex_stamp stamp = {0};
+	struct xrtex_stamp cached;
+	struct stat st;
+	uint8_t *data;
+
+	if (stat(path, &st))
+		return NULL;
+	if (!xr_cache_entry(path, ".ktx2", cache_path, sizeof(cache_path)))
+		return NULL;
+
+	data = xrtex_read(cache_path, size);
+	if (data && xrtex_valid(data, *size, srgb, &cached))
+	{
+		if (cached.size == (uint64_t)st.st_size
+		    && cached.mtime == (int64_t)st.st_mtime)
+			return data;
+		if (cached.size == (uint64_t)st.st_size)
+		{
+			size_t source_size;
+			uint8_t *source = xrtex_read(path, &source_size);
+			const bool_t fresh = source
+				&& xr_hash(source, source_size) == cached.hash;
+			free(source);
+			if (fresh)
+			{
+				cached.mtime = (int64_t)st.st_mtime;
+				xrtex_restamp(cache_path,
+				              ((const struct xrtex_header*)data)->level_count,
+				              &cached);
+				return data;
+			}
+		}
+	}
+	free(data);
+
+	size_t source_size;
+	uint8_t *source = xrtex_read(path, &source_size);
+	if (!source)
+		return NULL;
+	stamp.size = source_size;
+	stamp.mtime = (int64_t)st.st_mtime;
+	stamp.hash = xr_hash(source, source_size);
+	free(source);
+
+	if (!xrtex_transcode(path, cache_path, srgb, &stamp))
+		return NULL;
+	data = xrtex_read(cache_path, size);
+	if (data && !xrtex_valid(data, *size, srgb, &cached))
+	{
+		free(data);
+		data = NULL;
+	}
+	return data;
+}
+
+/* Shared stand-in for maps that don't exist, a mid grey reads as neutral
+ * albedo and medium roughness alike. */
+GLuint xrtex_fallback(void)
+{
+	static GLuint texture = 0;
+	if (!texture)
+	{
+		const uint8_t texel[4] = {128, 128, 128, 255};
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA,
+		             GL_UNSIGNED_BYTE, texel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	return texture;
+}
+
+/* Uploads the compressed mip chain of the PNG at path, transcoding it on
+ * first use. Returns the shared fallback when it can't be read, width and
+ * height are then 1; that one is never to be deleted by the caller. */
+GLuint xrtex_load(const char *path, bool_t srgb, uint32_t *width,
+                  uint32_t *height)
+{
+	size_t size;
+	uint8_t *data = xrtex_open(path, srgb, &size);
+	GLuint texture;
+
+	*width = *height = 1;
+	if (!data)
+	{
+		xr_log(OPENXR_LOG_WARNING, OPENXR_LOG_PLUGIN,
+		       "missing texture %s, using fallback", path);
+		return xrtex_fallback();
+	}
+
+	const struct xrtex_header *header = (const struct xrtex_header*)data;
+	const struct xrtex_level *index = (const struct xrtex_level*)(header + 1);
+	const GLenum format = srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+	                           : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	for (uint32_t l = 0; l < header->level_count; l++)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, l, format,
+		                       xrtex_level_size(header->width, l),
+		                       xrtex_level_size(header->height, l), 0,
+		                       (GLsizei)index[l].length, data + index[l].offset);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->level_count - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	*width = header->width;
+	*height = header->height;
+	free(data);
+	return texture;
+}